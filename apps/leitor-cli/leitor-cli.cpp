@@ -74,6 +74,8 @@ int main(int argc, char* argv[]) {
     }
 
     Leitor<TimerPolicyWinUnix, SerialPolicyGenericOS> leitor(porta);
+    // os comandos seguintes são transmitidos no próximo ENQ do medidor
+    leitor.setSessao(true);
 
     std::vector<comando_t> comandos;
     for (int i = 2; i < argc; i++) {
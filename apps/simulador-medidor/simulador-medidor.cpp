@@ -0,0 +1,247 @@
+// simulador de medidores NBR14522: abre N pseudo-terminais e faz o papel do
+// medidor em cada um (ver include/medidor_simulado.h), para testes de carga de
+// SerialPolicyUnix e do leitor-cli sem hardware. Leia o uso abaixo.
+
+#include <NBR14522.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <medidor_simulado.h>
+#include <memory>
+#include <poll.h>
+#include <stdlib.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace NBR14522;
+using clock_simulador = MedidorSimulado::clock;
+
+void print_usage() {
+    printf(
+        "Uso: simulador-medidor [opções]\n\n"
+        "Abre pseudo-terminais que se comportam como medidores NBR14522. O\n"
+        "caminho do lado escravo de cada pty é impresso em uma linha e pode\n"
+        "ser passado ao leitor-cli como porta serial. Ctrl+C encerra e\n"
+        "imprime as estatísticas de cada medidor.\n\n"
+
+        "Opções:\n"
+        "-n <N>     quantidade de medidores (padrão 1)\n"
+        "-b <baud>  baudrate simulado; 0 desliga a cadência (padrão %u)\n"
+        "-e <ms>    período entre ENQs (padrão %u)\n"
+        "-c <N>     respostas de comandos compostos (padrão 3)\n"
+        "-w <‰>     probabilidade de WAIT, em milésimos (padrão 0)\n"
+        "-k <‰>     probabilidade de NAK a um comando correto (padrão 0)\n"
+        "-r <‰>     probabilidade de ruído em uma resposta (padrão 0)\n\n"
+
+        "Exemplo:\n"
+        "./simulador-medidor -n 100 -b 9600 -w 10 -r 5\n\n",
+        BAUDRATE, TAVGENQ_MSEC);
+}
+
+// um medidor simulado atrás do lado mestre de um pty
+class MedidorPty {
+  public:
+    MedidorPty(const MedidorSimulado::configuracao_t& configuracao,
+               const uint32_t baudrate)
+        : _medidor(configuracao), _baudrate(baudrate) {}
+
+    ~MedidorPty() {
+        if (_escravo >= 0)
+            close(_escravo);
+        if (_mestre >= 0)
+            close(_mestre);
+    }
+
+    bool abre() {
+        _mestre = posix_openpt(O_RDWR | O_NOCTTY);
+        if (_mestre < 0 || grantpt(_mestre) || unlockpt(_mestre))
+            return false;
+        fcntl(_mestre, F_SETFL, fcntl(_mestre, F_GETFL) | O_NONBLOCK);
+        _nome = ptsname(_mestre);
+
+        // sem eco nem processamento de linha antes do leitor configurar a
+        // porta; o lado escravo fica aberto para que o mestre não receba
+        // POLLHUP enquanto nenhum leitor estiver conectado
+        _escravo = open(_nome.c_str(), O_RDWR | O_NOCTTY);
+        if (_escravo < 0)
+            return false;
+        struct termios tty;
+        if (tcgetattr(_escravo, &tty) == 0) {
+            cfmakeraw(&tty);
+            tcsetattr(_escravo, TCSANOW, &tty);
+        }
+
+        _ultimoTx = clock_simulador::now();
+        return true;
+    }
+
+    int fd() const { return _mestre; }
+    const std::string& nome() const { return _nome; }
+    const MedidorSimulado& medidor() const { return _medidor; }
+
+    // bytes transmitidos pelo leitor
+    void recebe(const clock_simulador::time_point agora) {
+        byte_t buf[512];
+        ssize_t n;
+        while ((n = read(_mestre, buf, sizeof(buf))) > 0)
+            _medidor.recebe(buf, static_cast<size_t>(n), agora);
+    }
+
+    // transmite ao leitor o que o baudrate permitir desde a última
+    // transmissão (10 bits por byte)
+    void transmite(const clock_simulador::time_point agora) {
+        size_t credito = sizeof(_buf);
+        if (_baudrate) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          agora - _ultimoTx)
+                          .count();
+            credito = static_cast<size_t>(us * _baudrate / 10000000);
+            if (credito > sizeof(_buf))
+                credito = sizeof(_buf);
+        }
+
+        _medidor.processa(agora);
+        if (!_medidor.pendentes()) {
+            _ultimoTx = agora;
+            return;
+        }
+        if (!credito)
+            return;
+
+        size_t n = _medidor.transmite(_buf, credito, agora);
+        // sem leitor conectado o buffer do pty enche e os bytes são perdidos,
+        // como na linha serial
+        if (write(_mestre, _buf, n) < 0 && errno != EAGAIN)
+            perror(_nome.c_str());
+
+        // avança somente o tempo de transmissão dos bytes enviados, para não
+        // perder a fração de byte do crédito
+        if (_baudrate)
+            _ultimoTx += std::chrono::microseconds(n * 10000000 / _baudrate);
+        else
+            _ultimoTx = agora;
+    }
+
+    // quanto tempo o laço pode dormir antes deste medidor ter o que fazer
+    int esperaMs(const clock_simulador::time_point agora) const {
+        if (_medidor.pendentes())
+            return 1; // cadência do baudrate
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      _medidor.proximoEvento() - agora)
+                      .count();
+        return ms < 0 ? 0 : ms > 1000 ? 1000 : static_cast<int>(ms) + 1;
+    }
+
+  private:
+    MedidorSimulado _medidor;
+    uint32_t _baudrate;
+    int _mestre = -1;
+    int _escravo = -1;
+    std::string _nome;
+    clock_simulador::time_point _ultimoTx;
+    byte_t _buf[RESPOSTA_SZ];
+};
+
+static volatile sig_atomic_t encerrar = 0;
+
+static void trataSinal(int) { encerrar = 1; }
+
+int main(int argc, char* argv[]) {
+    MedidorSimulado::configuracao_t configuracao =
+        MedidorSimulado::configuracaoPadrao();
+    uint32_t medidores = 1;
+    uint32_t baudrate = BAUDRATE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:e:c:w:k:r:h")) != -1) {
+        uint32_t valor = optarg ? static_cast<uint32_t>(atol(optarg)) : 0;
+        switch (opt) {
+        case 'n':
+            medidores = valor;
+            break;
+        case 'b':
+            baudrate = valor;
+            break;
+        case 'e':
+            configuracao.periodoEnq_ms = valor;
+            break;
+        case 'c':
+            configuracao.respostasCompostas = valor;
+            break;
+        case 'w':
+            configuracao.permilWait = valor;
+            break;
+        case 'k':
+            configuracao.permilNak = valor;
+            break;
+        case 'r':
+            configuracao.permilRuido = valor;
+            break;
+        default:
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::unique_ptr<MedidorPty>> ptys;
+    for (uint32_t i = 0; i < medidores; i++) {
+        // número de série e sequência aleatória distintos por medidor
+        MedidorSimulado::configuracao_t cfg = configuracao;
+        cfg.numSerie = {static_cast<byte_t>(i >> 24),
+                        static_cast<byte_t>(i >> 16),
+                        static_cast<byte_t>(i >> 8), static_cast<byte_t>(i)};
+        cfg.semente = configuracao.semente + i;
+
+        ptys.emplace_back(new MedidorPty(cfg, baudrate));
+        if (!ptys.back()->abre()) {
+            perror("pty");
+            return EXIT_FAILURE;
+        }
+        printf("%s\n", ptys.back()->nome().c_str());
+    }
+    fflush(stdout);
+
+    signal(SIGINT, trataSinal);
+    signal(SIGTERM, trataSinal);
+
+    std::vector<struct pollfd> pfds(ptys.size());
+    for (size_t i = 0; i < ptys.size(); i++)
+        pfds[i] = {ptys[i]->fd(), POLLIN, 0};
+
+    while (!encerrar) {
+        auto agora = clock_simulador::now();
+        int espera = 1000;
+        for (auto& pty : ptys) {
+            pty->transmite(agora);
+            int ms = pty->esperaMs(agora);
+            if (ms < espera)
+                espera = ms;
+        }
+
+        if (poll(pfds.data(), pfds.size(), espera) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        agora = clock_simulador::now();
+        for (size_t i = 0; i < ptys.size(); i++)
+            if (pfds[i].revents & POLLIN)
+                ptys[i]->recebe(agora);
+    }
+
+    printf("\n%-16s %8s %8s %8s %6s %8s %8s %8s\n", "pty", "ENQs", "comandos",
+           "respostas", "WAITs", "NAKs tx", "NAKs rx", "ruído");
+    for (auto& pty : ptys) {
+        const auto& e = pty->medidor().estatisticas();
+        printf("%-16s %8u %8u %9u %6u %8u %8u %8u\n", pty->nome().c_str(),
+               e.enqs, e.comandos, e.respostas, e.waits, e.naksTransmitidos,
+               e.naksRecebidos, e.respostasCorrompidas);
+    }
+
+    return EXIT_SUCCESS;
+}
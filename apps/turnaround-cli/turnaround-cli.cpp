@@ -0,0 +1,150 @@
+// mede o tempo de reversão do leitor: entre o recebimento do ENQ e a
+// transmissão do comando, por porta. Leia o uso abaixo.
+
+#include <CRC.h>
+#include <NBR14522.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <leitor.h>
+#include <memory>
+#include <serial/serial_policy_unix.h>
+#include <string>
+#include <timer/timer_policy_generic_os.h>
+#include <trace_policy.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace NBR14522;
+
+#define TIMEOUT_SEM_RESPOSTA_MS 10000
+
+using Porta = SerialPolicyUnix<TracePolicyMemoria<1 << 16>>;
+
+void print_usage() {
+    printf(
+        "Uso: turnaround-cli [opções] <porta> [<porta> ...]\n\n"
+        "Executa leituras em cada porta serial e reporta o tempo entre o\n"
+        "recebimento de cada ENQ pelo leitor e a transmissão do comando que\n"
+        "ele disparou (reversão em software, sem o atraso do conversor), a\n"
+        "ser comparado a TMAXSINC (%u ms), e se a porta aceitou o modo de\n"
+        "baixa latência.\n\n"
+
+        "Opções:\n"
+        "-n <N>     leituras por porta (padrão 20)\n"
+        "-c <hex>   comando, como no leitor-cli (padrão 14)\n"
+        "-b <baud>  2400 ou 9600 (padrão 9600)\n"
+        "-p         não solicita baixa latência ao driver, para comparação\n\n"
+
+        "Exemplo:\n"
+        "./turnaround-cli -n 50 /dev/ttyUSB0 /dev/ttyUSB1\n\n",
+        TMAXSINC_MSEC);
+}
+
+// tempos ENQ -> comando da última leitura, em ns, a partir do trace
+static void coletaAmostras(Porta& porta, std::vector<uint64_t>& amostras) {
+    cabecalho_trace_t cabecalho;
+    byte_t dados[RESPOSTA_SZ];
+    uint64_t enq_ns = 0;
+
+    while (porta.trace().proximoRegistro(cabecalho, dados, sizeof(dados))) {
+        size_t sz = std::min<size_t>(cabecalho.tamanho, sizeof(dados));
+        if (cabecalho.direcao == TRACE_RX) {
+            // somente o ENQ imediatamente anterior dispara o comando
+            enq_ns = sz && dados[sz - 1] == ENQ ? cabecalho.timestamp_ns : 0;
+        } else {
+            // retransmissões após NAK ou timeout não têm ENQ antes
+            if (enq_ns && cabecalho.tamanho == COMANDO_SZ)
+                amostras.push_back(cabecalho.timestamp_ns - enq_ns);
+            enq_ns = 0;
+        }
+    }
+}
+
+static double us(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+
+int main(int argc, char* argv[]) {
+    size_t leituras = 20;
+    std::string comandoHex = "14";
+    baudrate_t baudrate = BAUDRATE_9600;
+    latencia_t latencia = LATENCIA_BAIXA;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:b:ph")) != -1) {
+        switch (opt) {
+        case 'n':
+            leituras = static_cast<size_t>(atol(optarg));
+            break;
+        case 'c':
+            comandoHex = optarg;
+            break;
+        case 'b':
+            baudrate = atol(optarg) == 2400 ? BAUDRATE_2400 : BAUDRATE_9600;
+            break;
+        case 'p':
+            latencia = LATENCIA_PADRAO;
+            break;
+        default:
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || comandoHex.size() & 1) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    comando_t comando;
+    comando.fill(0x00);
+    for (size_t i = 0; i < comandoHex.size() && i / 2 < COMANDO_SZ - 2;
+         i += 2)
+        comando.at(i / 2) = static_cast<byte_t>(
+            strtol(comandoHex.substr(i, 2).c_str(), nullptr, 16));
+    setCRC(comando, CRC16(comando.data(), comando.size() - 2));
+
+    printf("%-16s %5s %6s %9s %9s %9s %9s %8s\n", "porta", "baixa", "falhas",
+           "mín (us)", "méd (us)", "p99 (us)", "máx (us)", "amostras");
+
+    for (int i = optind; i < argc; i++) {
+        auto porta = std::make_shared<Porta>();
+        if (!porta->openSerial(argv[i], baudrate, DATABITS_8, PARITY_NONE,
+                               STOPBITS_1, latencia)) {
+            printf("%-16s não foi possível abrir a porta\n", argv[i]);
+            continue;
+        }
+
+        Leitor<TimerPolicyWinUnix, Porta, LogPolicyNull> leitor(porta);
+        std::vector<uint64_t> amostras;
+        size_t falhas = 0;
+        for (size_t l = 0; l < leituras; l++) {
+            if (!leitor.leitura(
+                    comando, [](const resposta_t&) {},
+                    TIMEOUT_SEM_RESPOSTA_MS))
+                falhas++;
+            coletaAmostras(*porta, amostras);
+        }
+
+        if (amostras.empty()) {
+            printf("%-16s %5s %6zu sem amostras\n", argv[i],
+                   porta->baixaLatencia() ? "sim" : "não", falhas);
+        } else {
+            std::sort(amostras.begin(), amostras.end());
+            uint64_t soma = 0;
+            for (auto a : amostras)
+                soma += a;
+            size_t p99 = std::min(amostras.size() * 99 / 100,
+                                  amostras.size() - 1);
+            printf("%-16s %5s %6zu %9.1f %9.1f %9.1f %9.1f %8zu\n", argv[i],
+                   porta->baixaLatencia() ? "sim" : "não", falhas,
+                   us(amostras.front()), us(soma / amostras.size()),
+                   us(amostras[p99]), us(amostras.back()), amostras.size());
+        }
+        if (porta->trace().descartados())
+            printf("%-16s %zu registros de trace descartados\n", argv[i],
+                   porta->trace().descartados());
+
+        porta->closeSerial();
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+// vazão (bytes/s) das implementações de CRC16 sobre respostas de 258 bytes,
+// como na revalidação de arquivos de respostas brutas
+
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace NBR14522;
+
+static uint16_t CRC16BitABit(uint16_t crc, const byte_t* data,
+                             const size_t data_sz) {
+    for (size_t i = 0; i < data_sz; i++) {
+        crc ^= data[i];
+
+        size_t j = 8;
+        while (j--) {
+            if (crc & 0x0001)
+                crc = (crc >> 1) ^ 0xa001;
+            else
+                crc >>= 1;
+        }
+    }
+
+    return crc;
+}
+
+template <typename F>
+static void mede(const char* nome, const std::vector<resposta_t>& respostas,
+                 size_t repeticoes, F f) {
+    using clock = std::chrono::steady_clock;
+
+    uint32_t acumulado = 0; // evita que o compilador descarte o cálculo
+    auto inicio = clock::now();
+    for (size_t r = 0; r < repeticoes; r++)
+        acumulado += f(respostas);
+    std::chrono::duration<double> duracao = clock::now() - inicio;
+
+    double bytes =
+        static_cast<double>(respostas.size() * RESPOSTA_SZ * repeticoes);
+    printf("%-24s %10.1f MB/s  (%.3f s, verificador %u)\n", nome,
+           bytes / duracao.count() / 1e6, duracao.count(), acumulado);
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000;
+    const size_t repeticoes = 5;
+
+    std::vector<resposta_t> respostas(n);
+    uint32_t semente = 1;
+    for (auto& rsp : respostas) {
+        for (auto& b : rsp) {
+            semente = semente * 1103515245 + 12345;
+            b = static_cast<byte_t>(semente >> 16);
+        }
+        setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+    }
+
+    printf("%zu respostas de %zu bytes, %zu repetições\n", n, RESPOSTA_SZ,
+           repeticoes);
+
+    mede("bit a bit", respostas, repeticoes,
+         [](const std::vector<resposta_t>& rsps) {
+             uint32_t integras = 0;
+             for (const auto& rsp : rsps)
+                 integras += CRC16BitABit(0, rsp.data(), rsp.size()) == 0;
+             return integras;
+         });
+
+    mede("tabela slice-by-8", respostas, repeticoes,
+         [](const std::vector<resposta_t>& rsps) {
+             uint32_t integras = 0;
+             for (const auto& rsp : rsps)
+                 integras += CRC16UpdateTabela(0, rsp.data(), rsp.size()) == 0;
+             return integras;
+         });
+
+    if (CRC16ClmulDisponivel())
+        mede("CLMUL", respostas, repeticoes,
+             [](const std::vector<resposta_t>& rsps) {
+                 uint32_t integras = 0;
+                 for (const auto& rsp : rsps)
+                     integras +=
+                         CRC16UpdateClmul(0, rsp.data(), rsp.size()) == 0;
+                 return integras;
+             });
+    else
+        printf("CLMUL indisponível nesta CPU\n");
+
+    std::unique_ptr<bool[]> ok(new bool[n]);
+    mede("verifyCRC (em lote)", respostas, repeticoes,
+         [&](const std::vector<resposta_t>& rsps) {
+             return static_cast<uint32_t>(
+                 verifyCRC(rsps.data(), rsps.size(), ok.get()));
+         });
+
+    return 0;
+}
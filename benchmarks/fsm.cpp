@@ -0,0 +1,183 @@
+// vazão (bytes/s) do LeitorFSM sobre fluxos de bytes em memória, sem porta
+// serial e com o relógio virtual: isola o custo de processaEstado() e de
+// feed(). Três fluxos: respostas compostas (dominado pelos blocos de dados),
+// sinalizadores (WAIT, NAK e ENQ, um processaEstado() por byte) e ruído antes
+// do sincronismo. Mede também a classificação dos códigos de comando.
+
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <leitor_fsm.h>
+#include <memory>
+#include <timer/timer_policy_virtual.h>
+#include <vector>
+
+using namespace NBR14522;
+
+// porta que entrega um fluxo pré-gravado e descarta o que o leitor transmite
+class SerialPolicyFluxo {
+  public:
+    std::vector<byte_t> fluxo;
+    size_t lidos = 0;
+
+    size_t tx(const byte_t*, const size_t data_sz) { return data_sz; }
+    size_t rx(byte_t* data, const size_t max_data_sz) {
+        size_t sz = fluxo.size() - lidos;
+        if (sz > max_data_sz)
+            sz = max_data_sz;
+        memcpy(data, fluxo.data() + lidos, sz);
+        lidos += sz;
+        return sz;
+    }
+    // setComando() não descarta o fluxo
+    void descartaRx() {}
+};
+
+using Leitor = LeitorFSM<TimerPolicyVirtual, SerialPolicyFluxo>;
+
+static void adicionaResposta(std::vector<byte_t>& fluxo, const byte_t codigo,
+                             const bool ultima) {
+    resposta_t rsp;
+    rsp.fill(0x5A);
+    rsp.at(0) = codigo;
+    rsp.at(5) = ultima ? 0x10 : 0x00;
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+    fluxo.insert(fluxo.end(), rsp.begin(), rsp.end());
+}
+
+// uma leitura de comando composto com n respostas
+static std::vector<byte_t> fluxoComposto(const size_t n) {
+    std::vector<byte_t> fluxo = {ENQ, ENQ};
+    for (size_t i = 0; i < n; i++)
+        adicionaResposta(fluxo, 0x26, i == n - 1);
+    return fluxo;
+}
+
+// uma leitura de comando simples precedida de 4 KiB de ruído de linha
+static std::vector<byte_t> fluxoRuidoso() {
+    std::vector<byte_t> fluxo(4096);
+    for (size_t i = 0; i < fluxo.size(); i++)
+        fluxo[i] = static_cast<byte_t>(i * 7 + 1) == ENQ
+                       ? 0x00
+                       : static_cast<byte_t>(i * 7 + 1);
+    fluxo.push_back(ENQ);
+    fluxo.push_back(ENQ);
+    adicionaResposta(fluxo, 0x14, false);
+    return fluxo;
+}
+
+// uma leitura de comando simples precedida do máximo de sinalizadores
+// permitido pela norma
+static std::vector<byte_t> fluxoSinalizadores() {
+    std::vector<byte_t> fluxo = {ENQ, ENQ};
+    for (int i = 1; i < MAX_BLOCO_NAK; i++)
+        fluxo.push_back(NAK);
+    for (int i = 1; i < MAX_BLOCO_WAIT; i++)
+        fluxo.push_back(WAIT);
+    fluxo.push_back(ENQ);
+    adicionaResposta(fluxo, 0x14, false);
+    return fluxo;
+}
+
+static void mede(const char* nome, const std::vector<byte_t>& leitura,
+                 const byte_t codigo, const size_t leituras) {
+    using clock = std::chrono::steady_clock;
+
+    auto porta = std::make_shared<SerialPolicyFluxo>();
+    porta->fluxo.reserve(leitura.size() * leituras);
+    for (size_t i = 0; i < leituras; i++)
+        porta->fluxo.insert(porta->fluxo.end(), leitura.begin(),
+                            leitura.end());
+
+    Leitor leitor(porta);
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = codigo;
+
+    size_t sucessos = 0, chamadas = 0;
+    auto inicio = clock::now();
+    for (size_t i = 0; i < leituras; i++) {
+        leitor.setComando(cmd);
+        do
+            chamadas++;
+        while (leitor.processaEstado() !=
+               Leitor::estado_t::AguardaNovoComando);
+        sucessos += leitor.status() == Leitor::status_t::Sucesso;
+    }
+    std::chrono::duration<double> duracao = clock::now() - inicio;
+
+    printf("%-20s %8.1f MB/s %6.2f ns/processaEstado() (%zu/%zu leituras)\n",
+           nome, porta->lidos / duracao.count() / 1e6,
+           duracao.count() * 1e9 / chamadas, sucessos, leituras);
+}
+
+// o mesmo, com os bytes entregues por feed() em blocos de até bloco bytes
+static void medeFeed(const char* nome, const std::vector<byte_t>& leitura,
+                     const byte_t codigo, const size_t leituras,
+                     const size_t bloco) {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<byte_t> fluxo;
+    fluxo.reserve(leitura.size() * leituras);
+    for (size_t i = 0; i < leituras; i++)
+        fluxo.insert(fluxo.end(), leitura.begin(), leitura.end());
+
+    Leitor leitor(std::make_shared<SerialPolicyFluxo>());
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = codigo;
+
+    size_t sucessos = 0, chamadas = 0, i = 0;
+    auto inicio = clock::now();
+    for (size_t l = 0; l < leituras; l++) {
+        leitor.setComando(cmd);
+        Leitor::feed_t r;
+        do {
+            size_t n = fluxo.size() - i < bloco ? fluxo.size() - i : bloco;
+            r = leitor.feed(fluxo.data() + i, n);
+            i += r.consumidos;
+            chamadas++;
+        } while (!(r.eventos & Leitor::FeedConcluido));
+        sucessos += leitor.status() == Leitor::status_t::Sucesso;
+    }
+    std::chrono::duration<double> duracao = clock::now() - inicio;
+
+    printf("%-20s %8.1f MB/s %6.2f ns/feed()          (%zu/%zu leituras)\n",
+           nome, i / duracao.count() / 1e6, duracao.count() * 1e9 / chamadas,
+           sucessos, leituras);
+}
+
+int main(int argc, char* argv[]) {
+    size_t leituras = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000;
+
+    printf("%zu leituras por fluxo\n", leituras);
+    mede("respostas compostas", fluxoComposto(8), 0x26, leituras / 8);
+    mede("sinalizadores", fluxoSinalizadores(), 0x14, leituras);
+    mede("ruído", fluxoRuidoso(), 0x14, leituras / 16);
+
+    for (size_t bloco : {64, 4096}) {
+        printf("feed() em blocos de %zu bytes\n", bloco);
+        medeFeed("respostas compostas", fluxoComposto(8), 0x26, leituras / 8,
+                 bloco);
+        medeFeed("sinalizadores", fluxoSinalizadores(), 0x14, leituras,
+                 bloco);
+        medeFeed("ruído", fluxoRuidoso(), 0x14, leituras / 16, bloco);
+    }
+
+    // classificação de todos os códigos possíveis
+    using clock = std::chrono::steady_clock;
+    const size_t repeticoes = 1000000;
+    uint32_t validos = 0;
+    auto inicio = clock::now();
+    for (size_t r = 0; r < repeticoes; r++)
+        for (unsigned c = 0; c < 256; c++)
+            validos += isValidCodeCommand(static_cast<byte_t>(c ^ r));
+    std::chrono::duration<double> duracao = clock::now() - inicio;
+    printf("%-20s %8.2f ns/código (verificador %u)\n", "isValidCodeCommand",
+           duracao.count() * 1e9 / (repeticoes * 256), validos);
+
+    return EXIT_SUCCESS;
+}
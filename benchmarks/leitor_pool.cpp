@@ -0,0 +1,205 @@
+// escalabilidade de LeitorPool com 1..N workers: M medidores simulados atrás
+// de ptys (ver include/medidor_simulado.h), atendidos por uma thread à parte,
+// e J jobs de dois comandos por medidor. Reporta comandos por segundo, o
+// tempo de CPU das threads do leitor por comando, a linha ociosa (aguardando
+// ENQ) antes de cada comando, a menor margem até TMAXSINC nas respostas aos
+// ENQs (e quantas a excederam) e os jobs roubados.
+//
+// Os medidores transmitem ENQ no período mínimo da norma (TMINENQ_MSEC, mais
+// uma folga para a thread dos medidores): períodos menores fazem o ENQ
+// seguinte chegar depois do comando e quebram a sequência sob carga.
+
+#include <NBR14522.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <leitor_pool.h>
+#include <medidor_simulado.h>
+#include <memory>
+#include <poll.h>
+#include <serial/serial_policy_unix.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <timer/timer_policy_generic_os.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace NBR14522;
+
+using Porta = SerialPolicyUnix<>;
+using Pool = LeitorPool<TimerPolicyWinUnix, Porta>;
+
+// período de ENQ dos medidores simulados, em ms
+constexpr uint32_t PERIODO_ENQ_MS = TMINENQ_MSEC + 10;
+
+static double cpuThread() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpuProcesso() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// medidores simulados no lado mestre dos ptys, atendidos por uma thread
+class Medidores {
+  public:
+    Medidores(const size_t n) {
+        MedidorSimulado::configuracao_t cfg =
+            MedidorSimulado::configuracaoPadrao();
+        cfg.periodoEnq_ms = PERIODO_ENQ_MS;
+        cfg.respostasCompostas = 2;
+        for (size_t i = 0; i < n; i++) {
+            int mestre = posix_openpt(O_RDWR | O_NOCTTY);
+            if (mestre < 0 || grantpt(mestre) || unlockpt(mestre))
+                break;
+            fcntl(mestre, F_SETFL, fcntl(mestre, F_GETFL) | O_NONBLOCK);
+            _pfds.push_back({mestre, POLLIN, 0});
+            escravos.push_back(ptsname(mestre));
+            _medidores.emplace_back(cfg);
+        }
+    }
+
+    ~Medidores() {
+        para();
+        for (auto& pfd : _pfds)
+            close(pfd.fd);
+    }
+
+    void inicia() {
+        _thread = std::thread([this]() { _executa(); });
+    }
+
+    void para() {
+        _encerrar = true;
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    // tempo de CPU da thread dos medidores, em s
+    double cpu() const { return _cpu; }
+
+    std::vector<std::string> escravos;
+
+  private:
+    std::vector<struct pollfd> _pfds;
+    std::vector<MedidorSimulado> _medidores;
+    std::atomic<bool> _encerrar{false};
+    std::atomic<double> _cpu{0};
+    std::thread _thread;
+
+    void _executa() {
+        while (!_encerrar) {
+            poll(_pfds.data(), _pfds.size(), 1);
+            auto agora = MedidorSimulado::clock::now();
+            for (size_t i = 0; i < _pfds.size(); i++) {
+                byte_t buf[RESPOSTA_SZ];
+                ssize_t n;
+                while ((n = read(_pfds[i].fd, buf, sizeof(buf))) > 0)
+                    _medidores[i].recebe(buf, static_cast<size_t>(n), agora);
+                size_t sz = _medidores[i].transmite(buf, sizeof(buf), agora);
+                if (sz && write(_pfds[i].fd, buf, sz) < 0)
+                    perror("write");
+            }
+            _cpu = cpuThread();
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 64;
+    size_t maxWorkers = argc > 2 ? static_cast<size_t>(atol(argv[2]))
+                                 : std::thread::hardware_concurrency();
+    size_t jobsPorMedidor =
+        argc > 3 ? static_cast<size_t>(atol(argv[3])) : 4;
+    if (!maxWorkers)
+        maxWorkers = 1;
+
+    comando_t simples, composto;
+    simples.fill(0x00);
+    simples.at(0) = 0x14;
+    composto.fill(0x00);
+    composto.at(0) = 0x26;
+
+    printf("%zu medidores, %zu jobs de 2 comandos por medidor, %zu núcleos\n",
+           n, jobsPorMedidor, static_cast<size_t>(
+                                  std::thread::hardware_concurrency()));
+    printf("%7s %10s %12s %14s %12s %15s %9s %7s\n", "workers",
+           "parede (s)", "comandos/s", "CPU leitor/cmd", "ociosa/cmd",
+           "margem TMAXSINC", "roubados", "falhas");
+
+    for (size_t workers = 1; workers <= maxWorkers; workers++) {
+        Medidores medidores(n);
+        if (medidores.escravos.size() != n) {
+            printf("não foi possível abrir %zu ptys\n", n);
+            return EXIT_FAILURE;
+        }
+
+        // a mesma concorrência total (todos os medidores ao mesmo tempo) em
+        // todas as rodadas: só a divisão entre os workers muda
+        Pool pool(workers, (n + workers - 1) / workers);
+        for (auto& escravo : medidores.escravos) {
+            auto porta = std::make_shared<Porta>();
+            if (!porta->openSerial(escravo.c_str())) {
+                perror(escravo.c_str());
+                return EXIT_FAILURE;
+            }
+            pool.adiciona(porta);
+        }
+        medidores.inicia();
+
+        double cpu = cpuProcesso();
+        auto inicio = std::chrono::steady_clock::now();
+        pool.inicia();
+        for (size_t j = 0; j < jobsPorMedidor; j++) {
+            for (size_t porta = 0; porta < n; porta++) {
+                Pool::job_t job;
+                job.porta = porta;
+                job.comandos = {simples, composto};
+                job.timeout_resposta_ms = 2000;
+                pool.submete(job);
+            }
+        }
+        pool.aguarda();
+        std::chrono::duration<double> parede =
+            std::chrono::steady_clock::now() - inicio;
+        pool.encerra();
+        medidores.para();
+        // CPU do processo, exceto a da thread dos medidores simulados
+        cpu = cpuProcesso() - cpu - medidores.cpu();
+
+        uint64_t comandos = 0, roubados = 0, falhas = 0, transmitidos = 0;
+        std::chrono::duration<double, std::milli> ociosidade(0);
+        std::chrono::duration<double, std::milli> margem(
+            std::chrono::nanoseconds::max());
+        uint64_t foraDeTmaxsinc = 0;
+        for (auto& e : pool.estatisticas()) {
+            comandos += e.comandos;
+            roubados += e.roubados;
+            falhas += e.falhas;
+            transmitidos += e.transmitidos;
+            ociosidade += e.ociosidade;
+            foraDeTmaxsinc += e.foraDeTmaxsinc;
+            if (e.respostasEnq && e.margemMinima < margem)
+                margem = e.margemMinima;
+        }
+        printf("%7zu %10.3f %12.0f %11.1f us %9.1f ms %6.2f ms (%3llu) "
+               "%9llu %7llu\n",
+               workers, parede.count(), comandos / parede.count(),
+               comandos ? cpu * 1e6 / comandos : 0.0,
+               transmitidos ? ociosidade.count() / transmitidos : 0.0,
+               margem.count(),
+               static_cast<unsigned long long>(foraDeTmaxsinc),
+               static_cast<unsigned long long>(roubados),
+               static_cast<unsigned long long>(falhas));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+// sessões por segundo de LeitorFSM reproduzindo uma captura (ver
+// serial/serial_policy_replay.h) em tempo acelerado: mede o custo da pilha do
+// protocolo sem o medidor e sem a porta serial
+
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <leitor_fsm.h>
+#include <memory>
+#include <serial/captura.h>
+#include <serial/serial_policy_replay.h>
+#include <timer/timer_policy_generic_os.h>
+
+using namespace NBR14522;
+
+// sessão sintética de um comando composto com n respostas, como gravada por
+// SerialPolicyGravador
+static Captura sessaoComposta(const byte_t codigo, const size_t n) {
+    Captura captura;
+    uint64_t t = 0;
+    const byte_t enq = ENQ;
+    const byte_t ack = ACK;
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = codigo;
+    setCRC(cmd, CRC16(cmd.data(), cmd.size() - 2));
+
+    // o primeiro ENQ é descartado por setComando()
+    captura.adiciona(TRACE_RX, t, &enq, 1);
+    captura.adiciona(TRACE_RX, t += 500000000, &enq, 1);
+    captura.adiciona(TRACE_RX, t += 500000000, &enq, 1);
+    captura.adiciona(TRACE_TX, t += 100000, cmd.data(), cmd.size());
+
+    for (size_t i = 0; i < n; i++) {
+        resposta_t rsp;
+        rsp.fill(static_cast<byte_t>(i));
+        rsp.at(0) = codigo;
+        rsp.at(5) = i == n - 1 ? 0x10 : 0x00;
+        setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+
+        captura.adiciona(TRACE_RX, t += 20000000, rsp.data(), 1);
+        captura.adiciona(TRACE_RX, t += 30000000, rsp.data() + 1,
+                         rsp.size() - 1);
+        captura.adiciona(TRACE_TX, t += 100000, &ack, 1);
+    }
+
+    return captura;
+}
+
+int main(int argc, char* argv[]) {
+    using clock = std::chrono::steady_clock;
+    using Leitor = LeitorFSM<TimerPolicyWinUnix, SerialPolicyReplay>;
+
+    size_t sessoes = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 20000;
+    const size_t respostasPorSessao = 8;
+
+    auto captura = std::make_shared<const Captura>(
+        sessaoComposta(0x26, respostasPorSessao));
+    sptr<SerialPolicyReplay> replay = std::make_shared<SerialPolicyReplay>(
+        captura, SerialPolicyReplay::TEMPO_ACELERADO);
+    Leitor leitor(replay);
+
+    size_t respostas = 0;
+    leitor.setCallback([&](const resposta_t&) { respostas++; });
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x26;
+
+    size_t falhas = 0;
+    auto inicio = clock::now();
+    for (size_t s = 0; s < sessoes; s++) {
+        replay->reinicia();
+        leitor.setComando(cmd);
+        while (leitor.processaEstado() != Leitor::estado_t::AguardaNovoComando)
+            ;
+        if (leitor.status() != Leitor::status_t::Sucesso ||
+            replay->divergencias())
+            falhas++;
+    }
+    std::chrono::duration<double> duracao = clock::now() - inicio;
+
+    double bytes = static_cast<double>(sessoes * respostasPorSessao *
+                                       (RESPOSTA_SZ + 1)) +
+                   static_cast<double>(sessoes * (COMANDO_SZ + 3));
+    printf("%zu sessões de %zu respostas em %.3f s\n", sessoes,
+           respostasPorSessao, duracao.count());
+    printf("%10.0f sessões/s  %10.1f MB/s  (%zu respostas, %zu falhas)\n",
+           sessoes / duracao.count(), bytes / duracao.count() / 1e6,
+           respostas, falhas);
+
+    return falhas ? 1 : 0;
+}
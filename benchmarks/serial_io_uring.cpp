@@ -0,0 +1,174 @@
+// SerialPolicyIoUring x SerialPolicyUnix com N pares de pseudo-terminais: a
+// cada rodada o lado "medidor" de cada pty escreve uma resposta, em pedaços
+// como chegariam pela linha serial, e o lado do leitor recebe todas. Reporta o
+// tempo de CPU e as syscalls de recepção.
+
+#include <NBR14522.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <memory>
+#include <serial/serial_policy_io_uring.h>
+#include <serial/serial_policy_unix.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace NBR14522;
+
+// lado mestre (medidor) de um pty
+class Pty {
+  public:
+    Pty() {
+        _mestre = posix_openpt(O_RDWR | O_NOCTTY);
+        if (_mestre >= 0 && !grantpt(_mestre) && !unlockpt(_mestre))
+            _escravo = ptsname(_mestre);
+    }
+    ~Pty() {
+        if (_mestre >= 0)
+            close(_mestre);
+    }
+
+    bool ok() const { return !_escravo.empty(); }
+    const char* escravo() const { return _escravo.c_str(); }
+    void escreve(const byte_t* data, size_t data_sz) {
+        if (write(_mestre, data, data_sz) != static_cast<ssize_t>(data_sz))
+            perror("write");
+    }
+
+  private:
+    int _mestre = -1;
+    std::string _escravo;
+};
+
+// pedaços em que cada resposta chega ao leitor
+constexpr size_t PEDACO_SZ = 32;
+
+typedef struct {
+    double cpu_s;
+    double parede_s;
+    unsigned long long syscalls;
+} resultado_t;
+
+// recebe uma resposta de cada porta por rodada. Porta deve ter rx() e
+// aguardaRx(); espera() é chamada quando nenhuma porta tem dados.
+template <class Porta, class Espera>
+static resultado_t mede(std::vector<std::unique_ptr<Pty>>& ptys,
+                        std::vector<std::unique_ptr<Porta>>& portas,
+                        const size_t rodadas, Espera espera) {
+    using clock = std::chrono::steady_clock;
+
+    resposta_t rsp;
+    rsp.fill(0x5A);
+    std::vector<size_t> lidos(portas.size());
+    byte_t buf[RESPOSTA_SZ];
+
+    std::clock_t cpu = std::clock();
+    auto inicio = clock::now();
+    for (size_t r = 0; r < rodadas; r++) {
+        std::fill(lidos.begin(), lidos.end(), 0);
+
+        for (size_t escritos = 0; escritos < RESPOSTA_SZ;) {
+            size_t pedaco = std::min(PEDACO_SZ, RESPOSTA_SZ - escritos);
+            for (auto& pty : ptys)
+                pty->escreve(rsp.data() + escritos, pedaco);
+            escritos += pedaco;
+
+            // o leitor varre as portas até receber o pedaço de todas
+            size_t completas = 0;
+            while (completas < portas.size()) {
+                bool progresso = false;
+                completas = 0;
+                for (size_t i = 0; i < portas.size(); i++) {
+                    if (lidos[i] < escritos) {
+                        // como o LeitorFSM: código, depois o restante
+                        size_t n = portas[i]->rx(
+                            buf, lidos[i] ? RESPOSTA_SZ - lidos[i] : 1);
+                        lidos[i] += n;
+                        progresso |= n > 0;
+                    }
+                    completas += lidos[i] == escritos;
+                }
+                if (!progresso)
+                    espera();
+            }
+        }
+    }
+
+    std::chrono::duration<double> parede = clock::now() - inicio;
+    return {static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC,
+            parede.count(), 0};
+}
+
+static void imprime(const char* nome, const resultado_t& r, size_t portas,
+                    size_t rodadas) {
+    double respostas = static_cast<double>(portas * rodadas);
+    printf("%-22s CPU %7.3f s  parede %7.3f s  %8.2f syscalls/resposta\n",
+           nome, r.cpu_s, r.parede_s, r.syscalls / respostas);
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 64;
+    size_t rodadas = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 200;
+
+    std::vector<std::unique_ptr<Pty>> ptys;
+    for (size_t i = 0; i < n; i++) {
+        ptys.emplace_back(new Pty());
+        if (!ptys.back()->ok()) {
+            printf("não foi possível abrir %zu ptys\n", n);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("%zu portas, %zu rodadas de uma resposta por porta\n", n,
+           rodadas);
+
+    {
+        std::vector<std::unique_ptr<SerialPolicyUnix<>>> portas;
+        for (auto& pty : ptys) {
+            portas.emplace_back(new SerialPolicyUnix<>());
+            portas.back()->openSerial(pty->escravo());
+        }
+        // sem um poll(2) por grupo de portas, cada porta aguarda a sua vez
+        resultado_t r = mede(ptys, portas, rodadas, [&]() {
+            portas.front()->aguardaRx(std::chrono::steady_clock::now() +
+                                      std::chrono::milliseconds(1));
+        });
+        for (auto& porta : portas)
+            r.syscalls += porta->estatisticas().leituras +
+                          porta->estatisticas().esperas;
+        imprime("SerialPolicyUnix", r, n, rodadas);
+    }
+
+    for (bool habilitado : {true, false}) {
+        auto anel = std::make_shared<AnelIoUring>(n, habilitado);
+        if (habilitado && !anel->disponivel()) {
+            printf("io_uring indisponível\n");
+            continue;
+        }
+
+        std::vector<std::unique_ptr<SerialPolicyIoUring>> portas;
+        for (auto& pty : ptys) {
+            portas.emplace_back(new SerialPolicyIoUring(anel));
+            portas.back()->openSerial(pty->escravo());
+        }
+        resultado_t r = mede(ptys, portas, rodadas, [&]() {
+            if (anel->disponivel())
+                anel->processa(1);
+            else
+                portas.front()->aguardaRx(std::chrono::steady_clock::now() +
+                                          std::chrono::milliseconds(1));
+        });
+        r.syscalls = anel->chamadas();
+        for (auto& porta : portas)
+            r.syscalls += porta->estatisticas().leituras +
+                          porta->estatisticas().esperas;
+        imprime(habilitado ? "SerialPolicyIoUring" : "  (fallback)", r, n,
+                rodadas);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+// custo dos timers do protocolo com S sessões simultâneas: a roda de timers
+// (timer/roda_timers.h) contra o heap com gerações usado pelo LeitorReactor
+// com TimerPolicyWinUnix, e contra o laço ingênuo que chama timedOut() de
+// cada sessão a cada iteração (uma leitura do relógio por sessão).
+//
+// Tempo simulado em passos de 1 ms: a cada passo, R sessões rearmam seu timer
+// (como ao receber um byte) com um dos timeouts da norma, e os timers
+// vencidos são rearmados ao expirar.
+
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <timer/roda_timers.h>
+#include <timer/timer_policy_generic_os.h>
+#include <vector>
+
+using namespace NBR14522;
+using relogio = std::chrono::steady_clock;
+
+static const uint32_t TIMEOUTS_MS[] = {TMAXCAR_MSEC, TMAXENQ_MSEC,
+                                       TMAXRSP_MSEC, TSEMWAIT_SEC * 1000};
+
+// sequência de (sessão, timeout) dos rearmes, igual para todas as medições
+static std::vector<std::pair<size_t, uint32_t>>
+rearmes(size_t sessoes, size_t total) {
+    std::mt19937 gerador(14522);
+    std::uniform_int_distribution<size_t> sessao(0, sessoes - 1);
+    // TSEMWAIT é raro
+    std::discrete_distribution<size_t> timeout({40, 20, 39, 1});
+    std::vector<std::pair<size_t, uint32_t>> r(total);
+    for (auto& x : r)
+        x = {sessao(gerador), TIMEOUTS_MS[timeout(gerador)]};
+    return r;
+}
+
+static void reporta(const char* nome, std::chrono::duration<double> d,
+                    size_t operacoes, size_t expirados) {
+    printf("%-28s %9.1f ns/op %10zu expirados\n", nome,
+           d.count() * 1e9 / operacoes, expirados);
+}
+
+static void roda(size_t sessoes, size_t passos, size_t porPasso,
+                 const std::vector<std::pair<size_t, uint32_t>>& r) {
+    const auto inicio = RodaDeTimers::clock::now();
+    RodaDeTimers roda(inicio);
+    std::vector<std::unique_ptr<RodaDeTimers::Timer>> timers;
+    size_t expirados = 0;
+    std::chrono::milliseconds agora(0);
+    for (size_t i = 0; i < sessoes; i++) {
+        timers.emplace_back(new RodaDeTimers::Timer());
+        RodaDeTimers::Timer* t = timers.back().get();
+        t->aoExpirar([&, t]() {
+            expirados++;
+            roda.arma(*t, inicio + agora + std::chrono::milliseconds(
+                                                TMAXENQ_MSEC));
+        });
+        roda.arma(*t, inicio + std::chrono::milliseconds(TMAXENQ_MSEC));
+    }
+
+    auto t0 = relogio::now();
+    for (size_t p = 0, k = 0; p < passos; p++) {
+        agora = std::chrono::milliseconds(p + 1);
+        for (size_t j = 0; j < porPasso; j++, k++)
+            roda.arma(*timers[r[k].first],
+                      inicio + agora + std::chrono::milliseconds(r[k].second));
+        roda.avanca(inicio + agora);
+    }
+    reporta("roda de timers", relogio::now() - t0, passos * porPasso,
+            expirados);
+}
+
+static void heap(size_t sessoes, size_t passos, size_t porPasso,
+                 const std::vector<std::pair<size_t, uint32_t>>& r) {
+    typedef struct {
+        uint64_t deadline;
+        size_t sessao;
+        uint32_t geracao;
+    } timer_t;
+    struct posterior {
+        bool operator()(const timer_t& a, const timer_t& b) const {
+            return a.deadline > b.deadline;
+        }
+    };
+    std::priority_queue<timer_t, std::vector<timer_t>, posterior> timers;
+    std::vector<uint32_t> geracoes(sessoes, 0);
+    size_t expirados = 0;
+    for (size_t i = 0; i < sessoes; i++)
+        timers.push({TMAXENQ_MSEC, i, 0});
+
+    auto t0 = relogio::now();
+    for (size_t p = 0, k = 0; p < passos; p++) {
+        const uint64_t agora = p + 1;
+        for (size_t j = 0; j < porPasso; j++, k++) {
+            const size_t s = r[k].first;
+            timers.push({agora + r[k].second, s, ++geracoes[s]});
+        }
+        while (!timers.empty() && timers.top().deadline <= agora) {
+            timer_t t = timers.top();
+            timers.pop();
+            if (t.geracao != geracoes[t.sessao])
+                continue;
+            expirados++;
+            timers.push({agora + TMAXENQ_MSEC, t.sessao, ++geracoes[t.sessao]});
+        }
+    }
+    reporta("heap com gerações", relogio::now() - t0, passos * porPasso,
+            expirados);
+}
+
+static void polling(size_t sessoes, size_t passos, size_t porPasso,
+                    const std::vector<std::pair<size_t, uint32_t>>& r) {
+    std::vector<TimerPolicyWinUnix> timers(sessoes);
+    for (auto& t : timers)
+        t.setTimeout(TMAXENQ_MSEC);
+    size_t expirados = 0;
+
+    // tempo real: poucos passos, pois cada um lê o relógio S vezes
+    auto t0 = relogio::now();
+    for (size_t p = 0, k = 0; p < passos; p++) {
+        for (size_t j = 0; j < porPasso; j++, k++)
+            timers[r[k].first].setTimeout(r[k].second);
+        for (auto& t : timers) {
+            if (t.timedOut()) {
+                expirados++;
+                t.setTimeout(TMAXENQ_MSEC);
+            }
+        }
+    }
+    reporta("timedOut() por sessão", relogio::now() - t0,
+            passos * porPasso, expirados);
+}
+
+int main(int argc, char* argv[]) {
+    size_t sessoes = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 10000;
+    size_t passos = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 20000;
+    size_t porPasso = argc > 3 ? static_cast<size_t>(atol(argv[3])) : 100;
+    if (!sessoes || !passos)
+        return EXIT_FAILURE;
+
+    auto r = rearmes(sessoes, passos * porPasso);
+    printf("%zu sessões, %zu passos de 1 ms, %zu rearmes por passo\n", sessoes,
+           passos, porPasso);
+    roda(sessoes, passos, porPasso, r);
+    heap(sessoes, passos, porPasso, r);
+    polling(sessoes, passos / 100, porPasso, r);
+
+    return EXIT_SUCCESS;
+}
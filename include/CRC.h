@@ -5,4 +5,90 @@
 // NBR14522 uses CRC16 (X16 + X15 + X2 + 1) i.e. 0x8005 (MSB-first code) or
 // 0xA001 (LSB-first code)
 
+// tabelas do algoritmo slice-by-8: CRC16Tabela.t[k][b] é o CRC do byte b
+// seguido de k bytes nulos. A tabela 0 é a tabela clássica de 256 entradas.
+struct CRC16Tabelas {
+    uint16_t t[8][256];
+};
+
+extern const CRC16Tabelas CRC16Tabela;
+
 uint16_t CRC16(const byte_t* data, const size_t data_sz);
+
+// continua o cálculo de um CRC já iniciado (crc) sobre mais data_sz bytes.
+// Seleciona em tempo de execução a implementação mais rápida para a CPU.
+uint16_t CRC16Update(uint16_t crc, const byte_t* data, const size_t data_sz);
+
+// implementações específicas normalmente selecionadas por CRC16Update(): a
+// portável (tabelas slice-by-8) e a por multiplicação sem carry (PCLMULQDQ),
+// que só deve ser chamada se CRC16ClmulDisponivel() retornar true
+uint16_t CRC16UpdateTabela(uint16_t crc, const byte_t* data,
+                           const size_t data_sz);
+uint16_t CRC16UpdateClmul(uint16_t crc, const byte_t* data,
+                          const size_t data_sz);
+bool CRC16ClmulDisponivel();
+
+// CRC da mensagem seguida de n bytes nulos, a partir do CRC da mensagem
+uint16_t CRC16Shift(const uint16_t crc, const size_t n);
+
+// CRC da concatenação de A e B a partir dos CRCs de A e de B (e do tamanho de
+// B), sem percorrer os dados
+uint16_t CRC16Combine(const uint16_t crcA, const uint16_t crcB,
+                      const size_t lenB);
+
+// atualiza o CRC de uma mensagem de data_sz bytes após a substituição de sz
+// bytes a partir de offset (de antigos para novos), em O(sz) e sem percorrer o
+// restante da mensagem
+uint16_t CRC16Patch(const uint16_t crc, const size_t data_sz,
+                    const size_t offset, const byte_t* antigos,
+                    const byte_t* novos, const size_t sz);
+
+// verifica o CRC de n respostas de uma só vez, escrevendo em ok[i] se a
+// resposta i está íntegra. Retorna o número de respostas íntegras.
+size_t verifyCRC(const NBR14522::resposta_t* frames, const size_t n,
+                 bool* ok);
+
+// cálculo incremental do CRC16, permitindo acumular os bytes à medida que são
+// recebidos. Obs.: o CRC calculado sobre os dados seguidos do seu próprio CRC
+// (LSB primeiro, como transmitido na NBR14522) resulta em zero, o que permite
+// validar uma resposta completa sem percorrê-la novamente.
+class CRC16State {
+  public:
+    void init(const uint16_t crc = 0x0000) { _crc = crc; }
+
+    void update(const byte_t data) {
+        _crc = (_crc >> 8) ^ CRC16Tabela.t[0][(_crc ^ data) & 0xFF];
+    }
+
+    void update(const byte_t* data, const size_t data_sz) {
+        _crc = CRC16Update(_crc, data, data_sz);
+    }
+
+    uint16_t finalize() const { return _crc; }
+
+  private:
+    uint16_t _crc = 0x0000;
+};
+
+namespace NBR14522 {
+
+// substitui sz bytes de um comando (ou resposta) a partir de offset e atualiza
+// seu CRC incrementalmente. O CRC do comando deve estar correto antes da
+// substituição (e.g. um comando modelo com CRC já calculado).
+template <size_t S>
+void patchBytes(std::array<byte_t, S>& cmd_ou_rsp, const size_t offset,
+                const byte_t* data, const size_t sz) {
+    uint16_t crc = CRC16Patch(getCRC(cmd_ou_rsp), S - 2, offset,
+                              &cmd_ou_rsp.at(offset), data, sz);
+    for (size_t i = 0; i < sz; i++)
+        cmd_ou_rsp.at(offset + i) = data[i];
+    setCRC(cmd_ou_rsp, crc);
+}
+
+// número de série do leitor: bytes 002 a 004 do comando
+inline void setNumSerieLeitor(comando_t& comando,
+                              const leitor_num_serie_t& num) {
+    patchBytes(comando, 1, num.data(), num.size());
+}
+
+} // namespace NBR14522
@@ -41,27 +41,6 @@ inline medidor_num_serie_t getNumSerieMedidor(resposta_t& resposta) {
     return num;
 }
 
-inline bool isValidCodeCommand(byte_t code) {
-    // TODO: realizar verificação em O(1) (lookup table?)
-
-    static const byte_t codes[] = {0x14, 0x20, 0x21, 0x22, 0x51, 0x23, 0x24,
-                                   0x41, 0x44, 0x42, 0x43, 0x45, 0x46, 0x25,
-                                   0x26, 0x27, 0x52, 0x28, 0x80};
-
-    for (size_t i = 0; i < sizeof(codes); i++)
-        if (code == codes[i])
-            return true;
-
-    return false;
-}
-
-inline bool isComposedCodeCommand(byte_t code) {
-    if (code == 0x26 || code == 0x27 || code == 0x52)
-        return true;
-    else
-        return false;
-}
-
 inline bool isLastRespostaOfComposed(const resposta_t& rsp) {
     return rsp.at(5) & 0x10;
 }
@@ -119,4 +98,60 @@ enum Regra {
 constexpr byte_t CodigoInformacaoDeComandoNaoImplementado = 0x39;
 constexpr byte_t CodigoInformacaoDeOcorrenciaNoMedidor = 0x40;
 
+// classe de cada byte recebido pelo leitor
+enum ClasseByte : byte_t {
+    ClasseOutro,
+    ClasseENQ,
+    ClasseACK,
+    ClasseNAK,
+    ClasseWAIT,
+    ClasseCodigoDeComando,
+    // CodigoInformacaoDe*, em resposta a qualquer comando
+    ClasseCodigoDeInformacao,
+};
+
+// classificação dos 256 valores de byte, calculada em tempo de compilação:
+// isValidCodeCommand(), isComposedCodeCommand() e classeByte() são O(1)
+struct TabelaBytes {
+    byte_t classe[256];
+    bool composto[256];
+
+    constexpr TabelaBytes() : classe(), composto() {
+        const byte_t comandos[] = {0x14, 0x20, 0x21, 0x22, 0x51, 0x23, 0x24,
+                                   0x41, 0x44, 0x42, 0x43, 0x45, 0x46, 0x25,
+                                   0x26, 0x27, 0x52, 0x28, 0x80};
+        const byte_t compostos[] = {0x26, 0x27, 0x52};
+
+        for (byte_t c : comandos)
+            classe[c] = ClasseCodigoDeComando;
+        for (byte_t c : compostos)
+            composto[c] = true;
+        classe[ENQ] = ClasseENQ;
+        classe[ACK] = ClasseACK;
+        classe[NAK] = ClasseNAK;
+        classe[WAIT] = ClasseWAIT;
+        classe[CodigoInformacaoDeComandoNaoImplementado] =
+            ClasseCodigoDeInformacao;
+        classe[CodigoInformacaoDeOcorrenciaNoMedidor] =
+            ClasseCodigoDeInformacao;
+    }
+};
+
+inline const TabelaBytes& tabelaBytes() {
+    static constexpr TabelaBytes tabela{};
+    return tabela;
+}
+
+inline ClasseByte classeByte(byte_t byte) {
+    return static_cast<ClasseByte>(tabelaBytes().classe[byte]);
+}
+
+inline bool isValidCodeCommand(byte_t code) {
+    return classeByte(code) == ClasseCodigoDeComando;
+}
+
+inline bool isComposedCodeCommand(byte_t code) {
+    return tabelaBytes().composto[code];
+}
+
 } // namespace NBR14522
@@ -0,0 +1,139 @@
+#pragma once
+
+// Arena de blocos de resposta de uma sessão: as respostas são recebidas
+// diretamente em um bloco da arena (ProtocoloLeitor::recebeEm()) e, se o
+// consumidor as retém (retem()), entregues como views estáveis que devolvem o
+// bloco à arena ao serem destruídas. Os blocos são alocados em lotes e
+// reaproveitados por uma lista de livres: após a primeira leitura de um
+// comando composto (e.g. 0x52, memória de massa), as seguintes de mesmo
+// tamanho não alocam.
+//
+//     ArenaRespostas arena;
+//     protocolo.recebeEm(arena.recepcao());
+//     ...
+//     if (r.eventos & ProtocoloLeitor::EventoResposta) {
+//         respostas.push_back(arena.retem()); // sem cópia
+//         protocolo.recebeEm(arena.recepcao());
+//     }
+//
+// A arena deve sobreviver às views que entregou. maximoEmUso() informa o pico
+// de blocos em uso (retidos mais o de recepção).
+
+#include <NBR14522.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class ArenaRespostas {
+    struct bloco_t {
+        NBR14522::resposta_t resposta;
+        bloco_t* proximo; // lista de livres
+    };
+
+  public:
+    static constexpr std::size_t BLOCOS_POR_LOTE = 16;
+
+    // view de uma resposta retida; devolve o bloco ao ser destruída
+    class Resposta {
+      public:
+        Resposta() = default;
+        Resposta(Resposta&& outra)
+            : _arena(outra._arena), _bloco(outra._bloco) {
+            outra._bloco = nullptr;
+        }
+        Resposta& operator=(Resposta&& outra) {
+            if (this != &outra) {
+                libera();
+                _arena = outra._arena;
+                _bloco = outra._bloco;
+                outra._bloco = nullptr;
+            }
+            return *this;
+        }
+        Resposta(const Resposta&) = delete;
+        Resposta& operator=(const Resposta&) = delete;
+        ~Resposta() { libera(); }
+
+        const NBR14522::resposta_t& operator*() const {
+            return _bloco->resposta;
+        }
+        const NBR14522::resposta_t* operator->() const {
+            return &_bloco->resposta;
+        }
+        explicit operator bool() const { return _bloco != nullptr; }
+
+        // devolve o bloco antes da destruição
+        void libera() {
+            if (_bloco)
+                _arena->_devolve(_bloco);
+            _bloco = nullptr;
+        }
+
+      private:
+        friend class ArenaRespostas;
+        Resposta(ArenaRespostas* arena, bloco_t* bloco)
+            : _arena(arena), _bloco(bloco) {}
+
+        ArenaRespostas* _arena = nullptr;
+        bloco_t* _bloco = nullptr;
+    };
+
+    ArenaRespostas() = default;
+    ArenaRespostas(const ArenaRespostas&) = delete;
+    ArenaRespostas& operator=(const ArenaRespostas&) = delete;
+
+    // bloco em que a próxima resposta deve ser recebida; o mesmo até retem()
+    NBR14522::resposta_t* recepcao() {
+        if (!_recepcao)
+            _recepcao = _aloca();
+        return &_recepcao->resposta;
+    }
+
+    // retém a resposta recebida no bloco de recepção, que deixa de sê-lo:
+    // recepcao() passa a ser outro bloco
+    Resposta retem() {
+        bloco_t* bloco = _recepcao;
+        _recepcao = nullptr;
+        return Resposta(this, bloco);
+    }
+
+    // blocos em uso (retidos e de recepção), pico desde zeraMaximo() e
+    // blocos alocados
+    std::size_t emUso() const { return _emUso; }
+    std::size_t maximoEmUso() const { return _maximoEmUso; }
+    std::size_t blocos() const { return _lotes.size() * BLOCOS_POR_LOTE; }
+    // memória alocada, em bytes
+    std::size_t bytes() const { return blocos() * sizeof(bloco_t); }
+    void zeraMaximo() { _maximoEmUso = _emUso; }
+
+  private:
+    std::vector<std::unique_ptr<bloco_t[]>> _lotes;
+    bloco_t* _livres = nullptr;
+    bloco_t* _recepcao = nullptr;
+    std::size_t _emUso = 0;
+    std::size_t _maximoEmUso = 0;
+
+    bloco_t* _aloca() {
+        if (!_livres) {
+            _lotes.emplace_back(new bloco_t[BLOCOS_POR_LOTE]);
+            bloco_t* lote = _lotes.back().get();
+            for (std::size_t i = 0; i < BLOCOS_POR_LOTE; i++)
+                _devolveLivre(&lote[i]);
+        }
+        bloco_t* bloco = _livres;
+        _livres = bloco->proximo;
+        if (++_emUso > _maximoEmUso)
+            _maximoEmUso = _emUso;
+        return bloco;
+    }
+
+    void _devolve(bloco_t* bloco) {
+        _emUso--;
+        _devolveLivre(bloco);
+    }
+
+    void _devolveLivre(bloco_t* bloco) {
+        bloco->proximo = _livres;
+        _livres = bloco;
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+// Estimativa da cadência dos ENQs de um medidor: período e jitter médios dos
+// intervalos entre ENQs consecutivos, com as médias móveis exponenciais do
+// RTT do TCP (RFC 6298): período += (amostra - período) / 8 e
+// jitter += (|amostra - período| - jitter) / 4. Com ela, o leitor prevê o
+// próximo ENQ e pode acordar pouco antes dele, ao invés de depender do
+// instante em que a porta é consultada.
+//
+// Intervalos fora de [TMINENQ, TMAXENQ] não são amostras: ENQs lidos em um
+// mesmo bloco (instantes iguais) ou ENQs perdidos enquanto a porta não era
+// lida. Após uma troca com o medidor (comando e resposta), o medidor reinicia
+// a cadência: reinicia() marca a nova referência sem gerar amostra.
+
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdint>
+
+class CadenciaEnq {
+  public:
+    using clock = std::chrono::steady_clock;
+    using instante_t = clock::time_point;
+
+    // ENQ recebido em agora
+    void registra(const instante_t agora) {
+        if (_temReferencia && _ultimoFoiEnq) {
+            const clock::duration amostra = agora - _referencia;
+            if (amostra >= std::chrono::milliseconds(NBR14522::TMINENQ_MSEC) &&
+                amostra <= std::chrono::milliseconds(NBR14522::TMAXENQ_MSEC))
+                _amostra(amostra);
+        }
+        _referencia = agora;
+        _temReferencia = true;
+        _ultimoFoiEnq = true;
+    }
+
+    // fim de uma troca em agora: o próximo ENQ é esperado um período depois
+    void reinicia(const instante_t agora) {
+        _referencia = agora;
+        _temReferencia = true;
+        _ultimoFoiEnq = false;
+    }
+
+    // a referência deixa de valer (e.g. comando transmitido: o medidor não
+    // transmite ENQ até responder)
+    void invalida() { _temReferencia = false; }
+
+    // instante previsto do próximo ENQ, menos uma guarda de duas vezes o
+    // jitter: acordar nesse instante antecipa o ENQ na maioria dos casos.
+    // Retorna false sem amostras ou sem referência.
+    bool proximoEnq(instante_t& previsto) const {
+        if (!_amostras || !_temReferencia)
+            return false;
+        previsto = _referencia + _periodo - 2 * _jitter;
+        return true;
+    }
+
+    clock::duration periodo() const { return _periodo; }
+    clock::duration jitter() const { return _jitter; }
+    uint32_t amostras() const { return _amostras; }
+
+  private:
+    instante_t _referencia;
+    bool _temReferencia = false;
+    bool _ultimoFoiEnq = false; // referência é um ENQ (e não uma troca)
+    clock::duration _periodo = clock::duration::zero();
+    clock::duration _jitter = clock::duration::zero();
+    uint32_t _amostras = 0;
+
+    void _amostra(const clock::duration amostra) {
+        if (!_amostras++) {
+            _periodo = amostra;
+            _jitter = amostra / 2;
+            return;
+        }
+        const clock::duration desvio =
+            amostra > _periodo ? amostra - _periodo : _periodo - amostra;
+        _jitter += (desvio - _jitter) / 4;
+        _periodo += (amostra - _periodo) / 8;
+    }
+};
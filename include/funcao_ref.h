@@ -0,0 +1,45 @@
+#pragma once
+
+// Referência a uma função (lambda, functor) sem posse, como a function_ref
+// do C++26: guarda somente o endereço do objeto e um ponteiro para a função
+// que o chama. Ao contrário de std::function, não aloca nem copia o objeto,
+// e a chamada é indireta uma só vez. O objeto referenciado deve sobreviver à
+// referência.
+//
+//     auto callback = [&](const resposta_t& rsp) { ... };
+//     FuncaoRef<void(const resposta_t&)> ref(callback);
+//     ref(rsp);
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+template <class Assinatura> class FuncaoRef;
+
+template <class R, class... Args> class FuncaoRef<R(Args...)> {
+  public:
+    FuncaoRef() = default;
+    FuncaoRef(std::nullptr_t) {}
+
+    // somente lvalues: um temporário não sobreviveria à referência
+    template <class F, class = typename std::enable_if<!std::is_same<
+                           typename std::remove_cv<F>::type,
+                           FuncaoRef>::value>::type>
+    FuncaoRef(F& funcao)
+        : _objeto(const_cast<void*>(static_cast<const void*>(&funcao))),
+          _chama(&_invoca<F>) {}
+
+    R operator()(Args... args) const {
+        return _chama(_objeto, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const { return _chama != nullptr; }
+
+  private:
+    void* _objeto = nullptr;
+    R (*_chama)(void*, Args...) = nullptr;
+
+    template <class F> static R _invoca(void* objeto, Args... args) {
+        return (*static_cast<F*>(objeto))(std::forward<Args>(args)...);
+    }
+};
@@ -1,37 +1,47 @@
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <funcao_ref.h>
 #include <leitor_fsm.h>
 #include <log_policy.h>
+#include <utility>
 
 template <class TimerPolicy, class SerialPolicy,
           class LogPolicy = LogPolicyStdout>
 class Leitor {
 
-    using FSM = LeitorFSM<TimerPolicy, SerialPolicy>;
+    // o callback só é chamado durante leitura(), que o mantém vivo: basta
+    // uma referência a ele, sem std::function
+    using FSM = LeitorFSM<TimerPolicy, SerialPolicy,
+                          FuncaoRef<void(const NBR14522::resposta_t&)>>;
 
   public:
-    Leitor(sptr<SerialPolicy> porta) : _leitor(porta) {}
+    Leitor(sptr<SerialPolicy> porta) : _leitor(porta), _porta(porta.get()) {}
 
-    bool leitura(NBR14522::comando_t& comando,
-                 std::function<void(const NBR14522::resposta_t& rsp)> callback,
+    // porta sem posse, que deve sobreviver ao leitor
+    Leitor(SerialPolicy& porta) : _leitor(porta), _porta(&porta) {}
+
+    // callback: qualquer objeto chamável com a resposta, chamado
+    // diretamente, sem cópia nem alocação
+    template <class Callback>
+    bool leitura(NBR14522::comando_t& comando, Callback&& callback,
                  uint32_t timeout_resposta_ms = 0) {
 
         _leitor.setComando(comando);
-        _leitor.setCallback(callback);
 
         TimerPolicy leituraDeadline;
         if (timeout_resposta_ms)
             leituraDeadline.setTimeout(timeout_resposta_ms);
 
-        _leitor.setCallback([&](const NBR14522::resposta_t& rsp) {
+        auto trataResposta = [&](const NBR14522::resposta_t& rsp) {
             // reatualiza o timeout informado pelo usuário toda vez que uma
             // resposta é recebida pelo leitor
             if (timeout_resposta_ms)
                 leituraDeadline.setTimeout(timeout_resposta_ms);
 
             callback(rsp);
-        });
+        };
+        _leitor.setCallback(trataResposta);
 
         while (true) {
             typename FSM::estado_t estado = _leitor.processaEstado();
@@ -64,10 +74,53 @@ class Leitor {
                     _status2verbose(_leitor.status()));
                 return false;
             }
+
+            if (!_aguardaEvento(0, timeout_resposta_ms != 0,
+                                leituraDeadline)) {
+                LogPolicy::log("A porta foi fechada ou apresentou erro. "
+                               "Estado: %s, Status: %s\n",
+                               _estado2string(estado),
+                               _status2verbose(_leitor.status()));
+                return false;
+            }
         }
     }
 
+    // mantém o sincronismo entre leituras consecutivas: em uma sequência de
+    // comandos (e.g. leituraPadrao()), cada comando após o primeiro é
+    // transmitido no próximo ENQ do medidor (ver LeitorFSM::setSessao())
+    void setSessao(const bool sessao) { _leitor.setSessao(sessao); }
+
+    // ociosidade da linha antes dos comandos (ver LeitorFSM::metricas())
+    const ProtocoloLeitor::metricas_t& metricas() const {
+        return _leitor.metricas();
+    }
+
   private:
+    // se a porta permite aguardar a chegada de dados (aguardaRx) e o timer
+    // informa seu deadline, dorme até chegar um byte, até o próximo timeout do
+    // protocolo ou até o deadline do usuário, o que ocorrer primeiro. Retorna
+    // false se a porta foi fechada ou apresentou erro: aguardaRx() retornou
+    // sem dados antes do deadline, e rx() nunca mais terá o que ler
+    template <class S = SerialPolicy, class T = TimerPolicy>
+    auto _aguardaEvento(int, bool temDeadlineUsuario, const T& deadlineUsuario)
+        -> decltype(std::declval<S&>().aguardaRx(
+                        std::declval<const T&>().deadline()),
+                    bool()) {
+        using deadline_t = decltype(deadlineUsuario.deadline());
+
+        deadline_t deadline = deadline_t::max();
+        _leitor.proximoDeadline(deadline);
+        if (temDeadlineUsuario)
+            deadline = std::min(deadline, deadlineUsuario.deadline());
+
+        return _porta->aguardaRx(deadline) ||
+               deadline_t::clock::now() >= deadline;
+    }
+
+    // demais policies: processaEstado() é chamado continuamente
+    bool _aguardaEvento(long, bool, const TimerPolicy&) { return true; }
+
     const char* _estado2string(const typename FSM::estado_t estado) {
         switch (estado) {
         case FSM::estado_t::Dessincronizado:
@@ -123,4 +176,5 @@ class Leitor {
     }
 
     FSM _leitor;
+    SerialPolicy* _porta; // a posse, se houver, é do _leitor
 };
@@ -0,0 +1,286 @@
+#pragma once
+
+// Interface com corrotinas C++20 (Linux) sobre o LeitorReactor: cada medidor
+// é lido por um script sequencial (uma Tarefa), e milhares de scripts
+// executam de forma concorrente na thread que chama LeitorCoro::executa().
+// As corrotinas são retomadas pelo próprio laço do reactor, conforme chegam
+// bytes nas portas ou vencem os timeouts do protocolo; um LeitorCoro por
+// thread permite usar mais de um núcleo.
+//
+//     Tarefa script(LeitorCoro<TimerPolicyWinUnix, SerialPolicyUnix<>>& leitor,
+//                   sessao_t sessao) {
+//         // comando composto: uma resposta por co_await, retida sem cópia
+//         // na arena da sessão até a view ser destruída
+//         auto leitura = leitor.leitura(sessao, comando0x26, 5000);
+//         while (auto rsp = co_await leitura.proxima())
+//             processa(*rsp);
+//         if (leitura.status() != Sucesso)
+//             co_return;
+//
+//         // ou somente o resultado, com todas as respostas
+//         auto resultado = co_await leitor.leitura(sessao, comando0x14, 5000);
+//     }
+//
+//     leitor.inicia(script(leitor, sessao));
+//     leitor.executa(); // até todas as tarefas terminarem
+//
+// Requer C++20 (ver o alvo testes-coro em tests/CMakeLists.txt); o restante
+// da biblioteca continua em C++14.
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <leitor_reactor.h>
+#include <memory>
+#include <vector>
+
+// corrotina sem retorno, iniciada e destruída por LeitorCoro
+class Tarefa {
+  public:
+    struct promise_type {
+        Tarefa get_return_object() {
+            return Tarefa(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // só executa após LeitorCoro::inicia()
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        // destruída por LeitorCoro ao final
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        // a biblioteca não usa exceções
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Tarefa(Tarefa&& outra) : _handle(outra._handle) { outra._handle = {}; }
+    Tarefa(const Tarefa&) = delete;
+    ~Tarefa() {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    // transfere a posse da corrotina
+    std::coroutine_handle<> libera() {
+        std::coroutine_handle<> handle = _handle;
+        _handle = {};
+        return handle;
+    }
+
+  private:
+    explicit Tarefa(std::coroutine_handle<promise_type> handle)
+        : _handle(handle) {}
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+template <class TimerPolicy, class SerialPolicy> class LeitorCoro {
+  public:
+    using Reactor = LeitorReactor<TimerPolicy, SerialPolicy>;
+    using FSM = typename Reactor::FSM;
+    using sessao_t = typename Reactor::sessao_t;
+
+    typedef struct {
+        typename FSM::status_t status;
+        bool excedeuTimeout;
+        // respostas ainda não retiradas com Leitura::proxima()
+        std::vector<NBR14522::resposta_t> respostas;
+    } resultado_t;
+
+  private:
+    // compartilhado entre a Leitura e o callback do reactor, que pode
+    // sobreviver à Leitura
+    struct estado_leitura_t {
+        LeitorCoro* leitor;
+        std::deque<ArenaRespostas::Resposta> respostas;
+        bool concluida = false;
+        typename FSM::status_t status = FSM::status_t::Processando;
+        bool excedeuTimeout = false;
+        std::coroutine_handle<> aguardando; // corrotina suspensa na leitura
+
+        // a corrotina é retomada pelo laço de LeitorCoro, e não de dentro do
+        // processaEstado() que entregou a resposta
+        void acorda() {
+            if (aguardando) {
+                leitor->_prontas.push_back(aguardando);
+                aguardando = {};
+            }
+        }
+    };
+
+  public:
+    // leitura em andamento: gerador assíncrono das respostas (proxima()) ou,
+    // com co_await direto, o resultado ao final
+    class Leitura {
+      public:
+        explicit Leitura(std::shared_ptr<estado_leitura_t> estado)
+            : _estado(estado) {}
+
+        // aguarda a próxima resposta, retida na arena da sessão (ver
+        // LeitorReactor::retem()); view vazia quando a leitura termina (ver
+        // status())
+        auto proxima() {
+            struct aguardaResposta {
+                estado_leitura_t& estado;
+
+                bool await_ready() const noexcept {
+                    return !estado.respostas.empty() || estado.concluida;
+                }
+                void await_suspend(std::coroutine_handle<> handle) noexcept {
+                    estado.aguardando = handle;
+                }
+                ArenaRespostas::Resposta await_resume() {
+                    if (estado.respostas.empty())
+                        return ArenaRespostas::Resposta();
+                    ArenaRespostas::Resposta rsp =
+                        std::move(estado.respostas.front());
+                    estado.respostas.pop_front();
+                    return rsp;
+                }
+            };
+            return aguardaResposta{*_estado};
+        }
+
+        // aguarda o fim da leitura
+        auto operator co_await() {
+            struct aguardaConclusao {
+                estado_leitura_t& estado;
+
+                bool await_ready() const noexcept { return estado.concluida; }
+                void await_suspend(std::coroutine_handle<> handle) noexcept {
+                    estado.aguardando = handle;
+                }
+                resultado_t await_resume() {
+                    resultado_t resultado{estado.status, estado.excedeuTimeout,
+                                          {}};
+                    // cópias: os blocos voltam à arena
+                    for (const ArenaRespostas::Resposta& rsp : estado.respostas)
+                        resultado.respostas.push_back(*rsp);
+                    estado.respostas.clear();
+                    return resultado;
+                }
+            };
+            return aguardaConclusao{*_estado};
+        }
+
+        bool concluida() const { return _estado->concluida; }
+        typename FSM::status_t status() const { return _estado->status; }
+        bool excedeuTimeout() const { return _estado->excedeuTimeout; }
+
+      private:
+        std::shared_ptr<estado_leitura_t> _estado;
+    };
+
+    LeitorCoro() = default;
+    ~LeitorCoro() {
+        for (auto handle : _tarefas)
+            handle.destroy();
+    }
+
+    LeitorCoro(const LeitorCoro&) = delete;
+    LeitorCoro& operator=(const LeitorCoro&) = delete;
+
+    bool ok() const { return _reactor.ok(); }
+
+    sessao_t adiciona(sptr<SerialPolicy> porta) {
+        sessao_t sessao = _reactor.adiciona(porta);
+        if (sessao != Reactor::SESSAO_INVALIDA && _leituras.size() <= sessao)
+            _leituras.resize(sessao + 1);
+        return sessao;
+    }
+
+    // inicia a leitura na sessão (como LeitorReactor::leitura()). Se a
+    // sessão já tem uma leitura em andamento, a Leitura retornada já está
+    // concluída, com status Processando.
+    Leitura leitura(const sessao_t sessao, const NBR14522::comando_t& comando,
+                    const uint32_t timeout_resposta_ms = 0) {
+        auto estado = std::make_shared<estado_leitura_t>();
+        estado->leitor = this;
+
+        estado_leitura_t* e = estado.get();
+        if (!_reactor.leitura(
+                sessao, comando,
+                [e, sessao](const NBR14522::resposta_t&) {
+                    e->respostas.push_back(e->leitor->_reactor.retem(sessao));
+                    e->acorda();
+                },
+                timeout_resposta_ms)) {
+            estado->concluida = true;
+            return Leitura(estado);
+        }
+
+        // mantém o estado vivo até a conclusão, ainda que a Leitura seja
+        // descartada antes
+        _leituras[sessao] = estado;
+        _trataConclusoes();
+        return Leitura(estado);
+    }
+
+    // agenda a tarefa para execução no próximo processa()
+    void inicia(Tarefa tarefa) {
+        std::coroutine_handle<> handle = tarefa.libera();
+        _tarefas.push_back(handle);
+        _prontas.push_back(handle);
+    }
+
+    // retoma as corrotinas prontas e aguarda o reactor por até timeout_ms
+    // (-1: até algum evento). Retorna a quantidade de tarefas não terminadas.
+    std::size_t processa(const int timeout_ms = -1) {
+        _retomaProntas();
+        if (_tarefas.empty())
+            return 0;
+
+        _reactor.processa(_prontas.empty() ? timeout_ms : 0);
+        _trataConclusoes();
+        _retomaProntas();
+        return _tarefas.size();
+    }
+
+    // executa até todas as tarefas terminarem
+    void executa() {
+        while (processa(-1))
+            ;
+    }
+
+    std::size_t tarefas() const { return _tarefas.size(); }
+    Reactor& reactor() { return _reactor; }
+
+  private:
+    Reactor _reactor;
+    std::vector<std::coroutine_handle<>> _tarefas;
+    std::deque<std::coroutine_handle<>> _prontas;
+    std::vector<std::shared_ptr<estado_leitura_t>> _leituras; // por sessão
+
+    void _trataConclusoes() {
+        typename Reactor::conclusao_t conclusao;
+        while (_reactor.proximaConclusao(conclusao)) {
+            std::shared_ptr<estado_leitura_t> estado =
+                std::move(_leituras[conclusao.sessao]);
+            if (!estado)
+                continue;
+            estado->concluida = true;
+            estado->status = conclusao.status;
+            estado->excedeuTimeout = conclusao.excedeuTimeout;
+            estado->acorda();
+        }
+    }
+
+    void _retomaProntas() {
+        while (!_prontas.empty()) {
+            std::coroutine_handle<> handle = _prontas.front();
+            _prontas.pop_front();
+            handle.resume();
+            // conclusões geradas por leituras iniciadas pela corrotina
+            _trataConclusoes();
+        }
+
+        for (std::size_t i = 0; i < _tarefas.size();) {
+            if (_tarefas[i].done()) {
+                _tarefas[i].destroy();
+                _tarefas[i] = _tarefas.back();
+                _tarefas.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+};
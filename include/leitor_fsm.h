@@ -2,306 +2,260 @@
 #include <CRC.h>
 #include <NBR14522.h>
 #include <cstdio>
+#include <cstring>
 #include <functional>
 #include <memory>
+#include <protocolo_leitor.h>
+#include <utility>
 
 template <typename T> using sptr = std::shared_ptr<T>;
 
-template <class TimerPolicy, class SerialPolicy> class LeitorFSM {
+// leitor sobre uma porta (SerialPolicy) e um timer (TimerPolicy): transporta
+// os bytes e os timeouts do ProtocoloLeitor, que implementa o protocolo.
+// Callback é o tipo do callback das respostas: std::function por padrão, ou
+// FuncaoRef (sem posse, sem alocação) quando o chamador mantém o callback
+// vivo durante a leitura (ver Leitor::leitura())
+template <class TimerPolicy, class SerialPolicy,
+          class Callback = std::function<void(const NBR14522::resposta_t&)>>
+class LeitorFSM : public LeitorTipos {
   public:
-    typedef enum {
-        Dessincronizado,
-        Sincronizado,
-        ComandoTransmitido,
-        AtrasoDeSequenciaRecebido,
-        CodigoRecebido,
-        AguardaNovoComando,
-    } estado_t;
-
-    typedef enum {
-        Sucesso,
-        Processando,
-        ErroLimiteDeNAKsRecebidos,
-        ErroLimiteDeNAKsTransmitidos,
-        ErroLimiteDeTransmissoesSemRespostas,
-        ErroTempoSemWaitEsgotado,
-        ErroLimiteDeWaitsRecebidos,
-        ErroQuebraDeSequencia,
-        ErroAposRespostaRecebeNAK,
-        ErroSemRespostaAoAguardarProximaResposta,
-        ExcecaoOcorrenciaNoMedidor,
-        ExcecaoComandoNaoImplementado
-    } status_t;
+    // eventos ocorridos durante um feed() (bits de feed_t::eventos)
+    enum : uint32_t {
+        // ENQ recebido fora de sincronismo
+        FeedSincronizou = ProtocoloLeitor::EventoSincronizou,
+        // comando transmitido ou repetido
+        FeedComandoTransmitido = ProtocoloLeitor::EventoComandoTransmitido,
+        // ENQ, NAK ou WAIT após o comando
+        FeedSinalizador = ProtocoloLeitor::EventoSinalizador,
+        // resposta íntegra (ACK transmitido)
+        FeedResposta = ProtocoloLeitor::EventoResposta,
+        // resposta com CRC incorreto
+        FeedNakTransmitido = ProtocoloLeitor::EventoNakTransmitido,
+        // timeout do estado
+        FeedTimeout = ProtocoloLeitor::EventoTimeout,
+        FeedQuebraDeSequencia = ProtocoloLeitor::EventoQuebraDeSequencia,
+        // leitura terminada (ver status())
+        FeedConcluido = ProtocoloLeitor::EventoConcluido,
+    };
 
-    void setComando(const NBR14522::comando_t& comando) {
-        _comando = comando;
-        _estado = Dessincronizado;
-        _status = Processando;
-        _esvaziaPortaSerial();
-    }
+    typedef struct {
+        std::size_t consumidos; // bytes processados ou descartados
+        uint32_t eventos;       // Feed*
+    } feed_t;
 
-    void
-    setCallback(std::function<void(const NBR14522::resposta_t& rsp)> callback) {
-        _callback = callback;
+    // no modo sessão (setSessao()), os bytes recebidos entre as leituras
+    // também são descartados: o comando é transmitido no próximo ENQ, e não
+    // em um ENQ antigo
+    void setComando(const NBR14522::comando_t& comando) {
+        _protocolo.setComando(comando, _agora(0));
+        _esvaziaPortaSerial(0);
     }
 
-    estado_t processaEstado() {
+    // mantém o sincronismo entre leituras consecutivas (ver
+    // ProtocoloLeitor::setSessao())
+    void setSessao(const bool sessao) { _protocolo.setSessao(sessao); }
 
-        byte_t byte;
-        size_t bytesLidosSz;
+    void setCallback(Callback callback) { _callback = std::move(callback); }
 
-        switch (_estado) {
+    estado_t processaEstado() {
+        switch (_protocolo.estado()) {
         case AguardaNovoComando:
             // nao faz nada neste estado, aguardando comando ser setado em
             // setComando()
             break;
-        case Dessincronizado:
-            if (_porta->rx(&byte, 1) && byte == NBR14522::ENQ) {
-                _estado = Sincronizado;
-                _timer.setTimeout(NBR14522::TMAXENQ_MSEC);
-            }
-            break;
-        case Sincronizado:
-            if (_timer.timedOut()) {
-                _estado = Dessincronizado;
-                _esvaziaPortaSerial();
-            } else if (_porta->rx(&byte, 1) && byte == NBR14522::ENQ) {
-                _transmiteComando();
-                _counterNakRecebido = 0;
-                _counterNakTransmitido = 0;
-                _counterSemResposta = 0;
-                _counterWaitRecebido = 0;
-                _isRespostaComposta = false;
-                _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                _estado = ComandoTransmitido;
-            }
+        case CodigoRecebido: {
+            // bloco de dados: lido diretamente no bloco de destino da
+            // resposta (ver ProtocoloLeitor::recebeEm()); os bytes recebidos
+            // têm precedência sobre o timeout
+            std::size_t esperados;
+            byte_t* destino = _protocolo.posicaoResposta(esperados);
+            const std::size_t sz = _porta->rx(destino, esperados);
+            if (sz)
+                _trata(_protocolo.recebidos(sz, _agora(0)), true);
+            else if (_timer.timedOut())
+                _trata(_protocolo.expira(), true);
             break;
-        case ComandoTransmitido:
-            if (_timer.timedOut()) {
-                _esvaziaPortaSerial();
-                _counterSemResposta++;
-                if (_counterSemResposta == NBR14522::MAX_COMANDO_SEM_RESPOSTA) {
-                    // falhou
-                    _estado = AguardaNovoComando;
-                    _status = ErroLimiteDeTransmissoesSemRespostas;
-                } else if (_isRespostaComposta) {
-                    // falhou
-                    _estado = AguardaNovoComando;
-                    _status = ErroSemRespostaAoAguardarProximaResposta;
-                } else {
-                    _transmiteComando();
-                    _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                }
-            } else if (_porta->rx(&byte, 1)) {
-                // byte recebido
-                if (byte == NBR14522::NAK) {
-                    _counterNakRecebido++;
-                    if (_counterNakRecebido == NBR14522::MAX_BLOCO_NAK) {
-                        // falha
-                        _status = ErroLimiteDeNAKsRecebidos;
-                        _estado = AguardaNovoComando;
-                    } else if (_isRespostaComposta) {
-                        // falha
-                        _status = ErroAposRespostaRecebeNAK;
-                        _estado = AguardaNovoComando;
-                    } else {
-                        _transmiteComando();
-                        _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                    }
-                } else if (byte == NBR14522::WAIT) {
-                    _estado = AtrasoDeSequenciaRecebido;
-                    _timer.setTimeout(NBR14522::TSEMWAIT_SEC * 1000);
-                } else if (
-                    byte == _comando.at(0) ||
-                    byte == NBR14522::CodigoInformacaoDeOcorrenciaNoMedidor ||
-                    byte ==
-                        NBR14522::CodigoInformacaoDeComandoNaoImplementado) {
-                    // código do comando
-                    _resposta.at(0) = byte;
-                    _respostaBytesLidos = 1;
-                    _timer.setTimeout(NBR14522::TMAXCAR_MSEC);
-                    _estado = CodigoRecebido;
-                } else if (byte == NBR14522::ENQ && _isRespostaComposta) {
-                    // "se após o tempo permitido para a leitora enviar ACK
-                    // este ainda não foi enviado, o medidor deve enviar ENQ
-                    // aguardando o recebimento do ACK"
-
-                    // retransmite ACK
-                    byte = NBR14522::ACK;
-                    _porta->tx(&byte, 1);
-                } else {
-                    // "a recepção de algo que que não seja SINALIZADOR ou
-                    // BLOCO DE DADOS [resposta ou comando] deve provocar
-                    // uma QUEBRA DE SEQUÊNCIA"
-                    _estado = Dessincronizado;
-                    _status = ErroQuebraDeSequencia;
-                    _esvaziaPortaSerial();
-                }
-            }
-            break;
-        case AtrasoDeSequenciaRecebido:
-            if (_timer.timedOut()) {
-                // falhou
-                _estado = AguardaNovoComando;
-                _status = ErroTempoSemWaitEsgotado;
-            } else if (_porta->rx(&byte, 1)) {
-                // byte recebido
-                if (byte == NBR14522::ENQ) {
-                    _estado = ComandoTransmitido;
-                    _transmiteComando();
-                    _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                } else if (byte == NBR14522::WAIT) {
-                    _counterWaitRecebido++;
-                    if (_counterWaitRecebido == NBR14522::MAX_BLOCO_WAIT) {
-                        // falhou
-                        _estado = AguardaNovoComando;
-                        _status = ErroLimiteDeWaitsRecebidos;
-                    } else {
-                        _timer.setTimeout(NBR14522::TSEMWAIT_SEC * 1000);
-                    }
-                } else {
-                    // "a recepção de algo que que não seja SINALIZADOR ou
-                    // BLOCO DE DADOS [resposta ou comando] deve provocar
-                    // uma QUEBRA DE SEQUÊNCIA"
-                    _estado = Dessincronizado;
-                    _status = ErroQuebraDeSequencia;
-                    _esvaziaPortaSerial();
-                }
-            }
-            break;
-        case CodigoRecebido:
-            bytesLidosSz =
-                _porta->rx(&_resposta[_respostaBytesLidos],
-                           NBR14522::RESPOSTA_SZ - _respostaBytesLidos);
-            _respostaBytesLidos += bytesLidosSz;
-
-            if (bytesLidosSz)
-                _timer.setTimeout(NBR14522::TMAXCAR_MSEC);
-
-            if (_timer.timedOut()) {
-                _counterSemResposta++;
-                _esvaziaPortaSerial();
-                if (_counterSemResposta == NBR14522::MAX_COMANDO_SEM_RESPOSTA) {
-                    // falhou
-                    _estado = AguardaNovoComando;
-                    _status = ErroLimiteDeTransmissoesSemRespostas;
-                } else {
-                    _transmiteComando();
-                    _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                    _estado = ComandoTransmitido;
-                }
-            } else if (_respostaBytesLidos >= NBR14522::RESPOSTA_SZ) {
-                // resposta completa recebida, verifica CRC
-                if (NBR14522::getCRC(_resposta) ==
-                    CRC16(_resposta.data(), _resposta.size() - 2)) {
-                    // CRC correto
-                    // transmite ACK
-                    byte = NBR14522::ACK;
-                    _porta->tx(&byte, 1);
-
-                    // chama callback caso tenha sido setado
-                    if (_callback)
-                        _callback(_resposta);
-
-                    if (_isComposto(_resposta.at(0))) {
-                        _isRespostaComposta = true;
-                        if (_isUltimaRespostaDeComandoComposto(_resposta)) {
-                            // resposta composta recebida por completo,
-                            // sucesso
-                            _estado = estado_t::AguardaNovoComando;
-                            _status = Sucesso;
-                        } else {
-                            // resetar contadores, pois são referentes a
-                            // cada resposta. Obs.: nao zera contador de NAK
-                            // recebidos pois o comando já foi recebido
-                            // corretamente pelo medidor e a partir de agora
-                            // o medidor nao deve enviar mais NAKs.
-                            _counterNakTransmitido = 0;
-                            _counterSemResposta = 0;
-                            _counterWaitRecebido = 0;
-                            _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                            _estado = ComandoTransmitido;
-                        }
-                    } else {
-                        // resposta simples recebida
-
-                        if (_resposta.at(0) ==
-                            NBR14522::CodigoInformacaoDeOcorrenciaNoMedidor)
-                            _status = ExcecaoOcorrenciaNoMedidor;
-                        else if (_resposta.at(0) ==
-                                 NBR14522::
-                                     CodigoInformacaoDeComandoNaoImplementado)
-                            _status = ExcecaoComandoNaoImplementado;
-                        else
-                            _status = Sucesso;
-
-                        _estado = estado_t::AguardaNovoComando;
-                    }
-                } else {
-                    // CRC incorreto
-                    // transmite NAK
-                    byte = NBR14522::NAK;
-                    _porta->tx(&byte, 1);
-                    _counterNakTransmitido++;
-                    if (_counterNakTransmitido == NBR14522::MAX_BLOCO_NAK) {
-                        // falhou
-                        _estado = estado_t::AguardaNovoComando;
-                        _status = status_t::ErroLimiteDeNAKsTransmitidos;
-                    } else {
-                        _estado = estado_t::ComandoTransmitido;
-                        _timer.setTimeout(NBR14522::TMAXRSP_MSEC);
-                    }
-                }
-            }
+        }
+        default: {
+            // sinalizadores: um byte (ou timeout) por chamada
+            byte_t byte;
+            if (_protocolo.aguardaTimeout() && _timer.timedOut())
+                _trata(_protocolo.expira(), true);
+            else if (_porta->rx(&byte, 1))
+                _trata(_protocolo.recebe(&byte, 1, _agora(0)), true);
             break;
         }
+        }
+        return _protocolo.estado();
+    }
+
+    // alternativa a processaEstado() quando os bytes recebidos já estão em
+    // memória (e.g. lidos por um laço de eventos): processa o bloco inteiro
+    // em uma só chamada. Os bytes ignorados fora de sincronismo são saltados
+    // com memchr(3) até o próximo ENQ, e os blocos de dados são copiados de
+    // uma vez; a porta só é usada para transmitir. Os bytes descartados pelo
+    // protocolo (quebra de sequência, perda de sincronismo) são os restantes
+    // do bloco. feed(nullptr, 0) somente trata os timeouts.
+    //
+    // Retorna quantos bytes foram consumidos, menos que n somente se a
+    // leitura terminou antes (FeedConcluido), e os eventos ocorridos.
+    feed_t feed(const byte_t* data, const std::size_t n) {
+        feed_t resultado = {0, 0};
+
+        // o timeout tem precedência, exceto sobre os bytes do bloco de dados
+        if (_protocolo.aguardaTimeout() &&
+            (!n || _protocolo.estado() != CodigoRecebido) &&
+            _timer.timedOut()) {
+            const ProtocoloLeitor::resultado_t r = _protocolo.expira();
+            resultado.eventos |= _trata(r, false);
+            if (r.eventos & ProtocoloLeitor::EventoDescarte)
+                resultado.consumidos = n;
+        }
+
+        while (resultado.consumidos < n &&
+               _protocolo.estado() != AguardaNovoComando) {
+            const ProtocoloLeitor::resultado_t r =
+                _protocolo.recebe(data + resultado.consumidos,
+                                  n - resultado.consumidos, _agora(0));
+            resultado.consumidos += r.consumidos;
+            resultado.eventos |= _trata(r, false);
+        }
+
+        if (_protocolo.estado() == AguardaNovoComando)
+            resultado.eventos |= FeedConcluido;
+        resultado.eventos &= FEED_EVENTOS;
+        return resultado;
+    }
+
+    // instante do próximo timeout do protocolo, caso o estado atual aguarde
+    // algum. Permite ao laço de leitura dormir até que chegue um byte ou que o
+    // timeout ocorra, ao invés de chamar processaEstado() continuamente.
+    // Requer que TimerPolicy forneça deadline().
+    template <class Deadline> bool proximoDeadline(Deadline& deadline) const {
+        if (!_protocolo.aguardaTimeout())
+            return false;
+        deadline = _timer.deadline();
+        return true;
+    }
+
+    // instante previsto do próximo ENQ, no relógio da TimerPolicy, enquanto
+    // a leitura aguarda um ENQ (ver ProtocoloLeitor::proximoEnq())
+    template <class Deadline> bool proximoEnq(Deadline& previsto) const {
+        ProtocoloLeitor::instante_t t;
+        if (!_protocolo.proximoEnq(t))
+            return false;
+        previsto = Deadline(
+            std::chrono::duration_cast<typename Deadline::duration>(
+                t.time_since_epoch()));
+        return true;
+    }
 
-        return _estado;
+    const CadenciaEnq& cadencia() const { return _protocolo.cadencia(); }
+
+    // timer do protocolo, para laços de eventos que configuram a notificação
+    // de expiração (ver TimerPolicyRoda)
+    TimerPolicy& timer() { return _timer; }
+
+    LeitorFSM(sptr<SerialPolicy> porta) : _dono(porta), _porta(porta.get()) {}
+
+    // porta sem posse, que deve sobreviver ao leitor: sem contagem de
+    // referências (atômica) do shared_ptr
+    LeitorFSM(SerialPolicy& porta) : _porta(&porta) {}
+
+    uint32_t counterNakRecebido() { return _protocolo.counterNakRecebido(); }
+    uint32_t counterNakTransmitido() {
+        return _protocolo.counterNakTransmitido();
     }
+    uint32_t counterSemResposta() { return _protocolo.counterSemResposta(); }
+    uint32_t counterWaitRecebido() { return _protocolo.counterWaitRecebido(); }
+    status_t status() { return _protocolo.status(); }
 
-    LeitorFSM(sptr<SerialPolicy> porta) : _porta(porta) {}
+    // válida até a próxima resposta
+    const NBR14522::resposta_t& resposta() const {
+        return _protocolo.resposta();
+    }
 
-    uint32_t counterNakRecebido() { return _counterNakRecebido; }
-    uint32_t counterNakTransmitido() { return _counterNakTransmitido; }
-    uint32_t counterSemResposta() { return _counterSemResposta; }
-    uint32_t counterWaitRecebido() { return _counterWaitRecebido; }
-    status_t status() { return _status; }
+    // recebe as respostas diretamente em bloco (ver
+    // ProtocoloLeitor::recebeEm()); pode ser chamado de dentro do callback
+    void recebeEm(NBR14522::resposta_t* bloco) { _protocolo.recebeEm(bloco); }
 
-    NBR14522::resposta_t resposta() { return _resposta; }
+    // ociosidade da linha antes dos comandos e margens de TMAXSINC, medidas
+    // pelo relógio da TimerPolicy (zero se ela não fornece deadline())
+    ProtocoloLeitor::clock::duration ociosidade() const {
+        return _protocolo.ociosidade();
+    }
+    const ProtocoloLeitor::metricas_t& metricas() const {
+        return _protocolo.metricas();
+    }
+    void zeraMetricas() { _protocolo.zeraMetricas(); }
 
   private:
-    estado_t _estado = AguardaNovoComando;
-    status_t _status = Processando;
-    sptr<SerialPolicy> _porta;
+    static constexpr uint32_t FEED_EVENTOS = 2 * FeedConcluido - 1;
+
+    ProtocoloLeitor _protocolo;
+    sptr<SerialPolicy> _dono; // nulo se a porta é referenciada sem posse
+    SerialPolicy* _porta;
     TimerPolicy _timer;
-    NBR14522::comando_t _comando;
-    NBR14522::resposta_t _resposta;
-    size_t _respostaBytesLidos;
-    uint32_t _counterNakRecebido = 0;
-    uint32_t _counterNakTransmitido = 0;
-    uint32_t _counterSemResposta = 0;
-    uint32_t _counterWaitRecebido = 0;
-    bool _isRespostaComposta = false;
-    std::function<void(const NBR14522::resposta_t& rsp)> _callback = nullptr;
-
-    void _esvaziaPortaSerial() {
-        byte_t buf[32];
-        while (_porta->rx(buf, sizeof(buf)))
-            ;
+    Callback _callback = nullptr;
+
+    // os timeouts são vencidos pela TimerPolicy (ProtocoloLeitor::expira());
+    // o instante informado ao protocolo é o do relógio da TimerPolicy, que
+    // dá a mesma referência aos deadlines e às métricas
+    template <class T = TimerPolicy>
+    static auto _agora(int)
+        -> decltype(std::declval<const T&>().deadline(),
+                    ProtocoloLeitor::instante_t()) {
+        using relogio =
+            typename decltype(std::declval<const T&>().deadline())::clock;
+        return ProtocoloLeitor::instante_t(
+            std::chrono::duration_cast<ProtocoloLeitor::clock::duration>(
+                relogio::now().time_since_epoch()));
     }
 
-    void _transmiteComando() {
-        // nao incluir os dois ultimos bytes de CRC no calculo do CRC
-        NBR14522::setCRC(_comando, CRC16(_comando.data(), _comando.size() - 2));
-        _porta->tx(_comando.data(), _comando.size());
+    // TimerPolicy sem deadline(): instante constante, somente os timeouts
+    // da policy vencem
+    static ProtocoloLeitor::instante_t _agora(long) {
+        return ProtocoloLeitor::instante_t();
     }
 
-    bool _isComposto(const byte_t codigo) {
-        return codigo == 0x26 || codigo == 0x27 || codigo == 0x52;
+    // executa as ações pedidas pelo protocolo; descartaPorta: se os bytes
+    // descartados incluem os ainda não lidos da porta (fora de feed(), cujos
+    // bytes descartados são os restantes do bloco)
+    uint32_t _trata(const ProtocoloLeitor::resultado_t& r,
+                    const bool descartaPorta) {
+        if (descartaPorta && (r.eventos & ProtocoloLeitor::EventoDescarte))
+            _esvaziaPortaSerial(0);
+
+        if (r.eventos & ProtocoloLeitor::EventoTransmissao) {
+            std::size_t sz;
+            const byte_t* data = _protocolo.transmissao(sz);
+            _porta->tx(data, sz);
+            _protocolo.transmitido(_agora(0));
+        }
+
+        // chama callback caso tenha sido setado
+        if ((r.eventos & ProtocoloLeitor::EventoResposta) && _callback)
+            _callback(_protocolo.resposta());
+
+        // o timeout começa a contar após a transmissão
+        if (r.eventos & ProtocoloLeitor::EventoTimer)
+            _timer.setTimeout(_protocolo.timeout_ms());
+
+        return r.eventos;
     }
 
-    bool
-    _isUltimaRespostaDeComandoComposto(const NBR14522::resposta_t& resposta) {
-        return resposta.at(5) & 0x10;
+    // policies que descartam os bytes recebidos de uma só vez (e.g. com
+    // tcflush(3)), sem uma syscall de leitura por bloco de bytes
+    template <class S = SerialPolicy>
+    auto _esvaziaPortaSerial(int)
+        -> decltype(std::declval<S&>().descartaRx(), void()) {
+        _porta->descartaRx();
+    }
+
+    // demais policies: lê e descarta até a porta ficar vazia
+    void _esvaziaPortaSerial(long) {
+        byte_t buf[32];
+        while (_porta->rx(buf, sizeof(buf)))
+            ;
     }
 };
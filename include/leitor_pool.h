@@ -0,0 +1,426 @@
+#pragma once
+
+// Pool de N threads de leitura (Linux), cada uma com seu LeitorReactor e sua
+// fila de jobs. Um job é uma sequência de comandos para um medidor (porta);
+// cada porta pertence a um shard (porta % N), em cuja fila seus jobs são
+// enfileirados. Um worker com capacidade ociosa e fila vazia rouba jobs do
+// fim da fila de outro worker: as portas não ficam presas a um worker, só a
+// um job por vez, e qualquer worker assume uma porta entre dois jobs.
+//
+// Os comandos de um job são lidos em sessão (LeitorFSM::setSessao()): após a
+// resposta de um comando, o seguinte é transmitido no próximo ENQ do medidor.
+//
+// Os callbacks dos jobs são chamados pela thread do worker que o executa.
+//
+// Uso típico:
+//
+//     LeitorPool<TimerPolicyWinUnix, SerialPolicyUnix<>> pool(4);
+//     for (auto& porta : portas)
+//         pool.adiciona(porta);
+//     pool.inicia();
+//     for (...)
+//         pool.submete(job);
+//     pool.aguarda();
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <leitor_reactor.h>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+template <class TimerPolicy, class SerialPolicy> class LeitorPool {
+  public:
+    using Reactor = LeitorReactor<TimerPolicy, SerialPolicy>;
+    using FSM = typename Reactor::FSM;
+    using porta_t = std::size_t;
+
+    typedef struct {
+        porta_t porta;
+        std::size_t worker; // worker que executou o job
+        std::size_t comandosConcluidos;
+        // status do último comando executado (Sucesso se todos foram
+        // concluídos; Processando se a porta não pôde ser aguardada ou se o
+        // job foi descartado por encerra())
+        typename FSM::status_t status;
+        bool excedeuTimeout;
+    } resultado_t;
+
+    typedef struct {
+        porta_t porta;
+        std::vector<NBR14522::comando_t> comandos;
+        // resposta recebida para comandos[comando]
+        std::function<void(std::size_t comando,
+                           const NBR14522::resposta_t& rsp)>
+            resposta;
+        std::function<void(const resultado_t& resultado)> conclusao;
+        uint32_t timeout_resposta_ms;
+    } job_t;
+
+    typedef struct {
+        std::uint64_t jobs;     // jobs concluídos por este worker
+        std::uint64_t roubados; // dos quais retirados da fila de outro worker
+        std::uint64_t comandos; // comandos concluídos com sucesso
+        std::uint64_t falhas;   // jobs encerrados antes do último comando
+        // comandos transmitidos, dos quais no primeiro ENQ (sincronismo
+        // mantido do comando anterior), e a linha ociosa antes deles
+        std::uint64_t transmitidos;
+        std::uint64_t sincronizados;
+        std::chrono::nanoseconds ociosidade;
+        // respostas a ENQ, das quais após TMAXSINC, e a menor margem até
+        // TMAXSINC (ver ProtocoloLeitor::metricas_t)
+        std::uint64_t respostasEnq;
+        std::uint64_t foraDeTmaxsinc;
+        std::chrono::nanoseconds margemMinima;
+        typename Reactor::estatisticas_t reactor;
+    } estatisticas_worker_t;
+
+    // sessoesPorWorker: leituras simultâneas de cada worker; os jobs além
+    // disso aguardam na fila e podem ser roubados. fixaNucleos: worker i
+    // executa somente no núcleo i (módulo a quantidade de núcleos).
+    explicit LeitorPool(const std::size_t workers,
+                        const std::size_t sessoesPorWorker = 64,
+                        const bool fixaNucleos = true)
+        : _sessoesPorWorker(sessoesPorWorker), _fixaNucleos(fixaNucleos) {
+        for (std::size_t i = 0; i < (workers ? workers : 1); i++)
+            _workers.emplace_back(new worker_t(i));
+    }
+
+    ~LeitorPool() { encerra(); }
+
+    LeitorPool(const LeitorPool&) = delete;
+    LeitorPool& operator=(const LeitorPool&) = delete;
+
+    // registra uma porta já aberta; somente antes de inicia()
+    porta_t adiciona(sptr<SerialPolicy> porta) {
+        _portas.emplace_back(new porta_interna_t(porta));
+        return _portas.size() - 1;
+    }
+
+    void inicia() {
+        for (auto& w : _workers) {
+            w->sessoes.assign(_portas.size(), Reactor::SESSAO_INVALIDA);
+            worker_t* worker = w.get();
+            w->thread = std::thread([this, worker]() { _executa(*worker); });
+        }
+    }
+
+    // encerra os workers após os jobs em andamento; jobs ainda na fila são
+    // descartados, e concluídos com status Processando e nenhum comando
+    void encerra() {
+        {
+            std::lock_guard<std::mutex> trava(_mutex);
+            _encerrar = true;
+        }
+        _cv.notify_all();
+        for (auto& w : _workers)
+            if (w->thread.joinable())
+                w->thread.join();
+
+        std::size_t descartados = 0;
+        for (auto& w : _workers) {
+            std::deque<job_t> fila;
+            {
+                std::lock_guard<std::mutex> trava(w->mutex);
+                fila.swap(w->fila);
+            }
+            for (job_t& job : fila) {
+                if (job.conclusao)
+                    job.conclusao({job.porta, w->indice, 0,
+                                   FSM::status_t::Processando, false});
+                descartados++;
+            }
+        }
+        if (!descartados)
+            return;
+        {
+            std::lock_guard<std::mutex> trava(_mutex);
+            _pendentes -= descartados;
+        }
+        _cvConcluidos.notify_all();
+    }
+
+    void submete(job_t job) {
+        worker_t& w = *_workers[job.porta % _workers.size()];
+        {
+            std::lock_guard<std::mutex> trava(w.mutex);
+            w.fila.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> trava(_mutex);
+            _pendentes++;
+            _geracao++;
+        }
+        _cv.notify_all();
+    }
+
+    // aguarda a conclusão de todos os jobs submetidos
+    void aguarda() {
+        std::unique_lock<std::mutex> trava(_mutex);
+        _cvConcluidos.wait(trava, [this]() { return _pendentes == 0; });
+    }
+
+    std::size_t workers() const { return _workers.size(); }
+
+    // consistentes somente após aguarda() ou encerra()
+    std::vector<estatisticas_worker_t> estatisticas() const {
+        std::vector<estatisticas_worker_t> estatisticas;
+        for (auto& w : _workers) {
+            estatisticas.push_back(w->estatisticas);
+            estatisticas_worker_t& e = estatisticas.back();
+            e.reactor = w->reactor.estatisticas();
+            e.margemMinima = std::chrono::nanoseconds::max();
+            for (const auto sessao : w->sessoes) {
+                if (sessao == Reactor::SESSAO_INVALIDA)
+                    continue;
+                const ProtocoloLeitor::metricas_t& m =
+                    w->reactor.fsm(sessao).metricas();
+                e.transmitidos += m.comandos;
+                e.sincronizados += m.sincronizados;
+                e.ociosidade += m.ociosidade;
+                e.respostasEnq += m.respostasEnq;
+                e.foraDeTmaxsinc += m.foraDeTmaxsinc;
+                if (m.margemMinima < e.margemMinima)
+                    e.margemMinima = m.margemMinima;
+            }
+        }
+        return estatisticas;
+    }
+
+  private:
+    // intervalo máximo em que um worker com leituras em andamento deixa de
+    // verificar a chegada de novos jobs
+    static constexpr int INTERVALO_FILAS_MS = 5;
+
+    struct porta_interna_t {
+        porta_interna_t(sptr<SerialPolicy> p) : porta(p) {}
+
+        sptr<SerialPolicy> porta;
+        std::atomic<bool> ocupada{false}; // com um job em andamento
+    };
+
+    typedef struct {
+        job_t job;
+        std::size_t comando;
+        bool roubado;
+    } execucao_t;
+
+    struct worker_t {
+        worker_t(std::size_t i) : indice(i) {}
+
+        std::size_t indice;
+        std::thread thread;
+        std::mutex mutex; // protege fila
+        std::deque<job_t> fila;
+
+        // daqui em diante, acessados somente pela thread do worker
+        Reactor reactor;
+        // sessão desta porta no reactor do worker, criada no primeiro job
+        std::vector<typename Reactor::sessao_t> sessoes;
+        // job em execução em cada sessão do reactor
+        std::vector<std::unique_ptr<execucao_t>> execucoes;
+        estatisticas_worker_t estatisticas = {};
+    };
+
+    std::size_t _sessoesPorWorker;
+    bool _fixaNucleos;
+    std::vector<std::unique_ptr<porta_interna_t>> _portas;
+    std::vector<std::unique_ptr<worker_t>> _workers;
+
+    std::mutex _mutex; // protege os campos abaixo
+    std::condition_variable _cv;           // novo job ou porta liberada
+    std::condition_variable _cvConcluidos; // _pendentes chegou a zero
+    std::uint64_t _geracao = 0;
+    std::size_t _pendentes = 0;
+    bool _encerrar = false;
+
+    void _executa(worker_t& w) {
+        // antes de qualquer job: a thread já nasce no seu núcleo
+        if (_fixaNucleos)
+            _fixaNucleo(w);
+
+        while (true) {
+            std::uint64_t geracao;
+            bool encerrar;
+            {
+                std::lock_guard<std::mutex> trava(_mutex);
+                encerrar = _encerrar;
+                geracao = _geracao;
+            }
+            if (encerrar && !w.reactor.ativas())
+                return;
+
+            job_t job;
+            while (!encerrar && w.reactor.ativas() < _sessoesPorWorker) {
+                if (_retira(w, job))
+                    _inicia(w, std::move(job), false);
+                else if (_rouba(w, job))
+                    _inicia(w, std::move(job), true);
+                else
+                    break;
+            }
+
+            if (!w.reactor.ativas()) {
+                // nada a fazer: dorme até um job ser submetido ou uma porta
+                // ser liberada
+                std::unique_lock<std::mutex> trava(_mutex);
+                _cv.wait(trava, [&]() {
+                    return _encerrar || _geracao != geracao;
+                });
+                continue;
+            }
+
+            w.reactor.processa(INTERVALO_FILAS_MS);
+            typename Reactor::conclusao_t conclusao;
+            while (w.reactor.proximaConclusao(conclusao))
+                _trataConclusao(w, conclusao);
+        }
+    }
+
+    // o dono retira do início da própria fila (jobs mais antigos primeiro)
+    bool _retira(worker_t& w, job_t& job) {
+        std::lock_guard<std::mutex> trava(w.mutex);
+        for (auto it = w.fila.begin(); it != w.fila.end(); ++it) {
+            if (_ocupa(it->porta)) {
+                job = std::move(*it);
+                w.fila.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // e rouba do fim das filas dos demais, a partir do worker seguinte
+    bool _rouba(worker_t& w, job_t& job) {
+        for (std::size_t i = 1; i < _workers.size(); i++) {
+            worker_t& vitima = *_workers[(w.indice + i) % _workers.size()];
+            std::lock_guard<std::mutex> trava(vitima.mutex);
+            for (auto it = vitima.fila.rbegin(); it != vitima.fila.rend();
+                 ++it) {
+                if (_ocupa(it->porta)) {
+                    job = std::move(*it);
+                    vitima.fila.erase(std::next(it).base());
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // jobs da mesma porta são executados um de cada vez
+    bool _ocupa(const porta_t porta) {
+        bool livre = false;
+        return _portas[porta]->ocupada.compare_exchange_strong(
+            livre, true, std::memory_order_acquire);
+    }
+
+    void _inicia(worker_t& w, job_t job, const bool roubado) {
+        typename Reactor::sessao_t& sessao = w.sessoes[job.porta];
+        if (sessao == Reactor::SESSAO_INVALIDA) {
+            sessao = w.reactor.adiciona(_portas[job.porta]->porta);
+            if (sessao != Reactor::SESSAO_INVALIDA) {
+                w.reactor.fsm(sessao).setSessao(true);
+                if (w.execucoes.size() <= sessao)
+                    w.execucoes.resize(sessao + 1);
+            }
+        }
+
+        const bool vazio = job.comandos.empty();
+        std::unique_ptr<execucao_t> execucao(
+            new execucao_t{std::move(job), 0, roubado});
+        if (sessao == Reactor::SESSAO_INVALIDA || vazio) {
+            _conclui(w, *execucao,
+                     vazio ? FSM::status_t::Sucesso
+                           : FSM::status_t::Processando,
+                     false);
+            return;
+        }
+
+        w.execucoes[sessao] = std::move(execucao);
+        _proximoComando(w, sessao);
+    }
+
+    // inicia a leitura do comando atual do job. Se a porta não pôde ser
+    // aguardada, o reactor não entregará conclusão: o job é concluído aqui.
+    void _proximoComando(worker_t& w, const typename Reactor::sessao_t sessao) {
+        execucao_t& e = *w.execucoes[sessao];
+        const std::size_t comando = e.comando;
+        auto& resposta = e.job.resposta;
+        if (w.reactor.leitura(
+                sessao, e.job.comandos[comando],
+                [&resposta, comando](const NBR14522::resposta_t& rsp) {
+                    if (resposta)
+                        resposta(comando, rsp);
+                },
+                e.job.timeout_resposta_ms))
+            return;
+
+        std::unique_ptr<execucao_t> execucao = std::move(w.execucoes[sessao]);
+        _conclui(w, *execucao, FSM::status_t::Processando, false);
+    }
+
+    void _trataConclusao(worker_t& w,
+                         const typename Reactor::conclusao_t& conclusao) {
+        execucao_t& e = *w.execucoes[conclusao.sessao];
+        const bool sucesso = conclusao.status == FSM::status_t::Sucesso &&
+                             !conclusao.excedeuTimeout;
+        if (sucesso) {
+            w.estatisticas.comandos++;
+            if (++e.comando < e.job.comandos.size()) {
+                _proximoComando(w, conclusao.sessao);
+                return;
+            }
+        }
+
+        std::unique_ptr<execucao_t> execucao =
+            std::move(w.execucoes[conclusao.sessao]);
+        _conclui(w, *execucao, conclusao.status, conclusao.excedeuTimeout);
+    }
+
+    void _conclui(worker_t& w, execucao_t& e,
+                  const typename FSM::status_t status,
+                  const bool excedeuTimeout) {
+        w.estatisticas.jobs++;
+        if (e.roubado)
+            w.estatisticas.roubados++;
+        if (e.comando < e.job.comandos.size())
+            w.estatisticas.falhas++;
+
+        _portas[e.job.porta]->ocupada.store(false, std::memory_order_release);
+
+        if (e.job.conclusao)
+            e.job.conclusao(
+                {e.job.porta, w.indice, e.comando, status, excedeuTimeout});
+
+        bool todos;
+        {
+            std::lock_guard<std::mutex> trava(_mutex);
+            _geracao++; // a porta liberada pode ter jobs na fila
+            todos = --_pendentes == 0;
+        }
+        _cv.notify_all();
+        if (todos)
+            _cvConcluidos.notify_all();
+    }
+
+    // chamada pela própria thread do worker
+    void _fixaNucleo(const worker_t& w) {
+        const unsigned nucleos = std::thread::hardware_concurrency();
+        if (!nucleos)
+            return;
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(w.indice % nucleos, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+};
+
+template <class TimerPolicy, class SerialPolicy>
+constexpr int LeitorPool<TimerPolicy, SerialPolicy>::INTERVALO_FILAS_MS;
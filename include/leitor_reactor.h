@@ -0,0 +1,427 @@
+#pragma once
+
+// Leituras simultâneas de muitos medidores em uma única thread (Linux): o
+// reactor possui um LeitorFSM por porta, aguarda todas as portas com um único
+// epoll_wait(2) e um heap de timers com o próximo deadline do protocolo de
+// cada sessão, e chama processaEstado() somente das sessões que receberam
+// bytes ou cujo timer expirou. O fim de cada leitura (sucesso ou falha) é
+// entregue em uma fila de conclusões, consumida com proximaConclusao().
+// Com TimerPolicyRoda (timer/roda_timers.h), o heap dá lugar à roda de timers
+// da thread: armar e cancelar são O(1) e as sessões são avisadas ao expirar.
+// As respostas são recebidas na ArenaRespostas da sessão; o callback pode
+// retê-las sem cópia com retem().
+//
+// Uso típico:
+//
+//     LeitorReactor<TimerPolicyWinUnix, SerialPolicyUnix<>> reactor;
+//     for (auto& porta : portas)
+//         ids.push_back(reactor.adiciona(porta));
+//     for (auto id : ids)
+//         reactor.leitura(id, comando, callback, 5000);
+//     while (reactor.ativas()) {
+//         reactor.processa(-1);
+//         while (reactor.proximaConclusao(conclusao))
+//             ...
+//     }
+//
+// Requisitos de SerialPolicy, além de tx() e rx(): fd() (descritor para o
+// epoll) e, se a policy guarda em espaço de usuário bytes já lidos do
+// descritor, rxPendentes() (ver SerialUnix). TimerPolicy deve fornecer
+// deadline().
+
+#include <arena_respostas.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <leitor_fsm.h>
+#include <memory>
+#include <queue>
+#include <serial/deadline.h>
+#include <sys/epoll.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+template <class TimerPolicy, class SerialPolicy> class LeitorReactor {
+  public:
+    using FSM = LeitorFSM<TimerPolicy, SerialPolicy>;
+    using sessao_t = std::size_t;
+    using deadline_t = decltype(std::declval<const TimerPolicy&>().deadline());
+    using callback_t = std::function<void(const NBR14522::resposta_t& rsp)>;
+
+    static constexpr sessao_t SESSAO_INVALIDA = static_cast<sessao_t>(-1);
+
+    typedef struct {
+        sessao_t sessao;
+        typename FSM::status_t status;
+        // leitura interrompida pelo timeout informado em leitura(); status é
+        // o do LeitorFSM no momento da interrupção
+        bool excedeuTimeout;
+        // leitura interrompida porque a porta foi fechada ou apresentou erro
+        // (EPOLLHUP/EPOLLERR, e.g. conversor USB desconectado)
+        bool portaFechada;
+    } conclusao_t;
+
+    typedef struct {
+        std::uint64_t esperas;        // epoll_wait(2)
+        std::uint64_t eventos;        // descritores sinalizados
+        std::uint64_t timeouts;       // timers expirados
+        std::uint64_t processamentos; // chamadas a processaEstado()
+    } estatisticas_t;
+
+    // maxEventos: descritores tratados por epoll_wait(2)
+    explicit LeitorReactor(const std::size_t maxEventos = 64)
+        : _eventos(maxEventos) {
+        _epoll = epoll_create1(EPOLL_CLOEXEC);
+    }
+
+    ~LeitorReactor() {
+        if (_epoll >= 0)
+            close(_epoll);
+    }
+
+    LeitorReactor(const LeitorReactor&) = delete;
+    LeitorReactor& operator=(const LeitorReactor&) = delete;
+
+    bool ok() const { return _epoll >= 0; }
+
+    // registra uma porta já aberta. Retorna o identificador da sessão, ou
+    // SESSAO_INVALIDA se o descritor não pôde ser registrado.
+    sessao_t adiciona(sptr<SerialPolicy> porta) {
+        const sessao_t id = _sessoes.size();
+
+        // a porta só fica no epoll durante uma leitura (ver _interesse()):
+        // fora dela, os ENQs do medidor e o EPOLLHUP de uma porta fechada
+        // acordariam o epoll continuamente. Aqui só verifica que o
+        // descritor pode ser aguardado.
+        struct epoll_event ev = {};
+        ev.data.u64 = id;
+        if (_epoll < 0 || epoll_ctl(_epoll, EPOLL_CTL_ADD, porta->fd(), &ev))
+            return SESSAO_INVALIDA;
+        epoll_ctl(_epoll, EPOLL_CTL_DEL, porta->fd(), nullptr);
+
+        _sessoes.emplace_back(new sessao_interna_t(porta));
+        _avisaExpiracao(id, usa_roda_t());
+        return id;
+    }
+
+    // remove a sessão; uma leitura em andamento é abandonada sem conclusão
+    void remove(const sessao_t id) {
+        if (!_valida(id))
+            return;
+        if (_sessoes[id]->ativa)
+            _ativas--;
+        _interesse(id, 0);
+        _sessoes[id].reset();
+    }
+
+    // inicia uma leitura na sessão. As respostas são entregues a callback; o
+    // fim da leitura, à fila de conclusões. Com timeout_resposta_ms, a
+    // leitura é interrompida se nenhuma resposta chegar nesse tempo (como em
+    // Leitor::leitura()). Se a porta for fechada ou apresentar erro, a
+    // leitura é concluída com portaFechada.
+    bool leitura(const sessao_t id, const NBR14522::comando_t& comando,
+                 callback_t callback, const uint32_t timeout_resposta_ms = 0) {
+        if (!_valida(id) || _sessoes[id]->ativa)
+            return false;
+
+        sessao_interna_t& s = *_sessoes[id];
+        s.timeoutResposta_ms = timeout_resposta_ms;
+        if (timeout_resposta_ms)
+            s.limite.setTimeout(timeout_resposta_ms);
+
+        s.fsm.setCallback([this, id, callback](const NBR14522::resposta_t& r) {
+            sessao_interna_t& s = *_sessoes[id];
+            if (s.timeoutResposta_ms)
+                s.limite.setTimeout(s.timeoutResposta_ms);
+            if (callback)
+                callback(r);
+        });
+        s.fsm.setComando(comando);
+
+        if (!_interesse(id, EPOLLIN))
+            return false;
+        s.ativa = true;
+        _ativas++;
+
+        _avanca(id);
+        return true;
+    }
+
+    // aguarda até timeout_ms (-1: indefinidamente; 0: não aguarda) por bytes
+    // em qualquer porta ou pelo próximo timer, e avança as sessões afetadas.
+    // Retorna a quantidade de leituras concluídas.
+    std::size_t processa(const int timeout_ms = -1) {
+        const std::size_t concluidas = _conclusoes.size();
+
+        int espera = timeout_ms;
+        const int ms = _msAteProximoTimer(usa_roda_t());
+        if (ms >= 0 && (espera < 0 || ms < espera))
+            espera = ms;
+
+        int n = epoll_wait(_epoll, _eventos.data(),
+                           static_cast<int>(_eventos.size()), espera);
+        _estatisticas.esperas++;
+
+        for (int i = 0; i < n; i++) {
+            const sessao_t id = _eventos[i].data.u64;
+            _estatisticas.eventos++;
+            if (!_valida(id) || !_sessoes[id]->ativa)
+                continue;
+            // bytes recebidos antes do fechamento ainda são processados
+            _avanca(id);
+            // EPOLLHUP e EPOLLERR continuam sinalizados: sem concluir a
+            // leitura, epoll_wait() retornaria de imediato indefinidamente
+            if ((_eventos[i].events & (EPOLLHUP | EPOLLERR)) &&
+                _valida(id) && _sessoes[id]->ativa)
+                _conclui(id, false, true);
+        }
+
+        _venceTimers(usa_roda_t());
+
+        return _conclusoes.size() - concluidas;
+    }
+
+    bool proximaConclusao(conclusao_t& conclusao) {
+        if (_conclusoes.empty())
+            return false;
+        conclusao = _conclusoes.front();
+        _conclusoes.pop_front();
+        return true;
+    }
+
+    // sessões com leitura em andamento
+    std::size_t ativas() const { return _ativas; }
+
+    // LeitorFSM da sessão, para consultar contadores e status
+    FSM& fsm(const sessao_t id) { return _sessoes.at(id)->fsm; }
+
+    // de dentro do callback da leitura: retém a resposta entregue, sem
+    // cópia. As respostas são recebidas na arena da sessão, e a view
+    // continua válida após o callback, até ser destruída (antes de remove());
+    // a recepção continua em outro bloco da arena.
+    ArenaRespostas::Resposta retem(const sessao_t id) {
+        sessao_interna_t& s = *_sessoes.at(id);
+        ArenaRespostas::Resposta resposta = s.arena.retem();
+        s.fsm.recebeEm(s.arena.recepcao());
+        return resposta;
+    }
+
+    // arena de respostas da sessão, para consultar o pico de memória
+    const ArenaRespostas& arena(const sessao_t id) const {
+        return _sessoes.at(id)->arena;
+    }
+
+    const estatisticas_t& estatisticas() const { return _estatisticas; }
+    void zeraEstatisticas() { _estatisticas = {}; }
+
+  private:
+    struct sessao_interna_t {
+        sessao_interna_t(sptr<SerialPolicy> p) : porta(p), fsm(p) {
+            fsm.recebeEm(arena.recepcao());
+        }
+
+        sptr<SerialPolicy> porta;
+        ArenaRespostas arena; // respostas recebidas pelo fsm
+        FSM fsm;
+        bool ativa = false;
+        std::uint32_t eventos = 0; // interesse registrado no epoll
+        TimerPolicy limite;        // timeout informado pelo usuário
+        uint32_t timeoutResposta_ms = 0;
+        // timer válido no heap (max(): nenhum) e sua geração: entradas com
+        // geração diferente foram substituídas e são descartadas ao chegar
+        // ao topo
+        deadline_t agendado = deadline_t::max();
+        std::uint32_t geracao = 0;
+    };
+
+    typedef struct {
+        deadline_t deadline;
+        sessao_t sessao;
+        std::uint32_t geracao;
+    } timer_t;
+
+    struct timerPosterior {
+        bool operator()(const timer_t& a, const timer_t& b) const {
+            return a.deadline > b.deadline;
+        }
+    };
+
+    int _epoll = -1;
+    std::vector<std::unique_ptr<sessao_interna_t>> _sessoes;
+    std::vector<struct epoll_event> _eventos;
+    std::priority_queue<timer_t, std::vector<timer_t>, timerPosterior> _timers;
+    std::vector<sessao_t> _expiradas; // avisadas pela roda de timers
+    std::deque<conclusao_t> _conclusoes;
+    std::size_t _ativas = 0;
+    estatisticas_t _estatisticas = {};
+
+    bool _valida(const sessao_t id) const {
+        return id < _sessoes.size() && _sessoes[id];
+    }
+
+    // eventos aguardados na porta da sessão; sem eventos, o descritor sai do
+    // epoll
+    bool _interesse(const sessao_t id, const std::uint32_t eventos) {
+        sessao_interna_t& s = *_sessoes[id];
+        if (s.eventos == eventos)
+            return true;
+        struct epoll_event ev = {};
+        ev.events = eventos;
+        ev.data.u64 = id;
+        const int op = !eventos    ? EPOLL_CTL_DEL
+                       : s.eventos ? EPOLL_CTL_MOD
+                                   : EPOLL_CTL_ADD;
+        if (epoll_ctl(_epoll, op, s.porta->fd(), &ev))
+            return false;
+        s.eventos = eventos;
+        return true;
+    }
+
+    // processa a sessão até consumir os bytes já recebidos, conclui a leitura
+    // ou reagenda seu timer
+    void _avanca(const sessao_t id) {
+        sessao_interna_t& s = *_sessoes[id];
+
+        typename FSM::estado_t estado;
+        do {
+            estado = s.fsm.processaEstado();
+            _estatisticas.processamentos++;
+        } while (estado != FSM::estado_t::AguardaNovoComando &&
+                 _rxPendentes(*s.porta, 0));
+
+        bool excedeuTimeout = false;
+        if (estado != FSM::estado_t::AguardaNovoComando) {
+            excedeuTimeout = s.timeoutResposta_ms && s.limite.timedOut();
+            if (!excedeuTimeout) {
+                _agenda(id, s);
+                return;
+            }
+        }
+
+        _conclui(id, excedeuTimeout, false);
+    }
+
+    void _conclui(const sessao_t id, const bool excedeuTimeout,
+                  const bool portaFechada) {
+        sessao_interna_t& s = *_sessoes[id];
+        s.ativa = false;
+        _ativas--;
+        _interesse(id, 0);
+        _cancelaTimer(s);
+        _conclusoes.push_back(
+            {id, s.fsm.status(), excedeuTimeout, portaFechada});
+    }
+
+    // TimerPolicy com roda de timers da thread (TimerPolicyRoda::roda())
+    template <class T>
+    static auto _temRoda(int) -> decltype(T::roda(), std::true_type());
+    template <class T> static std::false_type _temRoda(long);
+    using usa_roda_t = decltype(_temRoda<TimerPolicy>(0));
+
+    // roda: os timers da sessão (o do protocolo e o do usuário) avisam ao
+    // expirar, e não há o que agendar
+    void _avisaExpiracao(const sessao_t id, std::true_type) {
+        sessao_interna_t& s = *_sessoes[id];
+        s.fsm.timer().aoExpirar([this, id]() { _expiradas.push_back(id); });
+        s.limite.aoExpirar([this, id]() { _expiradas.push_back(id); });
+    }
+    void _avisaExpiracao(const sessao_t, std::false_type) {}
+
+    void _agenda(const sessao_t id, sessao_interna_t& s) {
+        _agenda(id, s, usa_roda_t());
+    }
+    void _agenda(const sessao_t, sessao_interna_t&, std::true_type) {}
+    void _agenda(const sessao_t id, sessao_interna_t& s, std::false_type) {
+        deadline_t deadline = deadline_t::max();
+        s.fsm.proximoDeadline(deadline);
+        if (s.timeoutResposta_ms && s.limite.deadline() < deadline)
+            deadline = s.limite.deadline();
+
+        if (deadline == s.agendado)
+            return;
+        if (deadline == deadline_t::max()) {
+            _cancelaTimer(s);
+            return;
+        }
+        s.agendado = deadline;
+        _timers.push({deadline, id, ++s.geracao});
+    }
+
+    void _cancelaTimer(sessao_interna_t& s) {
+        if (s.agendado != deadline_t::max()) {
+            s.agendado = deadline_t::max();
+            s.geracao++;
+        }
+    }
+
+    // ms até o próximo timer, ou -1 se não há timers
+    int _msAteProximoTimer(std::true_type) {
+        // expirações avisadas durante o avanca() de outro reactor da thread
+        if (!_expiradas.empty())
+            return 0;
+        deadline_t deadline;
+        if (!TimerPolicy::roda().proximoDeadline(deadline))
+            return -1;
+        return msAteDeadline(deadline);
+    }
+    int _msAteProximoTimer(std::false_type) {
+        if (!_descartaTimersInvalidos())
+            return -1;
+        return msAteDeadline(_timers.top().deadline);
+    }
+
+    void _venceTimers(std::true_type) {
+        // os callbacks só são chamados dentro de avanca(): _avanca() não
+        // altera _expiradas
+        TimerPolicy::roda().avanca();
+        for (const sessao_t id : _expiradas) {
+            if (_valida(id) && _sessoes[id]->ativa) {
+                _estatisticas.timeouts++;
+                _avanca(id);
+            }
+        }
+        _expiradas.clear();
+    }
+
+    void _venceTimers(std::false_type) {
+        // somente os timers vencidos até aqui: os reagendados por _avanca()
+        // ficam para a próxima chamada
+        const auto agora = deadline_t::clock::now();
+        while (_descartaTimersInvalidos() && _timers.top().deadline <= agora) {
+            const sessao_t id = _timers.top().sessao;
+            _timers.pop();
+            _sessoes[id]->agendado = deadline_t::max();
+            _estatisticas.timeouts++;
+            _avanca(id);
+        }
+    }
+
+    // remove do topo do heap os timers substituídos ou de sessões removidas.
+    // Retorna true se restou algum timer válido.
+    bool _descartaTimersInvalidos() {
+        while (!_timers.empty()) {
+            const timer_t& t = _timers.top();
+            if (_valida(t.sessao) && _sessoes[t.sessao]->geracao == t.geracao)
+                return true;
+            _timers.pop();
+        }
+        return false;
+    }
+
+    template <class S>
+    static auto _rxPendentes(const S& porta, int)
+        -> decltype(porta.rxPendentes() > 0) {
+        return porta.rxPendentes() > 0;
+    }
+
+    // policies sem buffer em espaço de usuário
+    template <class S> static bool _rxPendentes(const S&, long) {
+        return false;
+    }
+};
+
+template <class TimerPolicy, class SerialPolicy>
+constexpr typename LeitorReactor<TimerPolicy, SerialPolicy>::sessao_t
+    LeitorReactor<TimerPolicy, SerialPolicy>::SESSAO_INVALIDA;
@@ -4,9 +4,7 @@
 class LogPolicyNull {
   public:
     template <typename... Args>
-    static void log(char const* const format, Args const&... args) noexcept {
-        // printf(format, args...);
-    }
+    static void log(char const* const, Args const&...) noexcept {}
 };
 
 class LogPolicyStdout {
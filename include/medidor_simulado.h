@@ -0,0 +1,291 @@
+#pragma once
+
+// Lado medidor do protocolo NBR14522, sem I/O: os bytes transmitidos pelo
+// leitor são entregues em recebe() e os bytes a transmitir ao leitor são
+// retirados com transmite(). O tempo é sempre passado pelo chamador, que
+// também é responsável por cadenciar a transmissão conforme o baudrate (ver
+// apps/simulador-medidor). Usado como substituto dos medidores em testes de
+// carga e nos testes unitários.
+//
+// Comportamento:
+// - transmite ENQ periodicamente enquanto ocioso;
+// - responde aos comandos de isValidCodeCommand() com respostas sintéticas
+//   (código, número de série, payload determinístico e CRC), e com
+//   CodigoInformacaoDeComandoNaoImplementado aos demais;
+// - comandos compostos (isComposedCodeCommand()) geram
+//   configuracao_t::respostasCompostas respostas, a última com o bit 0x10 do
+//   byte 5 setado, cada uma transmitida após o ACK da anterior;
+// - responde NAK a comandos com CRC incorreto e retransmite a resposta ao
+//   receber NAK;
+// - pode responder WAIT, NAK ou corromper um byte da resposta (ruído) com as
+//   probabilidades configuradas, em milésimos.
+
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class MedidorSimulado {
+  public:
+    using clock = std::chrono::steady_clock;
+    using instante_t = clock::time_point;
+
+    typedef struct {
+        NBR14522::medidor_num_serie_t numSerie;
+        uint32_t periodoEnq_ms;
+        uint32_t respostasCompostas;
+        uint32_t permilWait;  // WAIT ao invés da resposta
+        uint32_t permilNak;   // NAK a um comando correto
+        uint32_t permilRuido; // um byte da resposta corrompido
+        uint32_t semente;
+    } configuracao_t;
+
+    typedef struct {
+        uint32_t enqs;
+        uint32_t comandos;
+        uint32_t respostas;
+        uint32_t waits;
+        uint32_t naksTransmitidos;
+        uint32_t naksRecebidos;
+        uint32_t acksRecebidos;
+        uint32_t respostasCorrompidas;
+    } estatisticas_t;
+
+    static configuracao_t configuracaoPadrao() {
+        return {{0x12, 0x34, 0x56, 0x78},
+                NBR14522::TAVGENQ_MSEC,
+                3,
+                0,
+                0,
+                0,
+                1};
+    }
+
+    MedidorSimulado(const configuracao_t& configuracao = configuracaoPadrao())
+        : _configuracao(configuracao), _aleatorio(configuracao.semente | 1) {}
+
+    // bytes transmitidos pelo leitor
+    void recebe(const byte_t* data, const size_t data_sz,
+                const instante_t agora) {
+        for (size_t i = 0; i < data_sz; i++)
+            _recebe(data[i], agora);
+    }
+
+    // retira até max_data_sz bytes a transmitir ao leitor
+    size_t transmite(byte_t* data, const size_t max_data_sz,
+                     const instante_t agora) {
+        processa(agora);
+
+        size_t sz = _saida.size() - _saidaLidos;
+        if (sz > max_data_sz)
+            sz = max_data_sz;
+        for (size_t i = 0; i < sz; i++)
+            data[i] = _saida[_saidaLidos + i];
+
+        _saidaLidos += sz;
+        if (_saidaLidos == _saida.size()) {
+            _saida.clear();
+            _saidaLidos = 0;
+        }
+
+        return sz;
+    }
+
+    // bytes aguardando transmissão
+    size_t pendentes() const { return _saida.size() - _saidaLidos; }
+
+    // trata os eventos temporais (ENQ periódico e timeouts)
+    void processa(const instante_t agora) {
+        switch (_estado) {
+        case Ocioso:
+            if (agora >= _proximoEnq) {
+                _transmiteEnq(agora);
+                _estatisticas.enqs++;
+            }
+            break;
+        case RecebendoComando:
+            if (agora >= _timeout) {
+                // comando incompleto: descarta
+                _estado = Ocioso;
+                _proximoEnq = agora;
+            }
+            break;
+        case AguardandoAck:
+            if (agora >= _timeout) {
+                // "se após o tempo permitido para a leitora enviar ACK este
+                // ainda não foi enviado, o medidor deve enviar ENQ
+                // aguardando o recebimento do ACK"
+                if (++_enqsSemAck > NBR14522::MAX_COMANDO_SEM_RESPOSTA) {
+                    _estado = Ocioso;
+                    _proximoEnq = agora;
+                } else {
+                    _transmiteEnq(agora);
+                    _timeout =
+                        agora + std::chrono::milliseconds(
+                                    NBR14522::TMAXRSP_MSEC);
+                }
+            }
+            break;
+        }
+    }
+
+    // próximo instante em que processa() tem algo a fazer
+    instante_t proximoEvento() const {
+        return _estado == Ocioso ? _proximoEnq : _timeout;
+    }
+
+    const estatisticas_t& estatisticas() const { return _estatisticas; }
+    const configuracao_t& configuracao() const { return _configuracao; }
+
+  private:
+    typedef enum { Ocioso, RecebendoComando, AguardandoAck } estado_t;
+
+    configuracao_t _configuracao;
+    estatisticas_t _estatisticas = {};
+    estado_t _estado = Ocioso;
+    instante_t _proximoEnq = instante_t::min();
+    instante_t _timeout;
+    uint32_t _aleatorio;
+
+    NBR14522::comando_t _comando;
+    size_t _comandoBytesLidos = 0;
+    // comando que recebeu WAIT: será respondido na retransmissão
+    bool _comandoAtrasado = false;
+
+    NBR14522::resposta_t _resposta;
+    uint32_t _respostaIndice = 0;
+    uint32_t _enqsSemAck = 0;
+
+    std::vector<byte_t> _saida;
+    size_t _saidaLidos = 0;
+
+    void _recebe(const byte_t byte, const instante_t agora) {
+        switch (_estado) {
+        case Ocioso:
+            // sinalizadores fora de sequência são ignorados
+            if (byte == NBR14522::ACK || byte == NBR14522::NAK)
+                break;
+            _comando.at(0) = byte;
+            _comandoBytesLidos = 1;
+            _estado = RecebendoComando;
+            _timeout =
+                agora + std::chrono::milliseconds(NBR14522::TMAXCAR_MSEC);
+            break;
+        case RecebendoComando:
+            _comando.at(_comandoBytesLidos++) = byte;
+            _timeout =
+                agora + std::chrono::milliseconds(NBR14522::TMAXCAR_MSEC);
+            if (_comandoBytesLidos == NBR14522::COMANDO_SZ)
+                _comandoRecebido(agora);
+            break;
+        case AguardandoAck:
+            if (byte == NBR14522::ACK) {
+                _estatisticas.acksRecebidos++;
+                if (NBR14522::isComposedCodeCommand(_resposta.at(0)) &&
+                    !NBR14522::isLastRespostaOfComposed(_resposta)) {
+                    _respostaIndice++;
+                    _montaResposta();
+                    _transmiteResposta(agora);
+                } else {
+                    _estado = Ocioso;
+                    _proximoEnq = agora + std::chrono::milliseconds(
+                                              _configuracao.periodoEnq_ms);
+                }
+            } else if (byte == NBR14522::NAK) {
+                _estatisticas.naksRecebidos++;
+                _transmiteResposta(agora);
+            }
+            // demais bytes são ignorados
+            break;
+        }
+    }
+
+    void _comandoRecebido(const instante_t agora) {
+        _estatisticas.comandos++;
+        _estado = Ocioso;
+        _proximoEnq =
+            agora + std::chrono::milliseconds(_configuracao.periodoEnq_ms);
+
+        if (CRC16(_comando.data(), _comando.size()) != 0x0000 ||
+            _sorteia(_configuracao.permilNak)) {
+            _transmiteSinalizador(NBR14522::NAK);
+            _estatisticas.naksTransmitidos++;
+            return;
+        }
+
+        if (!_comandoAtrasado && _sorteia(_configuracao.permilWait)) {
+            // o leitor retransmite o comando no próximo ENQ
+            _comandoAtrasado = true;
+            _transmiteSinalizador(NBR14522::WAIT);
+            _estatisticas.waits++;
+            return;
+        }
+        _comandoAtrasado = false;
+
+        _respostaIndice = 0;
+        _montaResposta();
+        _transmiteResposta(agora);
+    }
+
+    void _montaResposta() {
+        byte_t codigo = _comando.at(0);
+        if (!NBR14522::isValidCodeCommand(codigo))
+            codigo = NBR14522::CodigoInformacaoDeComandoNaoImplementado;
+
+        _resposta.at(0) = codigo;
+        for (size_t i = 0; i < _configuracao.numSerie.size(); i++)
+            _resposta.at(1 + i) = _configuracao.numSerie.at(i);
+
+        _resposta.at(5) = 0x00;
+        if (NBR14522::isComposedCodeCommand(codigo) &&
+            _respostaIndice + 1 >= _configuracao.respostasCompostas)
+            _resposta.at(5) = 0x10;
+
+        for (size_t i = 6; i < NBR14522::RESPOSTA_SZ - 2; i++)
+            _resposta.at(i) = static_cast<byte_t>(i + _respostaIndice);
+
+        NBR14522::setCRC(_resposta,
+                         CRC16(_resposta.data(), _resposta.size() - 2));
+    }
+
+    void _transmiteResposta(const instante_t agora) {
+        _estado = AguardandoAck;
+        _enqsSemAck = 0;
+        // o prazo do leitor começa após a transmissão da resposta inteira
+        _timeout = agora + std::chrono::milliseconds(
+                               NBR14522::TMAXRSP_MSEC +
+                               NBR14522::RESPOSTA_SZ * NBR14522::TCAR_MSEC);
+
+        size_t inicio = _saida.size();
+        _saida.insert(_saida.end(), _resposta.begin(), _resposta.end());
+        _estatisticas.respostas++;
+
+        if (_sorteia(_configuracao.permilRuido)) {
+            _saida[inicio + 6 + _proximoAleatorio() % 250] ^= 0x5A;
+            _estatisticas.respostasCorrompidas++;
+        }
+    }
+
+    void _transmiteEnq(const instante_t agora) {
+        _transmiteSinalizador(NBR14522::ENQ);
+        _proximoEnq =
+            agora + std::chrono::milliseconds(_configuracao.periodoEnq_ms);
+    }
+
+    void _transmiteSinalizador(const byte_t sinalizador) {
+        _saida.push_back(sinalizador);
+    }
+
+    bool _sorteia(const uint32_t permil) {
+        return permil && _proximoAleatorio() % 1000 < permil;
+    }
+
+    // xorshift32
+    uint32_t _proximoAleatorio() {
+        _aleatorio ^= _aleatorio << 13;
+        _aleatorio ^= _aleatorio >> 17;
+        _aleatorio ^= _aleatorio << 5;
+        return _aleatorio;
+    }
+};
@@ -0,0 +1,756 @@
+#pragma once
+
+// Lado leitor do protocolo NBR14522, sem I/O: os bytes recebidos do medidor
+// são entregues em recebe(), junto com o instante atual, e os bytes a
+// transmitir, o próximo deadline, as respostas e o status são consultados
+// após cada chamada, conforme os eventos retornados. Não depende de
+// SerialPolicy nem de TimerPolicy e não aloca memória: um laço de eventos
+// próprio atende milhares de sessões com uma instância por medidor.
+//
+//     ProtocoloLeitor protocolo;
+//     protocolo.setComando(comando, agora);
+//     // a cada bloco recebido (ou timer vencido: processa(agora))
+//     while (consumidos < n) {
+//         auto r = protocolo.recebe(data + consumidos, n - consumidos, agora);
+//         consumidos += r.consumidos;
+//         if (r.eventos & ProtocoloLeitor::EventoDescarte)
+//             ...; // descarta os bytes ainda não lidos da porta
+//         if (r.eventos & ProtocoloLeitor::EventoTransmissao)
+//             ...; // transmite protocolo.transmissao(sz)
+//         if (r.eventos & ProtocoloLeitor::EventoResposta)
+//             ...; // trata protocolo.resposta()
+//     }
+//     protocolo.proximoDeadline(deadline); // até quando o laço pode dormir
+//
+// O tempo pode ser informado de duas formas: pelo instante passado a
+// recebe() e processa(), que vencem os timeouts pelo relógio do chamador, ou
+// por um timer externo, armado com timeout_ms() a cada EventoTimer e
+// notificado com expira() (ver LeitorFSM, que usa a TimerPolicy).
+//
+// No modo sessão (setSessao()), uma leitura concluída com a resposta do
+// medidor mantém o sincronismo: o comando seguinte, se iniciado em até
+// TMAXENQ após o ACK, é transmitido já no próximo ENQ, e não após dois. A
+// ociosidade da linha antes de cada comando é medida em metricas().
+//
+// A cadência dos ENQs do medidor é estimada (CadenciaEnq): proximoEnq()
+// informa quando acordar para ler o próximo ENQ, e o instante em que o
+// chamador de fato transmitiu a resposta a um ENQ, informado em
+// transmitido(), dá a margem até TMAXSINC em metricas().
+//
+// As respostas são recebidas em um buffer interno, ou diretamente em um
+// bloco do chamador (recebeEm(), e.g. de uma ArenaRespostas): sem cópia entre
+// o protocolo e quem guarda as respostas de um comando composto.
+
+#include <CRC.h>
+#include <NBR14522.h>
+#include <cadencia_enq.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+// estados e status da leitura, comuns ao protocolo e aos leitores sobre ele
+struct LeitorTipos {
+    typedef enum {
+        Dessincronizado,
+        Sincronizado,
+        ComandoTransmitido,
+        AtrasoDeSequenciaRecebido,
+        CodigoRecebido,
+        AguardaNovoComando,
+    } estado_t;
+
+    typedef enum {
+        Sucesso,
+        Processando,
+        ErroLimiteDeNAKsRecebidos,
+        ErroLimiteDeNAKsTransmitidos,
+        ErroLimiteDeTransmissoesSemRespostas,
+        ErroTempoSemWaitEsgotado,
+        ErroLimiteDeWaitsRecebidos,
+        ErroQuebraDeSequencia,
+        ErroAposRespostaRecebeNAK,
+        ErroSemRespostaAoAguardarProximaResposta,
+        ExcecaoOcorrenciaNoMedidor,
+        ExcecaoComandoNaoImplementado
+    } status_t;
+};
+
+class ProtocoloLeitor : public LeitorTipos {
+  public:
+    using clock = std::chrono::steady_clock;
+    using instante_t = clock::time_point;
+
+    // eventos ocorridos durante uma chamada (bits de resultado_t::eventos)
+    enum : uint32_t {
+        EventoSincronizou = 1u << 0,        // ENQ recebido fora de sincronismo
+        EventoComandoTransmitido = 1u << 1, // comando transmitido ou repetido
+        EventoSinalizador = 1u << 2,        // ENQ, NAK ou WAIT após o comando
+        EventoResposta = 1u << 3,           // resposta íntegra (ACK a enviar)
+        EventoNakTransmitido = 1u << 4,     // resposta com CRC incorreto
+        EventoTimeout = 1u << 5,            // timeout do estado
+        EventoQuebraDeSequencia = 1u << 6,
+        EventoConcluido = 1u << 7, // leitura terminada (ver status())
+        // ações pedidas ao chamador
+        EventoTransmissao = 1u << 8, // bytes a transmitir (transmissao())
+        EventoTimer = 1u << 9,       // timeout rearmado (timeout_ms())
+        EventoDescarte = 1u << 10,   // descartar os bytes ainda não lidos
+    };
+
+    typedef struct {
+        std::size_t consumidos; // bytes processados ou descartados
+        uint32_t eventos;       // Evento*
+    } resultado_t;
+
+    typedef struct {
+        uint32_t comandos; // comandos transmitidos (um por leitura)
+        // dos quais transmitidos no primeiro ENQ, com o sincronismo mantido
+        // da leitura anterior (modo sessão)
+        uint32_t sincronizados;
+        // linha ociosa do início de cada leitura até a transmissão do
+        // comando, acumulada
+        clock::duration ociosidade;
+        // respostas a ENQ (comando ou ACK repetido) com a transmissão
+        // informada em transmitido(), das quais após TMAXSINC, e a margem
+        // até TMAXSINC: mínima (negativa se houve atraso) e acumulada
+        uint32_t respostasEnq;
+        uint32_t foraDeTmaxsinc;
+        clock::duration margemMinima;
+        clock::duration margemTotal;
+    } metricas_t;
+
+    // inicia a leitura do comando em agora. Cabe ao chamador descartar os
+    // bytes recebidos antes.
+    void setComando(const NBR14522::comando_t& comando,
+                    const instante_t agora) {
+        _comando = comando;
+        // o CRC é calculado uma única vez por comando, e não a cada
+        // retransmissão (nao incluir os dois ultimos bytes de CRC no calculo)
+        NBR14522::setCRC(_comando,
+                         CRC16(_comando.data(), _comando.size() - 2));
+        _agora = agora;
+        _inicioLeitura = agora;
+        _aguardaComando = true;
+        _status = Processando;
+        _transmissaoSz = 0;
+        _respondeEnq = false;
+
+        // o timeout armado com o ACK da leitura anterior continua valendo:
+        // sem ENQ até lá, o sincronismo é perdido como em Sincronizado
+        _iniciouSincronizado = sincronizado(agora);
+        _estado = _iniciouSincronizado ? Sincronizado : Dessincronizado;
+        _sincronizado = false;
+    }
+
+    // modo sessão: mantém o sincronismo entre leituras consecutivas
+    void setSessao(const bool sessao) { _sessao = sessao; }
+    bool sessao() const { return _sessao; }
+
+    // se o comando seguinte, iniciado agora, será transmitido no próximo ENQ
+    bool sincronizado(const instante_t agora) const {
+        return _sessao && _sincronizado && agora < _deadline;
+    }
+
+    // instante em que o chamador concluiu a transmissão pedida: se ela
+    // responde a um ENQ, mede a margem até TMAXSINC a partir do instante em
+    // que o ENQ foi entregue a recebe()
+    void transmitido(const instante_t agora) {
+        if (!_respondeEnq)
+            return;
+        _respondeEnq = false;
+        const clock::duration margem =
+            std::chrono::milliseconds(NBR14522::TMAXSINC_MSEC) -
+            (agora - _instanteEnq);
+        _metricas.respostasEnq++;
+        if (margem < clock::duration::zero())
+            _metricas.foraDeTmaxsinc++;
+        if (margem < _metricas.margemMinima)
+            _metricas.margemMinima = margem;
+        _metricas.margemTotal += margem;
+    }
+
+    // instante em que acordar para o próximo ENQ, enquanto a leitura aguarda
+    // um ENQ (Dessincronizado e Sincronizado). Um laço que consulta a porta
+    // periodicamente pode dormir até lá; os que aguardam a chegada de bytes
+    // (epoll, aguardaRx()) já acordam com o ENQ.
+    bool proximoEnq(instante_t& previsto) const {
+        if (_estado != Dessincronizado && _estado != Sincronizado)
+            return false;
+        return _cadencia.proximoEnq(previsto);
+    }
+
+    const CadenciaEnq& cadencia() const { return _cadencia; }
+
+    // recebe as próximas respostas diretamente em bloco (nullptr: no buffer
+    // interno). resposta() passa a ser o bloco; trocá-lo após EventoResposta
+    // preserva a resposta recebida. Os bytes de um bloco de dados em
+    // andamento são copiados para o novo bloco.
+    void recebeEm(NBR14522::resposta_t* bloco) {
+        NBR14522::resposta_t& atual = _buffer();
+        _destino = bloco;
+        if (_estado == CodigoRecebido && &_buffer() != &atual)
+            memcpy(_buffer().data(), atual.data(), _respostaBytesLidos);
+    }
+
+    // processa os bytes recebidos em agora. Os bytes ignorados fora de
+    // sincronismo são saltados com memchr(3) até o próximo ENQ, e os blocos
+    // de dados são copiados de uma vez.
+    //
+    // Retorna após a primeira transmissão pedida (EventoTransmissao), que
+    // deve ser feita antes de entregar os bytes restantes, ou ao terminar a
+    // leitura; consumidos < n somente nesses casos. Com EventoDescarte, os
+    // bytes restantes do bloco são consumidos (descartados).
+    resultado_t recebe(const byte_t* data, const std::size_t n,
+                       const instante_t agora) {
+        _eventos = 0;
+        _agora = agora;
+
+        // o timeout tem precedência sobre os sinalizadores recebidos; no
+        // bloco de dados, os bytes recebidos rearmam o timeout
+        if (_estado != CodigoRecebido)
+            _venceTimeout();
+
+        const byte_t* p = data;
+        const byte_t* const fim = data + n;
+        while (p != fim && _estado != AguardaNovoComando &&
+               !(_eventos & (EventoTransmissao | EventoDescarte))) {
+            if (_estado == CodigoRecebido) {
+                // bloco de dados: copiado de uma só vez, sem classificar os
+                // bytes
+                p += _recebeResposta(p, static_cast<std::size_t>(fim - p));
+                continue;
+            }
+
+            // fora de sincronismo, somente ENQ altera o estado
+            if (_estado == Dessincronizado || _estado == Sincronizado) {
+                const void* enq = memchr(p, NBR14522::ENQ, fim - p);
+                if (!enq) {
+                    p = fim;
+                    break;
+                }
+                p = static_cast<const byte_t*>(enq);
+            }
+
+            // sinalizadores: um byte por vez, tratado conforme a tabela de
+            // transições
+            const byte_t byte = *p++;
+            _executa(_transicao(_estado, _entrada(byte)), byte);
+        }
+
+        if (_eventos & EventoDescarte)
+            p = fim;
+        return _resultado(static_cast<std::size_t>(p - data));
+    }
+
+    // recepção do bloco de dados sem cópia: a porta lê diretamente na posição
+    // corrente do bloco de destino (até sz = bytesEsperados() bytes), e os
+    // bytes lidos são informados em recebidos(). nullptr fora do bloco de
+    // dados.
+    byte_t* posicaoResposta(std::size_t& sz) {
+        sz = 0;
+        if (_estado != CodigoRecebido)
+            return nullptr;
+        sz = bytesEsperados();
+        return &_buffer()[_respostaBytesLidos];
+    }
+
+    // n bytes escritos em posicaoResposta() em agora; equivale a recebe()
+    // com esses bytes
+    resultado_t recebidos(const std::size_t n, const instante_t agora) {
+        _eventos = 0;
+        _agora = agora;
+        std::size_t consumidos = 0;
+        if (_estado == CodigoRecebido && n)
+            consumidos = _respostaEscrita(n);
+        return _resultado(consumidos);
+    }
+
+    // vence o timeout do estado, caso o deadline tenha passado em agora
+    resultado_t processa(const instante_t agora) {
+        _eventos = 0;
+        _agora = agora;
+        _venceTimeout();
+        return _resultado(0);
+    }
+
+    // timer externo: o timeout armado por último (timeout_ms()) expirou. Os
+    // próximos deadlines continuam relativos ao último instante informado.
+    resultado_t expira() {
+        _eventos = 0;
+        if (aguardaTimeout())
+            _expira();
+        return _resultado(0);
+    }
+
+    // bytes a transmitir após EventoTransmissao: o comando (sem cópia) ou um
+    // sinalizador. Válidos até a próxima chamada.
+    const byte_t* transmissao(std::size_t& sz) const {
+        sz = _transmissaoSz;
+        return _transmissao;
+    }
+
+    // instante do próximo timeout do protocolo, caso o estado atual aguarde
+    // algum
+    bool proximoDeadline(instante_t& deadline) const {
+        if (!aguardaTimeout())
+            return false;
+        deadline = _deadline;
+        return true;
+    }
+
+    // duração do timeout armado por último (EventoTimer)
+    uint32_t timeout_ms() const { return _timeout_ms; }
+
+    bool aguardaTimeout() const { return _aguardaTimeout(_estado); }
+
+    // quantos bytes podem ser entregues a recebe() sem ultrapassar o bloco de
+    // dados corrente: um sinalizador por vez fora do bloco
+    std::size_t bytesEsperados() const {
+        switch (_estado) {
+        case AguardaNovoComando:
+            return 0;
+        case CodigoRecebido:
+            return NBR14522::RESPOSTA_SZ - _respostaBytesLidos;
+        default:
+            return 1;
+        }
+    }
+
+    estado_t estado() const { return _estado; }
+    status_t status() const { return _status; }
+    const NBR14522::resposta_t& resposta() const {
+        return _destino ? *_destino : _resposta;
+    }
+
+    uint32_t counterNakRecebido() const { return _counterNakRecebido; }
+    uint32_t counterNakTransmitido() const { return _counterNakTransmitido; }
+    uint32_t counterSemResposta() const { return _counterSemResposta; }
+    uint32_t counterWaitRecebido() const { return _counterWaitRecebido; }
+
+    // linha ociosa antes do comando da última leitura
+    clock::duration ociosidade() const { return _ociosidade; }
+    const metricas_t& metricas() const { return _metricas; }
+    void zeraMetricas() { _metricas = _metricasZeradas(); }
+
+  private:
+    estado_t _estado = AguardaNovoComando;
+    status_t _status = Processando;
+    NBR14522::comando_t _comando;
+    NBR14522::resposta_t _resposta;
+    NBR14522::resposta_t* _destino = nullptr; // recebeEm(); nulo: _resposta
+    size_t _respostaBytesLidos = 0;
+    CRC16State _crcResposta;
+    uint32_t _counterNakRecebido = 0;
+    uint32_t _counterNakTransmitido = 0;
+    uint32_t _counterSemResposta = 0;
+    uint32_t _counterWaitRecebido = 0;
+    bool _isRespostaComposta = false;
+    // tempo
+    instante_t _agora;
+    instante_t _deadline;
+    uint32_t _timeout_ms = 0;
+    // sessão
+    bool _sessao = false;
+    bool _sincronizado = false; // ACK transmitido ao fim da última leitura
+    bool _aguardaComando = false; // comando ainda não transmitido
+    // sincronismo mantido da leitura anterior, até a transmissão do comando
+    bool _iniciouSincronizado = false;
+    instante_t _inicioLeitura;
+    clock::duration _ociosidade = clock::duration::zero();
+    metricas_t _metricas = _metricasZeradas();
+    // cadência dos ENQs e resposta ao último ENQ, até transmitido()
+    CadenciaEnq _cadencia;
+    bool _respondeEnq = false;
+    instante_t _instanteEnq;
+    // saída da chamada corrente
+    uint32_t _eventos = 0; // Evento*
+    const byte_t* _transmissao = nullptr;
+    std::size_t _transmissaoSz = 0;
+    byte_t _sinal = 0; // ACK ou NAK a transmitir
+
+    static metricas_t _metricasZeradas() {
+        return {0,
+                0,
+                clock::duration::zero(),
+                0,
+                0,
+                clock::duration::max(),
+                clock::duration::zero()};
+    }
+
+    // buffer em que a resposta é recebida
+    NBR14522::resposta_t& _buffer() { return _destino ? *_destino : _resposta; }
+
+    // a transmissão pedida responde ao ENQ recebido agora
+    void _respostaAoEnq() {
+        _respondeEnq = true;
+        _instanteEnq = _agora;
+    }
+
+    resultado_t _resultado(const std::size_t consumidos) {
+        if (_estado == AguardaNovoComando)
+            _eventos |= EventoConcluido;
+        return {consumidos, _eventos};
+    }
+
+    void _arma(const uint32_t timeout_ms) {
+        _timeout_ms = timeout_ms;
+        _deadline = _agora + std::chrono::milliseconds(timeout_ms);
+        _eventos |= EventoTimer;
+    }
+
+    void _venceTimeout() {
+        if (aguardaTimeout() && _agora >= _deadline)
+            _expira();
+    }
+
+    void _expira() {
+        _eventos |= EventoTimeout;
+        if (_estado == CodigoRecebido)
+            _timeoutResposta();
+        else
+            _executa(_transicao(_estado, EntradaTimeout), 0);
+    }
+
+    void _transmite(const byte_t* data, const std::size_t sz) {
+        _respondeEnq = false;
+        _transmissao = data;
+        _transmissaoSz = sz;
+        _eventos |= EventoTransmissao;
+    }
+
+    void _transmiteSinal(const byte_t sinal) {
+        _sinal = sinal;
+        _transmite(&_sinal, 1);
+    }
+
+    void _transmiteComando() {
+        _transmite(_comando.data(), _comando.size());
+        _eventos |= EventoComandoTransmitido;
+    }
+
+    void _descarta() { _eventos |= EventoDescarte; }
+
+    // primeira transmissão do comando da leitura
+    void _contaOciosidade() {
+        if (!_aguardaComando)
+            return;
+        _aguardaComando = false;
+        _ociosidade = _agora - _inicioLeitura;
+        _metricas.comandos++;
+        _metricas.ociosidade += _ociosidade;
+        if (_iniciouSincronizado)
+            _metricas.sincronizados++;
+    }
+
+    // entradas dos estados que aguardam sinalizadores: a classe do byte
+    // recebido (NBR14522::ClasseByte) ou uma das entradas abaixo
+    typedef enum {
+        EntradaCodigoDoComando = NBR14522::ClasseCodigoDeInformacao + 1,
+        EntradaTimeout,
+        NUM_ENTRADAS
+    } entrada_t;
+
+    typedef enum {
+        Nada,
+        Sincroniza,
+        PerdeSincronismo,
+        IniciaComando,
+        SemResposta,
+        NakRecebido,
+        WaitRecebido,
+        IniciaResposta,
+        EnqRecebido,
+        QuebraDeSequencia,
+        TempoSemWaitEsgotado,
+        RetomaSequencia,
+        WaitRepetido,
+    } acao_t;
+
+    static constexpr std::size_t NUM_ESTADOS = AguardaNovoComando + 1;
+
+    static bool _aguardaTimeout(const estado_t estado) {
+        static constexpr bool aguarda[NUM_ESTADOS] = {
+            false, // Dessincronizado
+            true,  // Sincronizado
+            true,  // ComandoTransmitido
+            true,  // AtrasoDeSequenciaRecebido
+            true,  // CodigoRecebido
+            false, // AguardaNovoComando
+        };
+        return aguarda[estado];
+    }
+
+    // estado x entrada. CodigoRecebido e AguardaNovoComando não passam pela
+    // tabela (ver recebe()).
+    static acao_t _transicao(const estado_t estado, const unsigned entrada) {
+        constexpr acao_t Q = QuebraDeSequencia;
+        static constexpr acao_t transicoes[NUM_ESTADOS][NUM_ENTRADAS] = {
+            // colunas: Outro, ENQ, ACK, NAK, WAIT, CodigoDeComando (de outro
+            // comando), CodigoDeInformacao, CodigoDoComando, Timeout
+            // Dessincronizado
+            {Nada, Sincroniza, Nada, Nada, Nada, Nada, Nada, Nada, Nada},
+            // Sincronizado
+            {Nada, IniciaComando, Nada, Nada, Nada, Nada, Nada, Nada,
+             PerdeSincronismo},
+            // ComandoTransmitido
+            {Q, EnqRecebido, Q, NakRecebido, WaitRecebido, Q, IniciaResposta,
+             IniciaResposta, SemResposta},
+            // AtrasoDeSequenciaRecebido
+            {Q, RetomaSequencia, Q, Q, WaitRepetido, Q, Q, Q,
+             TempoSemWaitEsgotado},
+            // CodigoRecebido
+            {Nada, Nada, Nada, Nada, Nada, Nada, Nada, Nada, Nada},
+            // AguardaNovoComando
+            {Nada, Nada, Nada, Nada, Nada, Nada, Nada, Nada, Nada},
+        };
+        return transicoes[estado][entrada];
+    }
+
+    unsigned _entrada(const byte_t byte) const {
+        const NBR14522::ClasseByte classe = NBR14522::classeByte(byte);
+        // sinalizadores têm precedência sobre o código do comando
+        if (byte == _comando.at(0) &&
+            (classe == NBR14522::ClasseOutro ||
+             classe == NBR14522::ClasseCodigoDeComando))
+            return EntradaCodigoDoComando;
+        return classe;
+    }
+
+    void _executa(const acao_t acao, const byte_t byte) {
+        switch (acao) {
+        case Nada:
+            break;
+        case Sincroniza:
+            _cadencia.registra(_agora);
+            _eventos |= EventoSincronizou;
+            _estado = Sincronizado;
+            _arma(NBR14522::TMAXENQ_MSEC);
+            break;
+        case PerdeSincronismo:
+            _estado = Dessincronizado;
+            _iniciouSincronizado = false;
+            _descarta();
+            break;
+        case IniciaComando:
+            // o medidor não transmite ENQ até a resposta
+            _cadencia.registra(_agora);
+            _cadencia.invalida();
+            _transmiteComando();
+            _respostaAoEnq();
+            _contaOciosidade();
+            _counterNakRecebido = 0;
+            _counterNakTransmitido = 0;
+            _counterSemResposta = 0;
+            _counterWaitRecebido = 0;
+            _isRespostaComposta = false;
+            _arma(NBR14522::TMAXRSP_MSEC);
+            _estado = ComandoTransmitido;
+            break;
+        case SemResposta:
+            _descarta();
+            _counterSemResposta++;
+            if (_counterSemResposta == NBR14522::MAX_COMANDO_SEM_RESPOSTA) {
+                // falhou
+                _estado = AguardaNovoComando;
+                _status = ErroLimiteDeTransmissoesSemRespostas;
+            } else if (_isRespostaComposta) {
+                // falhou
+                _estado = AguardaNovoComando;
+                _status = ErroSemRespostaAoAguardarProximaResposta;
+            } else {
+                _transmiteComando();
+                _arma(NBR14522::TMAXRSP_MSEC);
+            }
+            break;
+        case NakRecebido:
+            _eventos |= EventoSinalizador;
+            _counterNakRecebido++;
+            if (_counterNakRecebido == NBR14522::MAX_BLOCO_NAK) {
+                // falha
+                _status = ErroLimiteDeNAKsRecebidos;
+                _estado = AguardaNovoComando;
+            } else if (_isRespostaComposta) {
+                // falha
+                _status = ErroAposRespostaRecebeNAK;
+                _estado = AguardaNovoComando;
+            } else {
+                _transmiteComando();
+                _arma(NBR14522::TMAXRSP_MSEC);
+            }
+            break;
+        case WaitRecebido:
+            _eventos |= EventoSinalizador;
+            _estado = AtrasoDeSequenciaRecebido;
+            _arma(NBR14522::TSEMWAIT_SEC * 1000);
+            break;
+        case IniciaResposta:
+            // código do comando
+            _buffer().at(0) = byte;
+            _respostaBytesLidos = 1;
+            _crcResposta.init();
+            _crcResposta.update(byte);
+            _arma(NBR14522::TMAXCAR_MSEC);
+            _estado = CodigoRecebido;
+            break;
+        case EnqRecebido:
+            _eventos |= EventoSinalizador;
+            if (_isRespostaComposta) {
+                // "se após o tempo permitido para a leitora enviar ACK
+                // este ainda não foi enviado, o medidor deve enviar ENQ
+                // aguardando o recebimento do ACK"
+
+                // retransmite ACK
+                _transmiteSinal(NBR14522::ACK);
+                _respostaAoEnq();
+                break;
+            }
+            _quebraDeSequencia();
+            break;
+        case QuebraDeSequencia:
+            _quebraDeSequencia();
+            break;
+        case TempoSemWaitEsgotado:
+            // falhou
+            _estado = AguardaNovoComando;
+            _status = ErroTempoSemWaitEsgotado;
+            break;
+        case RetomaSequencia:
+            _eventos |= EventoSinalizador;
+            _estado = ComandoTransmitido;
+            _transmiteComando();
+            _respostaAoEnq();
+            _arma(NBR14522::TMAXRSP_MSEC);
+            break;
+        case WaitRepetido:
+            _eventos |= EventoSinalizador;
+            _counterWaitRecebido++;
+            if (_counterWaitRecebido == NBR14522::MAX_BLOCO_WAIT) {
+                // falhou
+                _estado = AguardaNovoComando;
+                _status = ErroLimiteDeWaitsRecebidos;
+            } else {
+                _arma(NBR14522::TSEMWAIT_SEC * 1000);
+            }
+            break;
+        }
+    }
+
+    // "a recepção de algo que que não seja SINALIZADOR ou BLOCO DE DADOS
+    // [resposta ou comando] deve provocar uma QUEBRA DE SEQUÊNCIA"
+    void _quebraDeSequencia() {
+        _eventos |= EventoQuebraDeSequencia;
+        _estado = Dessincronizado;
+        _iniciouSincronizado = false;
+        _status = ErroQuebraDeSequencia;
+        _descarta();
+    }
+
+    // copia até sz bytes do bloco de dados; retorna quantos foram copiados
+    std::size_t _recebeResposta(const byte_t* data, std::size_t sz) {
+        const std::size_t restantes =
+            NBR14522::RESPOSTA_SZ - _respostaBytesLidos;
+        if (sz > restantes)
+            sz = restantes;
+        memcpy(&_buffer()[_respostaBytesLidos], data, sz);
+        return _respostaEscrita(sz);
+    }
+
+    // sz bytes do bloco de dados já escritos na posição corrente
+    std::size_t _respostaEscrita(std::size_t sz) {
+        const std::size_t restantes =
+            NBR14522::RESPOSTA_SZ - _respostaBytesLidos;
+        if (sz > restantes)
+            sz = restantes;
+        _crcResposta.update(&_buffer()[_respostaBytesLidos], sz);
+        _respostaBytesLidos += sz;
+        _arma(NBR14522::TMAXCAR_MSEC);
+
+        if (_respostaBytesLidos >= NBR14522::RESPOSTA_SZ)
+            _verificaResposta();
+        return sz;
+    }
+
+    void _timeoutResposta() {
+        _counterSemResposta++;
+        _descarta();
+        if (_counterSemResposta == NBR14522::MAX_COMANDO_SEM_RESPOSTA) {
+            // falhou
+            _estado = AguardaNovoComando;
+            _status = ErroLimiteDeTransmissoesSemRespostas;
+        } else {
+            _transmiteComando();
+            _arma(NBR14522::TMAXRSP_MSEC);
+            _estado = ComandoTransmitido;
+        }
+    }
+
+    // resposta completa recebida, verifica CRC (acumulado sobre a resposta
+    // inteira, incluindo o próprio CRC, deve ser zero)
+    void _verificaResposta() {
+        if (_crcResposta.finalize() != 0x0000) {
+            // CRC incorreto
+            // transmite NAK
+            _transmiteSinal(NBR14522::NAK);
+            _eventos |= EventoNakTransmitido;
+            _counterNakTransmitido++;
+            if (_counterNakTransmitido == NBR14522::MAX_BLOCO_NAK) {
+                // falhou
+                _estado = AguardaNovoComando;
+                _status = ErroLimiteDeNAKsTransmitidos;
+            } else {
+                _estado = ComandoTransmitido;
+                _arma(NBR14522::TMAXRSP_MSEC);
+            }
+            return;
+        }
+
+        // CRC correto
+        // transmite ACK
+        _transmiteSinal(NBR14522::ACK);
+        _eventos |= EventoResposta;
+
+        const NBR14522::resposta_t& resposta = _buffer();
+        if (NBR14522::isComposedCodeCommand(resposta.at(0))) {
+            _isRespostaComposta = true;
+            if (NBR14522::isLastRespostaOfComposed(resposta)) {
+                // resposta composta recebida por completo, sucesso
+                _estado = AguardaNovoComando;
+                _status = Sucesso;
+                _fimDaTroca();
+            } else {
+                // resetar contadores, pois são referentes a cada resposta.
+                // Obs.: nao zera contador de NAK recebidos pois o comando já
+                // foi recebido corretamente pelo medidor e a partir de agora
+                // o medidor nao deve enviar mais NAKs.
+                _counterNakTransmitido = 0;
+                _counterSemResposta = 0;
+                _counterWaitRecebido = 0;
+                _arma(NBR14522::TMAXRSP_MSEC);
+                _estado = ComandoTransmitido;
+            }
+        } else {
+            // resposta simples recebida
+            if (resposta.at(0) ==
+                NBR14522::CodigoInformacaoDeOcorrenciaNoMedidor)
+                _status = ExcecaoOcorrenciaNoMedidor;
+            else if (resposta.at(0) ==
+                     NBR14522::CodigoInformacaoDeComandoNaoImplementado)
+                _status = ExcecaoComandoNaoImplementado;
+            else
+                _status = Sucesso;
+
+            _estado = AguardaNovoComando;
+            _fimDaTroca();
+        }
+    }
+
+    // após o ACK, o medidor volta a transmitir ENQ: a cadência recomeça e,
+    // no modo sessão, o sincronismo vale para o comando seguinte até TMAXENQ
+    void _fimDaTroca() {
+        _cadencia.reinicia(_agora);
+        if (!_sessao)
+            return;
+        _sincronizado = true;
+        _arma(NBR14522::TMAXENQ_MSEC);
+    }
+};
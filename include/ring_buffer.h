@@ -1,6 +1,10 @@
 #pragma once
 
 // #include <NBR14522.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <mutex>
 
 template <typename T, size_t S> class RingBuffer {
@@ -69,3 +73,172 @@ template <typename T, size_t S> class RingBuffer {
         return retval;
     }
 };
+
+// segmento contíguo de memória de um ring buffer
+template <typename T> struct RingBufferSpan {
+    T* data;
+    size_t size;
+};
+
+// região de um ring buffer, que pode estar dividida em dois segmentos
+// contíguos quando passa pelo fim do array (volta ao início)
+template <typename T> struct RingBufferSpans {
+    RingBufferSpan<T> primeiro;
+    RingBufferSpan<T> segundo;
+
+    size_t size() const { return primeiro.size + segundo.size; }
+};
+
+// Ring buffer sem lock (wait-free) para exatamente um produtor e um
+// consumidor, e.g. a thread que lê a porta serial e a thread do protocolo.
+// Diferente de RingBuffer, não sobrescreve dados antigos: write() escreve
+// somente o que couber no buffer.
+//
+// S deve ser potência de 2. _head e _tail são contadores que só crescem e o
+// índice no array é obtido por máscara. Cada contador fica em sua própria
+// linha de cache (alignas), junto de uma cópia local do contador do outro
+// lado, para que produtor e consumidor só acessem a linha do outro quando
+// necessário; o array começa em outra linha.
+template <typename T, size_t S> class RingBufferSPSC {
+    static_assert(S > 0 && (S & (S - 1)) == 0,
+                  "o tamanho do RingBufferSPSC deve ser potência de 2");
+
+  private:
+    static constexpr size_t MASCARA = S - 1;
+    static constexpr size_t LINHA_DE_CACHE = 64;
+
+    // lado do produtor
+    alignas(LINHA_DE_CACHE) std::atomic<size_t> _head{0};
+    size_t _tailCache = 0;
+
+    // lado do consumidor
+    alignas(LINHA_DE_CACHE) std::atomic<size_t> _tail{0};
+    size_t _headCache = 0;
+
+    alignas(LINHA_DE_CACHE) std::array<T, S> _buffer;
+
+    // espaço livre para escrita, visto pelo produtor
+    size_t _livre(const size_t head, const size_t n) {
+        size_t livre = S - (head - _tailCache);
+        if (livre < n) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            livre = S - (head - _tailCache);
+        }
+        return livre;
+    }
+
+    // dados disponíveis para leitura, vistos pelo consumidor
+    size_t _disponivel(const size_t tail, const size_t n) {
+        size_t disponivel = _headCache - tail;
+        if (disponivel < n) {
+            _headCache = _head.load(std::memory_order_acquire);
+            disponivel = _headCache - tail;
+        }
+        return disponivel;
+    }
+
+  public:
+    // produtor
+
+    inline bool write(const T data) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (!_livre(head, 1))
+            return false;
+
+        _buffer[head & MASCARA] = data;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // reserva até n elementos livres para escrita direta no buffer (e.g. por
+    // read(2)), sem cópia intermediária. Os dados só ficam visíveis ao
+    // consumidor após commitWrite().
+    RingBufferSpans<T> reserveWrite(const size_t n) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        const size_t livre = std::min(n, _livre(head, n));
+
+        const size_t i = head & MASCARA;
+        const size_t primeiro = std::min(livre, S - i);
+        return {{_buffer.data() + i, primeiro},
+                {_buffer.data(), livre - primeiro}};
+    }
+
+    // publica n elementos escritos na região obtida por reserveWrite()
+    void commitWrite(const size_t n) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        _head.store(head + std::min(n, _livre(head, n)),
+                    std::memory_order_release);
+    }
+
+    // escreve até n elementos, retorna quantos foram escritos
+    size_t write(const T* data, size_t n) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        n = std::min(n, _livre(head, n));
+
+        const size_t i = head & MASCARA;
+        const size_t primeiro = std::min(n, S - i);
+        std::copy(data, data + primeiro, _buffer.data() + i);
+        std::copy(data + primeiro, data + n, _buffer.data());
+
+        _head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // consumidor
+
+    inline bool read(T& data) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (!_disponivel(tail, 1))
+            return false;
+
+        data = _buffer[tail & MASCARA];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // lê até n elementos, retorna quantos foram lidos
+    size_t read(T* data, size_t n) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        n = std::min(n, _disponivel(tail, n));
+
+        const size_t i = tail & MASCARA;
+        const size_t primeiro = std::min(n, S - i);
+        std::copy(_buffer.data() + i, _buffer.data() + i + primeiro, data);
+        std::copy(_buffer.data(), _buffer.data() + n - primeiro,
+                  data + primeiro);
+
+        _tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // dados disponíveis para leitura, sem consumi-los. Após processá-los no
+    // próprio buffer, o consumidor os libera com consume().
+    RingBufferSpans<const T> peekRead() {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t n = _disponivel(tail, S);
+
+        const size_t i = tail & MASCARA;
+        const size_t primeiro = std::min(n, S - i);
+        return {{_buffer.data() + i, primeiro},
+                {_buffer.data(), n - primeiro}};
+    }
+
+    // libera n elementos já lidos via peekRead()
+    void consume(const size_t n) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        _tail.store(tail + std::min(n, _disponivel(tail, n)),
+                    std::memory_order_release);
+    }
+
+    // qualquer lado (valores aproximados se o outro lado estiver operando)
+
+    size_t toread() const {
+        // tail é lido antes de head para que a diferença nunca seja negativa
+        const size_t tail = _tail.load(std::memory_order_acquire);
+        return _head.load(std::memory_order_acquire) - tail;
+    }
+
+    size_t towrite() const { return S - toread(); }
+
+    static constexpr size_t capacity() { return S; }
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+// Captura de sessões de comunicação para reprodução offline (ver
+// serial_policy_replay.h).
+//
+// O formato da captura é a sequência de registros binários das policies de
+// trace (ver trace_policy.h): cada rx()/tx() que movimentou bytes gera um
+// registro com a direção, o timestamp monotônico em ns e os bytes. Assim,
+// qualquer policy serial pode ser gravada com SerialPolicyGravador, ou com a
+// própria TracePolicyArquivoBinario no caso de SerialPolicyUnix.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <trace_policy.h>
+#include <vector>
+
+// bytes por registro no arquivo (o tamanho no cabeçalho tem 16 bits)
+constexpr size_t CAPTURA_REGISTRO_MAX_SZ = 0xFFFF;
+
+class Captura {
+  public:
+    typedef struct {
+        direcao_trace_t direcao;
+        uint64_t timestamp_ns;
+        size_t inicio; // posição dos bytes em dados()
+        size_t tamanho;
+    } registro_t;
+
+    // blocos maiores que CAPTURA_REGISTRO_MAX_SZ são divididos em registros
+    // consecutivos de mesma direção e timestamp, como seriam lidos do arquivo
+    void adiciona(direcao_trace_t direcao, uint64_t timestamp_ns,
+                  const uint8_t* data, size_t data_sz) {
+        do {
+            const size_t sz = data_sz < CAPTURA_REGISTRO_MAX_SZ
+                                  ? data_sz
+                                  : CAPTURA_REGISTRO_MAX_SZ;
+            _registros.push_back({direcao, timestamp_ns, _dados.size(), sz});
+            _dados.insert(_dados.end(), data, data + sz);
+            data += sz;
+            data_sz -= sz;
+        } while (data_sz);
+    }
+
+    // lê todos os registros do arquivo (a partir da posição atual). Retorna
+    // false se o arquivo termina no meio de um registro.
+    bool carrega(FILE* arquivo) {
+        uint8_t buf[TRACE_CABECALHO_SZ];
+        std::vector<uint8_t> data;
+
+        while (true) {
+            size_t lidos = fread(buf, 1, sizeof(buf), arquivo);
+            if (lidos == 0)
+                return true;
+            if (lidos != sizeof(buf))
+                return false;
+
+            cabecalho_trace_t cabecalho = deserializaCabecalhoTrace(buf);
+            data.resize(cabecalho.tamanho);
+            if (fread(data.data(), 1, data.size(), arquivo) != data.size())
+                return false;
+
+            adiciona(cabecalho.direcao, cabecalho.timestamp_ns, data.data(),
+                     data.size());
+        }
+    }
+
+    bool carrega(const char* caminho) {
+        FILE* arquivo = fopen(caminho, "rb");
+        if (!arquivo)
+            return false;
+        bool ok = carrega(arquivo);
+        fclose(arquivo);
+        return ok;
+    }
+
+    // grava no mesmo formato lido por carrega(); os registros não excedem
+    // CAPTURA_REGISTRO_MAX_SZ (ver adiciona())
+    bool salva(FILE* arquivo) const {
+        for (const auto& registro : _registros) {
+            uint8_t cabecalho[TRACE_CABECALHO_SZ];
+            serializaCabecalhoTrace(
+                {registro.direcao, registro.timestamp_ns,
+                 static_cast<uint16_t>(registro.tamanho)},
+                cabecalho);
+            if (fwrite(cabecalho, 1, sizeof(cabecalho), arquivo) !=
+                    sizeof(cabecalho) ||
+                fwrite(&_dados[registro.inicio], 1, registro.tamanho,
+                       arquivo) != registro.tamanho)
+                return false;
+        }
+        return true;
+    }
+
+    const std::vector<registro_t>& registros() const { return _registros; }
+    const uint8_t* dados(const registro_t& registro) const {
+        return _dados.data() + registro.inicio;
+    }
+
+  private:
+    std::vector<registro_t> _registros;
+    std::vector<uint8_t> _dados;
+};
+
+// decorator que grava a sessão de qualquer policy serial, repassando tx() e
+// rx() à policy decorada
+template <class SerialPolicy, class TracePolicy = TracePolicyArquivoBinario>
+class SerialPolicyGravador {
+  public:
+    SerialPolicyGravador(std::shared_ptr<SerialPolicy> porta) : _porta(porta) {}
+
+    size_t tx(const uint8_t* data, const size_t data_sz) {
+        size_t n = _porta->tx(data, data_sz);
+        _trace.trace(TRACE_TX, data, n);
+        return n;
+    }
+
+    size_t rx(uint8_t* data, const size_t max_data_sz) {
+        size_t n = _porta->rx(data, max_data_sz);
+        _trace.trace(TRACE_RX, data, n);
+        return n;
+    }
+
+    TracePolicy& trace() { return _trace; }
+    std::shared_ptr<SerialPolicy> porta() { return _porta; }
+
+  private:
+    std::shared_ptr<SerialPolicy> _porta;
+    TracePolicy _trace;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+
+// milissegundos (arredondados para cima) até o deadline, limitados a INT_MAX,
+// no formato do timeout de poll(2)
+template <class Clock, class Duration>
+int msAteDeadline(const std::chrono::time_point<Clock, Duration>& deadline) {
+    auto restante = deadline - Clock::now();
+    if (restante <= Clock::duration::zero())
+        return 0;
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(restante);
+    if (ms < restante)
+        ms += std::chrono::milliseconds(1);
+
+    return ms.count() > INT_MAX ? INT_MAX : static_cast<int>(ms.count());
+}
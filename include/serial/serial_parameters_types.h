@@ -25,3 +25,8 @@ typedef enum {
 typedef enum { PARITY_NONE, PARITY_ODD, PARITY_EVEN } parity_t;
 
 typedef enum { STOPBITS_1, STOPBITS_2 } stopbits_t;
+
+// LATENCIA_BAIXA solicita ao driver que entregue cada byte assim que recebido
+// (ASYNC_LOW_LATENCY no Linux), ao invés de acumulá-los (conversores
+// USB-serial acumulam por até 16 ms)
+typedef enum { LATENCIA_BAIXA, LATENCIA_PADRAO } latencia_t;
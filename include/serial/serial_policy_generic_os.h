@@ -8,7 +8,7 @@
 typedef SerialPolicyWin SerialPolicyGenericOS;
 #elif defined(__linux__) || defined(__APPLE__)
 #include "serial_policy_unix.h"
-typedef SerialPolicyUnix SerialPolicyGenericOS;
+typedef SerialPolicyUnix<> SerialPolicyGenericOS;
 #else
 #error sistema operacional não suportado e/ou não identificado.
 #endif
\ No newline at end of file
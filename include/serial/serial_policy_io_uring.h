@@ -0,0 +1,173 @@
+#pragma once
+
+// Policy serial para concentradores com muitas portas (Linux): as leituras e
+// escritas de todas as portas são submetidas e completadas em lote por uma
+// única instância de io_uring (AnelIoUring), compartilhada pelas portas, ao
+// invés de syscalls por porta. Os bytes recebidos são copiados do buffer
+// registrado de cada porta para uma fila da porta, consumida por rx().
+//
+// O laço do concentrador chama AnelIoUring::processa() uma vez por iteração
+// (submissão e colheita de todas as portas com um único io_uring_enter(2)) e
+// em seguida processaEstado() de cada LeitorFSM.
+//
+// Se o io_uring não estiver disponível (kernel antigo, desabilitado por
+// sysctl ou seccomp), SerialPolicyIoUring usa as syscalls de SerialUnix, com
+// o mesmo comportamento de SerialPolicyUnix.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "serial_parameters_types.h"
+#include <ring_buffer.h>
+#include <serial/deadline.h>
+#include <serial/serial_policy_unix.h>
+
+// tamanho da região do buffer registrado de cada porta, para cada direção
+constexpr std::size_t IO_URING_BUFFER_PORTA_SZ = 512;
+
+class SerialPolicyIoUring;
+
+class AnelIoUring {
+  public:
+    // maxPortas: quantidade máxima de portas simultâneas. Com habilitado =
+    // false o io_uring não é usado (útil para comparações).
+    explicit AnelIoUring(const std::size_t maxPortas = 64,
+                         const bool habilitado = true);
+    ~AnelIoUring();
+
+    AnelIoUring(const AnelIoUring&) = delete;
+    AnelIoUring& operator=(const AnelIoUring&) = delete;
+
+    bool disponivel() const { return _fd >= 0; }
+
+    // submete as operações pendentes de todas as portas e trata as
+    // completadas, aguardando até timeout_ms (0: não aguarda, -1: aguarda
+    // indefinidamente) caso nenhuma tenha completado
+    void processa(const int timeout_ms = 0);
+
+    template <class Clock, class Duration>
+    void processa(const std::chrono::time_point<Clock, Duration>& deadline) {
+        processa(msAteDeadline(deadline));
+    }
+
+    // io_uring_enter(2) realizados, para comparação com as syscalls por porta
+    std::uint64_t chamadas() const { return _chamadas; }
+
+    // portas removidas com operações que não puderam ser canceladas ou que
+    // não terminaram a tempo: o slot da porta fica reservado até elas
+    // completarem
+    std::uint64_t falhasRemocao() const { return _falhasRemocao; }
+
+  private:
+    friend class SerialPolicyIoUring;
+
+    typedef struct {
+        SerialPolicyIoUring* porta;
+        int fd;
+        bool leituraPendente; // poll + read_fixed submetidos
+        bool escritaPendente; // write_fixed submetido
+        bool escritaAguardaPoll; // última escrita retornou EAGAIN
+        std::size_t escritaSz;
+        std::uint32_t operacoes; // operações submetidas e não completadas
+    } slot_t;
+
+    int _fd = -1;
+    std::vector<slot_t> _slots;
+    std::uint64_t _chamadas = 0;
+    std::uint64_t _falhasRemocao = 0;
+
+    // região registrada: para cada porta, RX seguido de TX
+    std::uint8_t* _buffers = nullptr;
+    std::size_t _buffersSz = 0;
+
+    // anéis mapeados do kernel
+    void* _sqAnel = nullptr;
+    std::size_t _sqAnelSz = 0;
+    void* _cqAnel = nullptr;
+    std::size_t _cqAnelSz = 0;
+    void* _sqes = nullptr;
+    std::size_t _sqesSz = 0;
+    unsigned* _sqHead = nullptr;
+    unsigned* _sqTail = nullptr;
+    unsigned _sqMask = 0;
+    unsigned* _sqArray = nullptr;
+    unsigned* _cqHead = nullptr;
+    unsigned* _cqTail = nullptr;
+    unsigned _cqMask = 0;
+    void* _cqes = nullptr;
+
+    bool _inicia(const unsigned entradas);
+    void _finaliza();
+
+    int _registra(SerialPolicyIoUring* porta, const int fd);
+    bool _remove(const int slot);
+
+    std::uint8_t* _bufferRx(const int slot) {
+        return _buffers + 2 * IO_URING_BUFFER_PORTA_SZ * slot;
+    }
+    std::uint8_t* _bufferTx(const int slot) {
+        return _bufferRx(slot) + IO_URING_BUFFER_PORTA_SZ;
+    }
+
+    void _armaLeitura(const int slot);
+    void _armaEscrita(const int slot, const bool aguardaPoll);
+    bool _cancela(const std::uint64_t userData);
+    bool _reservaSqes(const unsigned n);
+    void* _proximaSqe();
+    void _trataCompletada(const std::uint64_t userData, const int resultado);
+    void _submete(const unsigned minCompletadas, const int timeout_ms);
+};
+
+class SerialPolicyIoUring {
+  public:
+    SerialPolicyIoUring(std::shared_ptr<AnelIoUring> anel) : _anel(anel) {}
+    ~SerialPolicyIoUring() { closeSerial(); }
+
+    bool openSerial(const char* name, baudrate_t baudrate = BAUDRATE_9600,
+                    databits_t databits = DATABITS_8,
+                    parity_t parity = PARITY_NONE,
+                    stopbits_t stopbits = STOPBITS_1,
+                    latencia_t latencia = LATENCIA_BAIXA);
+    // false se operações do anel sobre a porta não puderam ser canceladas
+    // (ver AnelIoUring::falhasRemocao()); a porta é fechada mesmo assim
+    bool closeSerial();
+    void descartaRx();
+
+    // enfileira os bytes; são escritos na próxima chamada a
+    // AnelIoUring::processa()
+    size_t tx(const std::uint8_t* data, const std::size_t data_sz);
+    size_t rx(std::uint8_t* data, const std::size_t max_data_sz);
+
+    // aguarda até haver bytes recebidos por esta porta ou até o deadline,
+    // processando o anel (e, portanto, as demais portas) enquanto isso
+    template <class Clock, class Duration>
+    bool aguardaRx(const std::chrono::time_point<Clock, Duration>& deadline) {
+        if (_slot < 0)
+            return _porta.aguardaRx(deadline);
+
+        do {
+            if (_rx.toread())
+                return true;
+            _anel->processa(deadline);
+        } while (Clock::now() < deadline);
+
+        return _rx.toread() > 0;
+    }
+
+    // syscalls da porta; com o anel disponível, as do anel estão em
+    // AnelIoUring::chamadas()
+    const SerialUnix::estatisticas_serial_t& estatisticas() const {
+        return _porta.estatisticas();
+    }
+
+  private:
+    friend class AnelIoUring;
+
+    std::shared_ptr<AnelIoUring> _anel;
+    SerialUnix _porta;
+    int _slot = -1; // -1: porta fechada ou io_uring indisponível
+    RingBufferSPSC<std::uint8_t, 2 * IO_URING_BUFFER_PORTA_SZ> _rx;
+    RingBufferSPSC<std::uint8_t, 2 * IO_URING_BUFFER_PORTA_SZ> _tx;
+};
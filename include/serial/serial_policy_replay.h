@@ -0,0 +1,139 @@
+#pragma once
+
+// Policy serial que reproduz uma captura (ver captura.h) como se fosse o
+// medidor, para reproduzir problemas de campo e medir o desempenho da pilha
+// do protocolo sem medidores.
+//
+// Os bytes recebidos (RX) são entregues respeitando a causalidade da sessão:
+// um registro RX só é liberado depois que o leitor transmitiu todos os bytes
+// TX que o precederam na captura. Cada rx() entrega bytes de no máximo um
+// registro e, após o fim de um registro, o rx() seguinte retorna 0, como na
+// sessão original (em que os bytes chegavam em rajadas).
+//
+// No modo TEMPO_REAL, o intervalo entre cada registro RX e o evento anterior
+// (início, TX ou RX) é o mesmo da captura. No modo TEMPO_ACELERADO, os
+// registros RX são liberados assim que a causalidade permitir.
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <serial/captura.h>
+
+class SerialPolicyReplay {
+  public:
+    typedef enum { TEMPO_REAL, TEMPO_ACELERADO } modo_t;
+
+    // a captura é compartilhada: várias policies podem reproduzi-la
+    SerialPolicyReplay(std::shared_ptr<const Captura> captura,
+                       const modo_t modo = TEMPO_ACELERADO)
+        : _captura(captura), _modo(modo) {
+        reinicia();
+    }
+
+    // volta ao início da captura
+    void reinicia() {
+        _registro = 0;
+        _offset = 0;
+        _pausa = false;
+        _divergencias = 0;
+        _ancoraReal = clock::now();
+        const auto& registros = _captura->registros();
+        _ancoraCaptura_ns =
+            registros.empty() ? 0 : registros.front().timestamp_ns;
+    }
+
+    // os bytes transmitidos pelo leitor são comparados aos da captura
+    size_t tx(const uint8_t* data, const size_t data_sz) {
+        const auto& registros = _captura->registros();
+
+        for (size_t i = 0; i < data_sz; i++) {
+            _pulaRegistrosVazios();
+            if (_registro >= registros.size() ||
+                registros[_registro].direcao != TRACE_TX) {
+                // leitor transmitiu algo que não está na captura
+                _divergencias++;
+                continue;
+            }
+
+            const auto& registro = registros[_registro];
+            if (_captura->dados(registro)[_offset] != data[i])
+                _divergencias++;
+
+            if (++_offset == registro.tamanho)
+                _avanca(clock::now());
+        }
+
+        return data_sz;
+    }
+
+    size_t rx(uint8_t* data, const size_t max_data_sz) {
+        const auto& registros = _captura->registros();
+
+        if (_pausa) {
+            _pausa = false;
+            return 0;
+        }
+
+        _pulaRegistrosVazios();
+        if (_registro >= registros.size() ||
+            registros[_registro].direcao != TRACE_RX)
+            return 0;
+
+        const auto& registro = registros[_registro];
+
+        clock::time_point liberacao = _ancoraReal;
+        if (_modo == TEMPO_REAL) {
+            liberacao += std::chrono::nanoseconds(registro.timestamp_ns -
+                                                  _ancoraCaptura_ns);
+            if (clock::now() < liberacao)
+                return 0;
+        }
+
+        size_t sz = registro.tamanho - _offset;
+        if (sz > max_data_sz)
+            sz = max_data_sz;
+        memcpy(data, _captura->dados(registro) + _offset, sz);
+
+        _offset += sz;
+        if (_offset == registro.tamanho) {
+            _avanca(liberacao);
+            _pausa = true;
+        }
+
+        return sz;
+    }
+
+    // todos os registros da captura foram reproduzidos
+    bool terminou() const {
+        return _registro >= _captura->registros().size();
+    }
+
+    // bytes transmitidos pelo leitor diferentes dos da captura
+    size_t divergencias() const { return _divergencias; }
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    std::shared_ptr<const Captura> _captura;
+    modo_t _modo;
+    size_t _registro;
+    size_t _offset;
+    bool _pausa;
+    size_t _divergencias;
+    clock::time_point _ancoraReal;
+    uint64_t _ancoraCaptura_ns;
+
+    // passa ao próximo registro; o registro concluído vira a âncora de tempo
+    void _avanca(const clock::time_point agora) {
+        _ancoraCaptura_ns = _captura->registros()[_registro].timestamp_ns;
+        _ancoraReal = agora;
+        _registro++;
+        _offset = 0;
+    }
+
+    void _pulaRegistrosVazios() {
+        const auto& registros = _captura->registros();
+        while (_registro < registros.size() && !registros[_registro].tamanho)
+            _registro++;
+    }
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+// Policy "serial" sobre TCP, para medidores atrás de servidores seriais
+// Ethernet que expõem a porta como um socket TCP bruto, sem um processo de
+// ponte (e.g. socat) por porta. Mesmo contrato de SerialPolicyUnix: tx(),
+// rx(), aguardaRx() e descartaRx().
+//
+// Opcionalmente (configuraPorta()), negocia a configuração da porta do
+// servidor pelo protocolo RFC 2217 (Telnet COM-PORT-OPTION). Nesse modo, os
+// bytes 0xFF (IAC) dos dados são duplicados na transmissão e os comandos
+// Telnet recebidos do servidor são removidos da recepção.
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "serial_parameters_types.h"
+#include <serial/deadline.h>
+#include <trace_policy.h>
+
+class SocketTcp {
+  public:
+    SocketTcp();
+    ~SocketTcp();
+
+    // conecta (socket não bloqueante, TCP_NODELAY) a host:porta, aguardando
+    // até timeout_ms
+    bool conecta(const char* host, const std::uint16_t porta,
+                 const int timeout_ms = 5000);
+    void desconecta();
+
+    // false após o servidor fechar a conexão
+    bool conectado() const { return _fd != -1 && !_fechado; }
+
+    // RFC 2217: configura a porta serial do servidor. A partir daqui, os
+    // dados passam a ser escapados conforme o protocolo Telnet.
+    bool configuraPorta(baudrate_t baudrate = BAUDRATE_9600,
+                        databits_t databits = DATABITS_8,
+                        parity_t parity = PARITY_NONE,
+                        stopbits_t stopbits = STOPBITS_1);
+
+    size_t tx(const std::uint8_t* data, const std::size_t data_sz);
+    size_t rx(std::uint8_t* data, const std::size_t max_data_sz);
+    void descartaRx();
+
+    // como SerialUnix::aguardaRx(): false antes do deadline se a conexão foi
+    // encerrada ou apresentou erro
+    template <class Clock, class Duration>
+    bool aguardaRx(const std::chrono::time_point<Clock, Duration>& deadline) {
+        if (_rxInicio != _rxFim)
+            return true;
+        return _aguardaRx(msAteDeadline(deadline));
+    }
+
+    // socket conectado (-1 se desconectado) e bytes recebidos ainda não
+    // entregues por rx(), como em SerialUnix
+    int fd() const { return _fd; }
+    std::size_t rxPendentes() const { return _rxFim - _rxInicio; }
+
+  private:
+    typedef enum {
+        RX_DADOS,
+        RX_IAC,
+        RX_OPCAO, // após WILL, WONT, DO ou DONT
+        RX_SB,
+        RX_SB_IAC,
+    } estado_telnet_t;
+
+    int _fd = -1;
+    bool _fechado = false;
+    bool _rfc2217 = false;
+    estado_telnet_t _telnet = RX_DADOS;
+    std::vector<std::uint8_t> _bufferRx;
+    std::size_t _rxInicio = 0;
+    std::size_t _rxFim = 0;
+
+    bool _aguardaRx(int timeout_ms);
+    bool _enviaTudo(const std::uint8_t* data, std::size_t data_sz);
+    std::size_t _filtraTelnet(std::uint8_t* data, const std::size_t data_sz);
+};
+
+template <class TracePolicy = TracePolicyNull>
+class SerialPolicyTcp : private SocketTcp {
+  public:
+    using SocketTcp::aguardaRx;
+    using SocketTcp::conecta;
+    using SocketTcp::conectado;
+    using SocketTcp::configuraPorta;
+    using SocketTcp::descartaRx;
+    using SocketTcp::desconecta;
+    using SocketTcp::fd;
+    using SocketTcp::rxPendentes;
+
+    size_t tx(const std::uint8_t* data, const std::size_t data_sz) {
+        size_t n = SocketTcp::tx(data, data_sz);
+        _trace.trace(TRACE_TX, data, n);
+        return n;
+    }
+
+    size_t rx(std::uint8_t* data, const std::size_t max_data_sz) {
+        size_t n = SocketTcp::rx(data, max_data_sz);
+        _trace.trace(TRACE_RX, data, n);
+        return n;
+    }
+
+    TracePolicy& trace() { return _trace; }
+
+  private:
+    TracePolicy _trace;
+};
@@ -1,21 +1,163 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>  // size_t
 #include <unistd.h> // uint8_t
+#include <vector>
 
 #include "serial_parameters_types.h"
+#include <serial/deadline.h>
+#include <ring_buffer.h>
+#include <trace_policy.h>
 
-class SerialPolicyUnix {
+// tamanho padrão do buffer de recepção de SerialUnix: uma resposta completa e
+// os sinalizadores que a acompanham
+constexpr std::size_t SERIAL_UNIX_BUFFER_RX_SZ = 512;
+
+// acesso à porta serial em sistemas unix-like (termios), sem trace. Usada pela
+// policy SerialPolicyUnix abaixo.
+//
+// A recepção passa por um buffer em espaço de usuário: cada read(2) lê tudo o
+// que o kernel tem (até o tamanho do buffer) e as chamadas seguintes a rx(),
+// normalmente de 1 byte pelo LeitorFSM, são servidas da memória.
+class SerialUnix {
   public:
-    ~SerialPolicyUnix();
+    // contadores de chamadas, para avaliar o custo em syscalls por quadro
+    typedef struct {
+        std::uint64_t chamadasRx;     // chamadas a rx()
+        std::uint64_t leituras;       // read(2) e readv(2)
+        std::uint64_t bytesRecebidos; // bytes lidos do kernel
+        std::uint64_t escritas;       // write(2)
+        std::uint64_t esperas;        // poll(2)
+    } estatisticas_serial_t;
+
+    SerialUnix() : _bufferRx(SERIAL_UNIX_BUFFER_RX_SZ) {}
+    ~SerialUnix();
+    // a porta é configurada em modo raw (cfmakeraw), sem eco e sem
+    // processamento de linha, com VMIN = VTIME = 0: as leituras nunca
+    // aguardam, a espera é feita por poll(2) em aguardaRx()
     bool openSerial(const char* name, baudrate_t baudrate = BAUDRATE_9600,
                     databits_t databits = DATABITS_8,
                     parity_t parity = PARITY_NONE,
-                    stopbits_t stopbits = STOPBITS_1);
+                    stopbits_t stopbits = STOPBITS_1,
+                    latencia_t latencia = LATENCIA_BAIXA);
     void closeSerial();
+
+    // true se o driver aceitou o modo de baixa latência (portas que não são
+    // seriais de verdade, como pseudo-terminais, não o suportam)
+    bool baixaLatencia() const { return _baixaLatencia; }
+
+    // descarta os bytes recebidos e ainda não lidos, inclusive os do buffer
+    // do kernel (tcflush(3)), sem lê-los
+    void descartaRx();
+
     size_t tx(const std::uint8_t* data, const std::size_t data_sz);
     size_t rx(std::uint8_t* data, const std::size_t max_data_sz);
 
+    // lê diretamente para a região livre de um ring buffer, com uma única
+    // chamada readv(2) e sem cópias intermediárias
+    size_t rx(RingBufferSpans<std::uint8_t> destino);
+
+    // aguarda (sem consumir CPU) até haver dados para leitura ou até o
+    // deadline. Retorna true se há dados disponíveis; false no deadline ou,
+    // antes dele, se a porta foi fechada ou apresentou erro (POLLHUP,
+    // POLLERR, POLLNVAL).
+    template <class Clock, class Duration>
+    bool aguardaRx(const std::chrono::time_point<Clock, Duration>& deadline) {
+        if (_rxInicio != _rxFim)
+            return true;
+        return _aguardaRx(msAteDeadline(deadline));
+    }
+
+    // altera o tamanho do buffer de recepção (mínimo 1). Bytes ainda não
+    // entregues por rx() são descartados.
+    void setTamanhoBufferRx(const std::size_t sz);
+
+    const estatisticas_serial_t& estatisticas() const { return _estatisticas; }
+    void zeraEstatisticas() { _estatisticas = {}; }
+
+    // descritor da porta aberta (-1 se fechada), para backends que fazem o
+    // I/O por conta própria (ver serial_policy_io_uring.h) ou que aguardam
+    // várias portas de uma vez (ver leitor_reactor.h)
+    int fd() const { return _fd; }
+
+    // bytes já lidos do kernel e ainda não entregues por rx(): enquanto
+    // houver, o descritor pode não sinalizar dados disponíveis
+    std::size_t rxPendentes() const { return _rxFim - _rxInicio; }
+
+  private:
+    int _fd = -1;
+    bool _baixaLatencia = false;
+    int _flagsSerialOriginais = -1; // restauradas em closeSerial()
+    std::vector<std::uint8_t> _bufferRx;
+    std::size_t _rxInicio = 0;
+    std::size_t _rxFim = 0;
+    estatisticas_serial_t _estatisticas = {};
+
+    bool _aguardaRx(int timeout_ms);
+    size_t _le(std::uint8_t* data, const std::size_t data_sz);
+    size_t _entregaBufferRx(std::uint8_t* data, const std::size_t max_data_sz);
+};
+
+// policy serial unix. TracePolicy (ver trace_policy.h) recebe os bytes
+// transmitidos e recebidos; com TracePolicyNull o trace não gera código.
+template <class TracePolicy = TracePolicyNull>
+class SerialPolicyUnix : private SerialUnix {
+  public:
+    using SerialUnix::aguardaRx;
+    using SerialUnix::baixaLatencia;
+    using SerialUnix::closeSerial;
+    using SerialUnix::descartaRx;
+    using SerialUnix::estatisticas;
+    using SerialUnix::estatisticas_serial_t;
+    using SerialUnix::fd;
+    using SerialUnix::openSerial;
+    using SerialUnix::rxPendentes;
+    using SerialUnix::setTamanhoBufferRx;
+    using SerialUnix::zeraEstatisticas;
+
+    size_t tx(const std::uint8_t* data, const std::size_t data_sz) {
+        size_t n = SerialUnix::tx(data, data_sz);
+        _trace.trace(TRACE_TX, data, n);
+        return n;
+    }
+
+    size_t rx(std::uint8_t* data, const std::size_t max_data_sz) {
+        size_t n = SerialUnix::rx(data, max_data_sz);
+        _trace.trace(TRACE_RX, data, n);
+        return n;
+    }
+
+    template <std::size_t S>
+    size_t rx(RingBufferSPSC<std::uint8_t, S>& buffer) {
+        auto destino = buffer.reserveWrite(S);
+        size_t n = SerialUnix::rx(destino);
+        if (n) {
+            size_t primeiro = n < destino.primeiro.size
+                                  ? n
+                                  : destino.primeiro.size;
+            _trace.trace(TRACE_RX, destino.primeiro.data, primeiro);
+            _trace.trace(TRACE_RX, destino.segundo.data, n - primeiro);
+        }
+        buffer.commitWrite(n);
+        return n;
+    }
+
+    // como rx(), mas aguarda a chegada de dados até o deadline
+    template <class Clock, class Duration>
+    size_t rxUntil(std::uint8_t* data, const std::size_t max_data_sz,
+                   const std::chrono::time_point<Clock, Duration>& deadline) {
+        do {
+            size_t n = rx(data, max_data_sz);
+            if (n)
+                return n;
+        } while (aguardaRx(deadline));
+
+        return 0;
+    }
+
+    TracePolicy& trace() { return _trace; }
+
   private:
-    int _fd;
+    TracePolicy _trace;
 };
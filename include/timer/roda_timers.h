@@ -0,0 +1,287 @@
+#pragma once
+
+// Roda de timers hierárquica (hierarchical timing wheel) compartilhada pelas
+// sessões de um laço de eventos: armar e cancelar um timer são O(1),
+// independente da quantidade de sessões, e o laço lê o relógio uma única vez
+// por iteração (avanca()) ao invés de uma vez por timedOut() de cada
+// LeitorFSM. proximoDeadline() informa ao laço até quando pode dormir.
+//
+// NIVEIS níveis de SLOTS posições; cada posição do nível n cobre SLOTS^n
+// ticks de 1 ms. Um timer é guardado no nível cuja faixa contém o tempo
+// restante e desce de nível (cascata) quando o nível inferior completa uma
+// volta. Com 4 níveis de 64 posições, a faixa é de 2^24 ms (~4,6 h); timers
+// mais longos ficam no último nível e são reinseridos a cada volta.
+//
+// TimerPolicyRoda é a TimerPolicy do LeitorFSM sobre a roda da thread
+// (TimerPolicyRoda::roda()). timedOut() não lê o relógio: só passa a
+// retornar true quando o laço chama avanca() após o deadline (ver
+// leitor_reactor.h, que faz isso).
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+class RodaDeTimers {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr unsigned BITS_NIVEL = 6;
+    static constexpr unsigned SLOTS = 1u << BITS_NIVEL;
+    static constexpr unsigned NIVEIS = 4;
+
+    // nó intrusivo da roda: o timer não aloca memória ao ser armado
+    class Timer {
+      public:
+        Timer() = default;
+        ~Timer() { cancela(); }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        // chamado pela roda, dentro de avanca(), quando o timer expira
+        void aoExpirar(std::function<void()> callback) {
+            _callback = callback;
+        }
+
+        bool armado() const { return _roda != nullptr; }
+        void cancela() {
+            if (_roda)
+                _roda->_remove(*this);
+        }
+
+      private:
+        friend class RodaDeTimers;
+
+        RodaDeTimers* _roda = nullptr;
+        Timer* _proximo = nullptr;
+        Timer* _anterior = nullptr;
+        std::uint64_t _expira = 0; // tick
+        unsigned _nivel = 0;
+        unsigned _posicao = 0;
+        std::function<void()> _callback;
+    };
+
+    explicit RodaDeTimers(const clock::time_point inicio = clock::now())
+        : _inicio(inicio) {
+        for (auto& nivel : _slots)
+            for (auto& slot : nivel)
+                slot._proximo = slot._anterior = &slot;
+    }
+
+    ~RodaDeTimers() {
+        for (auto& nivel : _slots)
+            for (auto& slot : nivel)
+                while (slot._proximo != &slot)
+                    _remove(*slot._proximo);
+    }
+
+    RodaDeTimers(const RodaDeTimers&) = delete;
+    RodaDeTimers& operator=(const RodaDeTimers&) = delete;
+
+    // arma (ou rearma) o timer para expirar em deadline
+    void arma(Timer& timer, const clock::time_point deadline) {
+        timer.cancela();
+
+        // arredonda para cima: o timer nunca expira antes do deadline, e no
+        // mínimo no próximo tick
+        auto restante = deadline - _inicio;
+        std::uint64_t expira =
+            restante <= clock::duration::zero()
+                ? 0
+                : static_cast<std::uint64_t>(
+                      (restante + _tick() - clock::duration(1)) / _tick());
+        timer._expira = expira > _agora ? expira : _agora + 1;
+        timer._roda = this;
+        _insere(timer);
+        _armados++;
+    }
+
+    void arma(Timer& timer, const std::uint32_t milliseconds) {
+        arma(timer, clock::now() + std::chrono::milliseconds(milliseconds));
+    }
+
+    // expira os timers com deadline até agora, chamando seus callbacks.
+    // Retorna quantos expiraram.
+    std::size_t avanca(const clock::time_point agora = clock::now()) {
+        const std::uint64_t alvo =
+            agora > _inicio
+                ? static_cast<std::uint64_t>((agora - _inicio) / _tick())
+                : 0;
+        std::size_t expirados = 0;
+
+        while (_agora < alvo) {
+            // salta os ticks sem trabalho
+            const std::uint64_t proximo = _armados ? _proximoTick() : alvo + 1;
+            if (proximo > alvo) {
+                _agora = alvo;
+                break;
+            }
+            _agora = proximo;
+
+            // cascata: ao completar uma volta do nível n - 1, os timers da
+            // posição corrente do nível n descem de nível
+            for (unsigned n = 1; n < NIVEIS; n++) {
+                if (_agora & ((std::uint64_t(1) << (BITS_NIVEL * n)) - 1))
+                    break;
+                _cascata(n, _slot(n, _agora));
+            }
+
+            expirados += _expiraSlot(_slot(0, _agora));
+        }
+
+        return expirados;
+    }
+
+    // menor instante em que avanca() pode ter trabalho a fazer: exato para
+    // os timers do primeiro nível, e o início da próxima cascata para os
+    // demais. Retorna false se não há timers armados.
+    bool proximoDeadline(clock::time_point& deadline) const {
+        if (!_armados)
+            return false;
+        deadline = _inicio + _proximoTick() * _tick();
+        return true;
+    }
+
+    std::size_t armados() const { return _armados; }
+
+  private:
+    clock::time_point _inicio;
+    std::uint64_t _agora = 0; // último tick processado
+    std::size_t _armados = 0;
+    // sentinelas das listas circulares de cada posição
+    Timer _slots[NIVEIS][SLOTS];
+    // bit i: posição i do nível não vazia
+    std::uint64_t _ocupados[NIVEIS] = {};
+
+    static constexpr clock::duration _tick() {
+        return std::chrono::milliseconds(1);
+    }
+
+    // próximo tick com timers a expirar ou a descer de nível
+    std::uint64_t _proximoTick() const {
+        std::uint64_t proximo = UINT64_MAX;
+        for (unsigned n = 0; n < NIVEIS; n++) {
+            if (!_ocupados[n])
+                continue;
+            const unsigned deslocamento = BITS_NIVEL * n;
+            const std::uint64_t corrente = _agora >> deslocamento;
+            // posições ocupadas a partir da seguinte à corrente, em ordem
+            const unsigned rotacao = (corrente + 1) & (SLOTS - 1);
+            const std::uint64_t ocupados = _rotaciona(_ocupados[n], rotacao);
+            const std::uint64_t distancia = __builtin_ctzll(ocupados) + 1;
+            const std::uint64_t tick = (corrente + distancia) << deslocamento;
+            if (tick < proximo)
+                proximo = tick;
+        }
+        return proximo;
+    }
+
+    static unsigned _slot(const unsigned nivel, const std::uint64_t tick) {
+        return (tick >> (BITS_NIVEL * nivel)) & (SLOTS - 1);
+    }
+
+    static std::uint64_t _rotaciona(const std::uint64_t bits,
+                                    const unsigned n) {
+        return n ? (bits >> n) | (bits << (SLOTS - n)) : bits;
+    }
+
+    void _insere(Timer& timer) {
+        std::uint64_t restante = timer._expira - _agora;
+        unsigned nivel = 0;
+        while (nivel + 1 < NIVEIS &&
+               restante >= (std::uint64_t(1) << (BITS_NIVEL * (nivel + 1))))
+            nivel++;
+
+        // além da faixa da roda: última posição alcançável do último nível
+        std::uint64_t tick = timer._expira;
+        const std::uint64_t faixa = std::uint64_t(1) << (BITS_NIVEL * NIVEIS);
+        if (restante >= faixa)
+            tick = _agora + faixa - 1;
+
+        const unsigned slot = _slot(nivel, tick);
+        Timer& sentinela = _slots[nivel][slot];
+        timer._nivel = nivel;
+        timer._posicao = slot;
+        timer._proximo = &sentinela;
+        timer._anterior = sentinela._anterior;
+        sentinela._anterior->_proximo = &timer;
+        sentinela._anterior = &timer;
+        _ocupados[nivel] |= std::uint64_t(1) << slot;
+    }
+
+    // desliga o timer da lista, sem alterar _armados
+    void _desliga(Timer& timer) {
+        timer._anterior->_proximo = timer._proximo;
+        timer._proximo->_anterior = timer._anterior;
+        const Timer& sentinela = _slots[timer._nivel][timer._posicao];
+        if (sentinela._proximo == &sentinela)
+            _ocupados[timer._nivel] &= ~(std::uint64_t(1) << timer._posicao);
+        timer._proximo = timer._anterior = nullptr;
+    }
+
+    void _remove(Timer& timer) {
+        _desliga(timer);
+        timer._roda = nullptr;
+        _armados--;
+    }
+
+    void _cascata(const unsigned nivel, const unsigned slot) {
+        Timer& sentinela = _slots[nivel][slot];
+        while (sentinela._proximo != &sentinela) {
+            Timer& timer = *sentinela._proximo;
+            _desliga(timer);
+            _insere(timer);
+        }
+    }
+
+    std::size_t _expiraSlot(const unsigned slot) {
+        Timer& sentinela = _slots[0][slot];
+        std::size_t expirados = 0;
+        while (sentinela._proximo != &sentinela) {
+            Timer& timer = *sentinela._proximo;
+            _remove(timer);
+            expirados++;
+            // o callback pode rearmar este ou outros timers
+            if (timer._callback)
+                timer._callback();
+        }
+        return expirados;
+    }
+};
+
+// TimerPolicy do LeitorFSM sobre a roda de timers da thread
+class TimerPolicyRoda {
+  public:
+    using clock = RodaDeTimers::clock;
+
+    TimerPolicyRoda() {
+        _timer.aoExpirar([this]() {
+            _expirou = true;
+            if (_callback)
+                _callback();
+        });
+    }
+
+    void setTimeout(unsigned int milliseconds) {
+        _deadline = clock::now() + std::chrono::milliseconds(milliseconds);
+        _expirou = false;
+        roda().arma(_timer, _deadline);
+    }
+    bool timedOut() { return _expirou; }
+    clock::time_point deadline() const { return _deadline; }
+
+    // chamado, dentro de RodaDeTimers::avanca(), quando o timeout expira
+    void aoExpirar(std::function<void()> callback) { _callback = callback; }
+
+    // roda da thread corrente, avançada pelo laço de eventos
+    static RodaDeTimers& roda() {
+        static thread_local RodaDeTimers roda;
+        return roda;
+    }
+
+  private:
+    RodaDeTimers::Timer _timer;
+    clock::time_point _deadline;
+    bool _expirou = false;
+    std::function<void()> _callback;
+};
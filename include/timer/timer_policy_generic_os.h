@@ -1,7 +1,9 @@
 #pragma once
 #include <chrono>
 
-using clock_type = std::chrono::system_clock;
+// relógio monotônico: ajustes do relógio do sistema (e.g. pelo NTP) não
+// antecipam nem atrasam os timeouts do protocolo
+using clock_type = std::chrono::steady_clock;
 using moment = std::chrono::time_point<clock_type>;
 
 class TimerPolicyWinUnix {
@@ -10,6 +12,7 @@ class TimerPolicyWinUnix {
         _deadline = clock_type::now() + std::chrono::milliseconds(milliseconds);
     }
     bool timedOut() { return clock_type::now() >= _deadline; }
+    moment deadline() const { return _deadline; }
 
   private:
     moment _deadline;
@@ -0,0 +1,50 @@
+#pragma once
+
+// Relógio virtual para testes e simulações: o tempo só passa quando o teste
+// chama VirtualClock::avanca(), de modo que os timeouts do protocolo
+// (TMAXRSP, TSEMWAIT, ...) são exercitados em microssegundos e sempre com o
+// mesmo resultado. O relógio é único por thread e satisfaz os requisitos de
+// Clock da std::chrono (now(), time_point), o que permite usá-lo com
+// msAteDeadline() e com o proximoDeadline() do LeitorFSM.
+//
+//     LeitorFSM<TimerPolicyVirtual, SerialPolicyDummy> leitor(porta);
+//     ...
+//     VirtualClock::avanca(std::chrono::milliseconds(TMAXRSP_MSEC));
+//     leitor.processaEstado(); // retransmite o comando
+
+#include <chrono>
+
+class VirtualClock {
+  public:
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<VirtualClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return _agora(); }
+
+    static void avanca(const duration d) { _agora() += d; }
+
+    // volta ao instante zero
+    static void reinicia() { _agora() = time_point(); }
+
+  private:
+    static time_point& _agora() {
+        static thread_local time_point agora;
+        return agora;
+    }
+};
+
+class TimerPolicyVirtual {
+  public:
+    void setTimeout(unsigned int milliseconds) {
+        _deadline =
+            VirtualClock::now() + std::chrono::milliseconds(milliseconds);
+    }
+    bool timedOut() { return VirtualClock::now() >= _deadline; }
+    VirtualClock::time_point deadline() const { return _deadline; }
+
+  private:
+    VirtualClock::time_point _deadline;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+// Policies de trace dos bytes transmitidos e recebidos pelas policies seriais.
+// TracePolicyNull não gera código algum e deve ser usada em produção. As
+// policies binárias gravam registros com timestamp sem formatação (nenhum
+// printf na thread de I/O); os registros podem ser decodificados depois com
+// deserializaCabecalhoTrace().
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ring_buffer.h>
+
+typedef enum { TRACE_TX = 0, TRACE_RX = 1 } direcao_trace_t;
+
+// registro binário: cabeçalho de 11 bytes (little-endian) seguido dos bytes
+//   [0]     direção (direcao_trace_t)
+//   [1..8]  timestamp em ns (relógio monotônico)
+//   [9..10] quantidade de bytes que seguem o cabeçalho
+constexpr size_t TRACE_CABECALHO_SZ = 11;
+constexpr size_t TRACE_REGISTRO_MAX_SZ = 0xFFFF;
+
+typedef struct {
+    direcao_trace_t direcao;
+    uint64_t timestamp_ns;
+    uint16_t tamanho;
+} cabecalho_trace_t;
+
+inline uint64_t timestampTraceNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+inline void serializaCabecalhoTrace(const cabecalho_trace_t& cabecalho,
+                                    uint8_t out[TRACE_CABECALHO_SZ]) {
+    out[0] = static_cast<uint8_t>(cabecalho.direcao);
+    for (size_t i = 0; i < 8; i++)
+        out[1 + i] = static_cast<uint8_t>(cabecalho.timestamp_ns >> (8 * i));
+    out[9] = static_cast<uint8_t>(cabecalho.tamanho);
+    out[10] = static_cast<uint8_t>(cabecalho.tamanho >> 8);
+}
+
+inline cabecalho_trace_t
+deserializaCabecalhoTrace(const uint8_t in[TRACE_CABECALHO_SZ]) {
+    cabecalho_trace_t cabecalho;
+    cabecalho.direcao = in[0] == TRACE_TX ? TRACE_TX : TRACE_RX;
+    cabecalho.timestamp_ns = 0;
+    for (size_t i = 0; i < 8; i++)
+        cabecalho.timestamp_ns |= static_cast<uint64_t>(in[1 + i]) << (8 * i);
+    cabecalho.tamanho = static_cast<uint16_t>(in[9] | (in[10] << 8));
+    return cabecalho;
+}
+
+class TracePolicyNull {
+  public:
+    void trace(direcao_trace_t, const uint8_t*, size_t) noexcept {}
+};
+
+// trace legível em hexadecimal na saída padrão, somente para depuração: a
+// formatação e a escrita na saída padrão ocorrem na thread de I/O
+class TracePolicyStdout {
+  public:
+    void trace(direcao_trace_t direcao, const uint8_t* data,
+               size_t data_sz) noexcept {
+        if (!data_sz)
+            return;
+        printf(direcao == TRACE_TX ? "--> " : "<-- ");
+        for (size_t i = 0; i < data_sz; i++)
+            printf("%02X", data[i]);
+        printf("\n");
+    }
+};
+
+// grava os registros binários em um arquivo (escrita bufferizada pelo stdio)
+class TracePolicyArquivoBinario {
+  public:
+    ~TracePolicyArquivoBinario() { fecha(); }
+
+    bool abre(const char* caminho) {
+        fecha();
+        _arquivo = fopen(caminho, "wb");
+        return _arquivo != nullptr;
+    }
+
+    // usa um arquivo já aberto (e.g. tmpfile()), que passa a ser fechado por
+    // esta policy
+    void abre(FILE* arquivo) {
+        fecha();
+        _arquivo = arquivo;
+    }
+
+    void fecha() {
+        if (_arquivo) {
+            fclose(_arquivo);
+            _arquivo = nullptr;
+        }
+    }
+
+    FILE* arquivo() { return _arquivo; }
+
+    void trace(direcao_trace_t direcao, const uint8_t* data,
+               size_t data_sz) noexcept {
+        if (!_arquivo || !data_sz)
+            return;
+
+        const uint64_t timestamp = timestampTraceNs();
+        while (data_sz) {
+            size_t sz = data_sz > TRACE_REGISTRO_MAX_SZ ? TRACE_REGISTRO_MAX_SZ
+                                                        : data_sz;
+            uint8_t cabecalho[TRACE_CABECALHO_SZ];
+            serializaCabecalhoTrace(
+                {direcao, timestamp, static_cast<uint16_t>(sz)}, cabecalho);
+            fwrite(cabecalho, 1, sizeof(cabecalho), _arquivo);
+            fwrite(data, 1, sz, _arquivo);
+            data += sz;
+            data_sz -= sz;
+        }
+    }
+
+  private:
+    FILE* _arquivo = nullptr;
+};
+
+// guarda os registros binários em um ring buffer em memória, que pode ser
+// esvaziado por outra thread com proximoRegistro(). Se não houver espaço, o
+// registro é descartado e contabilizado em descartados().
+template <size_t S> class TracePolicyMemoria {
+  public:
+    void trace(direcao_trace_t direcao, const uint8_t* data,
+               size_t data_sz) noexcept {
+        if (!data_sz)
+            return;
+
+        const uint64_t timestamp = timestampTraceNs();
+        while (data_sz) {
+            size_t sz = data_sz > TRACE_REGISTRO_MAX_SZ ? TRACE_REGISTRO_MAX_SZ
+                                                        : data_sz;
+            // o registro inteiro é publicado de uma só vez, para que o
+            // consumidor nunca veja um cabeçalho sem os seus dados
+            auto livre = _registros.reserveWrite(TRACE_CABECALHO_SZ + sz);
+            if (livre.size() < TRACE_CABECALHO_SZ + sz) {
+                _descartados.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            uint8_t cabecalho[TRACE_CABECALHO_SZ];
+            serializaCabecalhoTrace(
+                {direcao, timestamp, static_cast<uint16_t>(sz)}, cabecalho);
+            _copia(livre, 0, cabecalho, sizeof(cabecalho));
+            _copia(livre, sizeof(cabecalho), data, sz);
+            _registros.commitWrite(TRACE_CABECALHO_SZ + sz);
+            data += sz;
+            data_sz -= sz;
+        }
+    }
+
+    // lê o próximo registro (até max_data_sz bytes de dados; o excedente é
+    // descartado). Retorna false se não há registros.
+    bool proximoRegistro(cabecalho_trace_t& cabecalho, uint8_t* data,
+                         size_t max_data_sz) {
+        uint8_t buf[TRACE_CABECALHO_SZ];
+        if (_registros.toread() < TRACE_CABECALHO_SZ)
+            return false;
+        _registros.read(buf, sizeof(buf));
+        cabecalho = deserializaCabecalhoTrace(buf);
+
+        size_t sz = cabecalho.tamanho < max_data_sz ? cabecalho.tamanho
+                                                    : max_data_sz;
+        _registros.read(data, sz);
+        _registros.consume(cabecalho.tamanho - sz);
+        return true;
+    }
+
+    size_t descartados() const {
+        return _descartados.load(std::memory_order_relaxed);
+    }
+
+  private:
+    RingBufferSPSC<uint8_t, S> _registros;
+    std::atomic<size_t> _descartados{0};
+
+    // copia para a região reservada a partir de offset, tratando a divisão
+    // em dois segmentos
+    static void _copia(RingBufferSpans<uint8_t>& destino, size_t offset,
+                       const uint8_t* data, size_t data_sz) {
+        for (size_t i = 0; i < data_sz; i++, offset++) {
+            if (offset < destino.primeiro.size)
+                destino.primeiro.data[offset] = data[i];
+            else
+                destino.segundo.data[offset - destino.primeiro.size] = data[i];
+        }
+    }
+};
@@ -1,12 +1,19 @@
 #include <CRC.h>
 
-uint16_t CRC16(const byte_t* data, const size_t data_sz) {
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define CRC16_CLMUL
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static constexpr CRC16Tabelas _geraTabelas() {
     const uint16_t POLY = 0xa001;
 
-    uint16_t crc = 0x0000;
+    CRC16Tabelas tabelas{};
 
-    for (size_t i = 0; i < data_sz; i++) {
-        crc ^= data[i];
+    for (size_t i = 0; i < 256; i++) {
+        uint16_t crc = static_cast<uint16_t>(i);
 
         size_t j = 8;
         while (j--) {
@@ -17,7 +24,317 @@ uint16_t CRC16(const byte_t* data, const size_t data_sz) {
                 crc >>= 1;
             }
         }
+
+        tabelas.t[0][i] = crc;
+    }
+
+    // tabela k: CRC do byte seguido de k bytes nulos
+    for (size_t k = 1; k < 8; k++) {
+        for (size_t i = 0; i < 256; i++) {
+            uint16_t crc = tabelas.t[k - 1][i];
+            tabelas.t[k][i] = (crc >> 8) ^ tabelas.t[0][crc & 0xFF];
+        }
+    }
+
+    return tabelas;
+}
+
+constexpr CRC16Tabelas CRC16Tabela = _geraTabelas();
+
+uint16_t CRC16UpdateTabela(uint16_t crc, const byte_t* data,
+                           const size_t data_sz) {
+    const auto& t = CRC16Tabela.t;
+
+    size_t i = 0;
+
+    // slice-by-8: processa 8 bytes por iteração
+    for (; i + 8 <= data_sz; i += 8) {
+        crc ^= static_cast<uint16_t>(data[i] | (data[i + 1] << 8));
+        crc = t[7][crc & 0xFF] ^ t[6][crc >> 8] ^ t[5][data[i + 2]] ^
+              t[4][data[i + 3]] ^ t[3][data[i + 4]] ^ t[2][data[i + 5]] ^
+              t[1][data[i + 6]] ^ t[0][data[i + 7]];
     }
 
+    for (; i < data_sz; i++)
+        crc = (crc >> 8) ^ t[0][(crc ^ data[i]) & 0xFF];
+
     return crc;
 }
+
+// abaixo deste tamanho a implementação por tabela é mais rápida que a CLMUL
+static constexpr size_t CLMUL_TAMANHO_MINIMO = 64;
+
+#ifdef CRC16_CLMUL
+
+// A implementação CLMUL segue o algoritmo de "folding" da Intel ("Fast CRC
+// Computation for Generic Polynomials Using PCLMULQDQ Instruction") na sua
+// versão refletida (LSB primeiro), a mesma usada para o CRC32 do ethernet.
+// Para reaproveitá-la com um CRC de 16 bits, usa-se o polinômio escalado
+// P32(x) = P(x) * x^16: o CRC32 calculado com P32 é o CRC16 multiplicado por
+// x^16, que na representação refletida ocupa exatamente os 16 bits menos
+// significativos do resultado.
+
+// x^n mod P32 na forma normal (bit i é o coeficiente de x^i)
+static constexpr uint32_t _xnModP32(size_t n) {
+    uint32_t r = 1;
+    while (n--)
+        r = (r & 0x80000000) ? (r << 1) ^ 0x80050000 : r << 1;
+    return r;
+}
+
+static constexpr uint64_t _reflete(uint64_t v, size_t bits) {
+    uint64_t r = 0;
+    for (size_t i = 0; i < bits; i++)
+        if (v & (uint64_t(1) << i))
+            r |= uint64_t(1) << (bits - 1 - i);
+    return r;
+}
+
+// constante de "folding": reflexo de x^n mod P32, deslocado de 1 bit pois o
+// produto de dois operandos refletidos fica deslocado de 1 bit
+static constexpr uint64_t _k(size_t n) {
+    return _reflete(_xnModP32(n), 32) << 1;
+}
+
+// floor(x^64 / P32), usado na redução de Barrett
+static constexpr uint64_t _mu() {
+    const uint64_t P = (uint64_t(1) << 32) | 0x80050000;
+    uint64_t q = 0;
+    uint64_t r = 0; // resto parcial (grau < 33)
+    for (int i = 64; i >= 0; i--) {
+        r = (r << 1) | (i == 64 ? 1 : 0);
+        q <<= 1;
+        if (r & (uint64_t(1) << 32)) {
+            r ^= P;
+            q |= 1;
+        }
+    }
+    return q;
+}
+
+static constexpr uint64_t K1 = _k(4 * 128 + 32);
+static constexpr uint64_t K2 = _k(4 * 128 - 32);
+static constexpr uint64_t K3 = _k(128 + 32);
+static constexpr uint64_t K4 = _k(128 - 32);
+static constexpr uint64_t K5 = _k(64);
+static constexpr uint64_t POLY_REFLETIDO =
+    _reflete((uint64_t(1) << 32) | 0x80050000, 33);
+static constexpr uint64_t MU_REFLETIDO = _reflete(_mu(), 33);
+
+#define CLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+
+CLMUL_TARGET static inline __m128i _carrega(const byte_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// dobra x sobre o bloco seguinte: x * x^(128-32) e x * x^(128+32)
+CLMUL_TARGET static inline __m128i _dobra(__m128i x, __m128i k3k4,
+                                          __m128i proximo) {
+    __m128i t = _mm_clmulepi64_si128(x, k3k4, 0x00);
+    x = _mm_clmulepi64_si128(x, k3k4, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(x, t), proximo);
+}
+
+CLMUL_TARGET static uint16_t _crc16Clmul(uint16_t crc, const byte_t* data,
+                                         size_t data_sz) {
+    // pré-condição: data_sz >= 64 e múltiplo de 16
+    const __m128i k1k2 = _mm_set_epi64x(K2, K1);
+    const __m128i k3k4 = _mm_set_epi64x(K4, K3);
+    const __m128i k5 = _mm_set_epi64x(0, K5);
+    const __m128i polyMu = _mm_set_epi64x(MU_REFLETIDO, POLY_REFLETIDO);
+    const __m128i mascara32 = _mm_set_epi32(0, 0, 0, -1);
+
+    __m128i x1 = _carrega(data);
+    __m128i x2 = _carrega(data + 16);
+    __m128i x3 = _carrega(data + 32);
+    __m128i x4 = _carrega(data + 48);
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    data += 64;
+    data_sz -= 64;
+
+    // dobra 4 x 128 bits por iteração
+    while (data_sz >= 64) {
+        __m128i t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1), _carrega(data));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, t2), _carrega(data + 16));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, t3), _carrega(data + 32));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, t4), _carrega(data + 48));
+        data += 64;
+        data_sz -= 64;
+    }
+
+    // dobra os 4 registradores em 1
+    x1 = _dobra(x1, k3k4, x2);
+    x1 = _dobra(x1, k3k4, x3);
+    x1 = _dobra(x1, k3k4, x4);
+
+    // blocos de 16 bytes restantes
+    while (data_sz >= 16) {
+        x1 = _dobra(x1, k3k4, _carrega(data));
+        data += 16;
+        data_sz -= 16;
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_srli_si128(x1, 8);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // 64 -> 32 bits
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mascara32);
+    x1 = _mm_clmulepi64_si128(x1, k5, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // redução de Barrett para 32 bits (o CRC16 fica nos 16 bits inferiores)
+    x2 = x1;
+    x1 = _mm_and_si128(x1, mascara32);
+    x1 = _mm_clmulepi64_si128(x1, polyMu, 0x10);
+    x1 = _mm_and_si128(x1, mascara32);
+    x1 = _mm_clmulepi64_si128(x1, polyMu, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint16_t>(_mm_extract_epi32(x1, 1));
+}
+
+static bool _detectaClmul() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+
+bool CRC16ClmulDisponivel() {
+    static const bool disponivel = _detectaClmul();
+    return disponivel;
+}
+
+uint16_t CRC16UpdateClmul(uint16_t crc, const byte_t* data,
+                          const size_t data_sz) {
+    if (data_sz < CLMUL_TAMANHO_MINIMO)
+        return CRC16UpdateTabela(crc, data, data_sz);
+
+    // a parte múltipla de 16 bytes é processada pela CLMUL e o restante
+    // pela tabela
+    const size_t sz = data_sz & ~size_t(15);
+    crc = _crc16Clmul(crc, data, sz);
+    return CRC16UpdateTabela(crc, data + sz, data_sz - sz);
+}
+
+#else
+
+bool CRC16ClmulDisponivel() { return false; }
+
+uint16_t CRC16UpdateClmul(uint16_t crc, const byte_t* data,
+                          const size_t data_sz) {
+    return CRC16UpdateTabela(crc, data, data_sz);
+}
+
+#endif
+
+uint16_t CRC16Update(uint16_t crc, const byte_t* data, const size_t data_sz) {
+    if (data_sz >= CLMUL_TAMANHO_MINIMO && CRC16ClmulDisponivel())
+        return CRC16UpdateClmul(crc, data, data_sz);
+    return CRC16UpdateTabela(crc, data, data_sz);
+}
+
+uint16_t CRC16(const byte_t* data, const size_t data_sz) {
+    return CRC16Update(0x0000, data, data_sz);
+}
+
+// aritmética em GF(2) módulo P na representação refletida (bit 15 é o
+// coeficiente de x^0), como no zlib (crc32_combine)
+
+// a * b mod P, com a != 0
+static uint16_t _multModP(uint16_t a, uint16_t b) {
+    uint16_t m = 0x8000;
+    uint16_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ 0xa001 : b >> 1;
+    }
+    return p;
+}
+
+struct TabelaX2n {
+    uint16_t t[64];
+};
+
+// t[k] = x^(2^k) mod P
+static TabelaX2n _geraTabelaX2n() {
+    TabelaX2n tabela;
+    uint16_t p = 0x4000; // x^1
+    for (size_t k = 0; k < 64; k++) {
+        tabela.t[k] = p;
+        p = _multModP(p, p);
+    }
+    return tabela;
+}
+
+// x^(n * 2^k) mod P
+static uint16_t _x2nModP(size_t n, size_t k) {
+    static const TabelaX2n tabela = _geraTabelaX2n();
+
+    uint16_t p = 0x8000; // x^0
+    while (n) {
+        if (n & 1)
+            p = _multModP(tabela.t[k], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+uint16_t CRC16Shift(const uint16_t crc, const size_t n) {
+    if (crc == 0)
+        return 0;
+    // n bytes nulos multiplicam o CRC por x^(8n)
+    return _multModP(_x2nModP(n, 3), crc);
+}
+
+uint16_t CRC16Combine(const uint16_t crcA, const uint16_t crcB,
+                      const size_t lenB) {
+    // como o CRC16 da NBR14522 não tem valor inicial nem XOR final, ele é
+    // linear: CRC(A || B) = CRC(A || 0...0) ^ CRC(B)
+    return CRC16Shift(crcA, lenB) ^ crcB;
+}
+
+uint16_t CRC16Patch(const uint16_t crc, const size_t data_sz,
+                    const size_t offset, const byte_t* antigos,
+                    const byte_t* novos, const size_t sz) {
+    // pela linearidade, CRC(novo) = CRC(antigo) ^ CRC(diferença), onde a
+    // diferença é nula fora do trecho substituído
+    CRC16State delta;
+    for (size_t i = 0; i < sz; i++)
+        delta.update(antigos[i] ^ novos[i]);
+
+    return crc ^ CRC16Shift(delta.finalize(), data_sz - offset - sz);
+}
+
+size_t verifyCRC(const NBR14522::resposta_t* frames, const size_t n, bool* ok) {
+    // seleciona a implementação uma única vez para todas as respostas
+    uint16_t (*crc16)(uint16_t, const byte_t*, const size_t) =
+        CRC16ClmulDisponivel() ? CRC16UpdateClmul : CRC16UpdateTabela;
+
+    size_t integras = 0;
+    for (size_t i = 0; i < n; i++) {
+        // o CRC sobre a resposta inteira (incluindo o CRC) é zero se íntegra
+        ok[i] = crc16(0x0000, frames[i].data(), frames[i].size()) == 0x0000;
+        if (ok[i])
+            integras++;
+    }
+
+    return integras;
+}
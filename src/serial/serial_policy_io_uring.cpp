@@ -0,0 +1,440 @@
+#include <serial/serial_policy_io_uring.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// sem liburing: as três syscalls do io_uring são chamadas diretamente
+
+static int _ioUringSetup(unsigned entradas, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entradas, p));
+}
+
+static int _ioUringEnter(int fd, unsigned submeter, unsigned minCompletadas,
+                         unsigned flags, const void* arg, size_t argSz) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, submeter,
+                                    minCompletadas, flags, arg, argSz));
+}
+
+static int _ioUringRegister(int fd, unsigned opcode, const void* arg,
+                            unsigned nArgs) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_register, fd, opcode, arg, nArgs));
+}
+
+// operações identificadas no user_data: (slot << 3) | operação
+enum {
+    OP_POLL_RX = 1,
+    OP_LEITURA = 2,
+    OP_POLL_TX = 3,
+    OP_ESCRITA = 4,
+    OP_CANCELA = 5,
+};
+
+static std::uint64_t _userData(const int slot, const int operacao) {
+    return (static_cast<std::uint64_t>(slot) << 3) | operacao;
+}
+
+AnelIoUring::AnelIoUring(const std::size_t maxPortas, const bool habilitado)
+    : _slots(maxPortas, slot_t{nullptr, -1, false, false, false, 0, 0}) {
+    if (!habilitado || !maxPortas)
+        return;
+
+    // até 4 operações em voo por porta (poll e leitura, poll e escrita)
+    unsigned entradas = 8;
+    while (entradas < 4 * maxPortas)
+        entradas <<= 1;
+
+    if (!_inicia(entradas))
+        _finaliza();
+}
+
+AnelIoUring::~AnelIoUring() { _finaliza(); }
+
+bool AnelIoUring::_inicia(const unsigned entradas) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    _fd = _ioUringSetup(entradas, &p);
+    if (_fd < 0)
+        return false;
+
+    // o timeout de processa() é passado a io_uring_enter (kernel >= 5.11)
+    if (!(p.features & IORING_FEAT_EXT_ARG))
+        return false;
+
+    _sqAnelSz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cqAnelSz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (_cqAnelSz > _sqAnelSz)
+            _sqAnelSz = _cqAnelSz;
+        _cqAnelSz = 0;
+    }
+
+    _sqAnel = mmap(nullptr, _sqAnelSz, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if (_sqAnel == MAP_FAILED) {
+        _sqAnel = nullptr;
+        return false;
+    }
+
+    if (_cqAnelSz) {
+        _cqAnel = mmap(nullptr, _cqAnelSz, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        if (_cqAnel == MAP_FAILED) {
+            _cqAnel = nullptr;
+            return false;
+        }
+    }
+    std::uint8_t* cq =
+        static_cast<std::uint8_t*>(_cqAnel ? _cqAnel : _sqAnel);
+
+    _sqesSz = p.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = mmap(nullptr, _sqesSz, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+    if (_sqes == MAP_FAILED) {
+        _sqes = nullptr;
+        return false;
+    }
+
+    std::uint8_t* sq = static_cast<std::uint8_t*>(_sqAnel);
+    _sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    _sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    _cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    _cqes = cq + p.cq_off.cqes;
+
+    // buffers registrados uma única vez: o kernel não precisa mapear as
+    // páginas a cada leitura e escrita
+    _buffersSz = 2 * IO_URING_BUFFER_PORTA_SZ * _slots.size();
+    void* buffers = mmap(nullptr, _buffersSz, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED)
+        return false;
+    _buffers = static_cast<std::uint8_t*>(buffers);
+
+    struct iovec iov = {_buffers, _buffersSz};
+    return _ioUringRegister(_fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+}
+
+void AnelIoUring::_finaliza() {
+    if (_buffers)
+        munmap(_buffers, _buffersSz);
+    if (_sqes)
+        munmap(_sqes, _sqesSz);
+    if (_cqAnel)
+        munmap(_cqAnel, _cqAnelSz);
+    if (_sqAnel)
+        munmap(_sqAnel, _sqAnelSz);
+    if (_fd >= 0)
+        close(_fd);
+
+    _buffers = nullptr;
+    _sqes = _cqAnel = _sqAnel = nullptr;
+    _fd = -1;
+}
+
+int AnelIoUring::_registra(SerialPolicyIoUring* porta, const int fd) {
+    for (size_t i = 0; i < _slots.size(); i++) {
+        if (!_slots[i].porta && !_slots[i].operacoes) {
+            _slots[i] = {porta, fd, false, false, false, 0, 0};
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool AnelIoUring::_remove(const int slot) {
+    slot_t& s = _slots[slot];
+    s.porta = nullptr;
+
+    bool cancelados = true;
+    if (s.leituraPendente)
+        cancelados = _cancela(_userData(slot, OP_POLL_RX)) && cancelados;
+    if (s.escritaPendente) {
+        cancelados = _cancela(_userData(slot, OP_POLL_TX)) && cancelados;
+        cancelados = _cancela(_userData(slot, OP_ESCRITA)) && cancelados;
+    }
+
+    // o fd só pode ser fechado após o kernel liberar as operações da porta
+    for (int tentativas = 0; s.operacoes && tentativas < 100; tentativas++)
+        _submete(1, 10);
+    s.fd = -1;
+
+    // operações ainda em andamento: o slot (e seus buffers) só é
+    // reaproveitado após completarem (ver _registra())
+    if (!cancelados || s.operacoes) {
+        _falhasRemocao++;
+        return false;
+    }
+    return true;
+}
+
+bool AnelIoUring::_reservaSqes(const unsigned n) {
+    auto livres = [&]() {
+        return _sqMask + 1 -
+               (*_sqTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE));
+    };
+
+    // fila de submissão cheia: submete antes de continuar
+    if (livres() < n)
+        _submete(0, 0);
+    return livres() >= n;
+}
+
+void* AnelIoUring::_proximaSqe() {
+    unsigned tail = *_sqTail;
+    unsigned i = tail & _sqMask;
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_sqes) + i;
+    memset(sqe, 0, sizeof(*sqe));
+    _sqArray[i] = i;
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+void AnelIoUring::_armaLeitura(const int slot) {
+    // poll encadeado à leitura: a leitura (fd não bloqueante) só é executada
+    // quando há bytes, sem ocupar uma thread do kernel por porta
+    if (!_reservaSqes(2))
+        return;
+
+    struct io_uring_sqe* poll =
+        static_cast<struct io_uring_sqe*>(_proximaSqe());
+    poll->opcode = IORING_OP_POLL_ADD;
+    poll->fd = _slots[slot].fd;
+    poll->poll32_events = POLLIN;
+    poll->flags = IOSQE_IO_LINK;
+    poll->user_data = _userData(slot, OP_POLL_RX);
+
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_proximaSqe());
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = _slots[slot].fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(_bufferRx(slot));
+    sqe->len = IO_URING_BUFFER_PORTA_SZ;
+    sqe->buf_index = 0;
+    sqe->user_data = _userData(slot, OP_LEITURA);
+
+    _slots[slot].leituraPendente = true;
+    _slots[slot].operacoes += 2;
+}
+
+void AnelIoUring::_armaEscrita(const int slot, const bool aguardaPoll) {
+    // sem espaço, tenta novamente no próximo processa()
+    if (!_reservaSqes(2))
+        return;
+
+    if (aguardaPoll) {
+        struct io_uring_sqe* poll =
+            static_cast<struct io_uring_sqe*>(_proximaSqe());
+        poll->opcode = IORING_OP_POLL_ADD;
+        poll->fd = _slots[slot].fd;
+        poll->poll32_events = POLLOUT;
+        poll->flags = IOSQE_IO_LINK;
+        poll->user_data = _userData(slot, OP_POLL_TX);
+        _slots[slot].operacoes++;
+    }
+
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_proximaSqe());
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = _slots[slot].fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(_bufferTx(slot));
+    sqe->len = static_cast<std::uint32_t>(_slots[slot].escritaSz);
+    sqe->buf_index = 0;
+    sqe->user_data = _userData(slot, OP_ESCRITA);
+
+    _slots[slot].escritaPendente = true;
+    _slots[slot].operacoes++;
+}
+
+bool AnelIoUring::_cancela(const std::uint64_t userData) {
+    // fila de submissão cheia mesmo após submeter: o kernel recusa novas
+    // submissões enquanto a fila de completadas está cheia, então colhe as
+    // completadas e tenta de novo
+    for (int tentativas = 0; !_reservaSqes(1); tentativas++) {
+        if (tentativas == 10)
+            return false;
+        _submete(1, 10);
+    }
+
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_proximaSqe());
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = _userData(static_cast<int>(userData >> 3), OP_CANCELA);
+    _slots[userData >> 3].operacoes++;
+    return true;
+}
+
+void AnelIoUring::_submete(const unsigned minCompletadas,
+                           const int timeout_ms) {
+    unsigned pendentes =
+        *_sqTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+
+    if (pendentes || minCompletadas) {
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        unsigned flags = 0;
+
+        if (minCompletadas) {
+            flags |= IORING_ENTER_GETEVENTS;
+            if (timeout_ms >= 0) {
+                ts.tv_sec = timeout_ms / 1000;
+                ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+                arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+            }
+        }
+        flags |= IORING_ENTER_EXT_ARG;
+        arg.sigmask_sz = _NSIG / 8;
+
+        _chamadas++;
+        // ETIME (timeout) e EINTR não são erros aqui
+        _ioUringEnter(_fd, pendentes, minCompletadas, flags, &arg,
+                      sizeof(arg));
+    }
+
+    // colhe as completadas
+    unsigned head = *_cqHead;
+    unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    const struct io_uring_cqe* cqes =
+        static_cast<const struct io_uring_cqe*>(_cqes);
+    while (head != tail) {
+        const struct io_uring_cqe& cqe = cqes[head & _cqMask];
+        _trataCompletada(cqe.user_data, cqe.res);
+        head++;
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+}
+
+void AnelIoUring::_trataCompletada(const std::uint64_t userData,
+                                   const int resultado) {
+    const int slot = static_cast<int>(userData >> 3);
+    slot_t& s = _slots[slot];
+    s.operacoes--;
+
+    switch (userData & 7) {
+    case OP_LEITURA:
+        s.leituraPendente = false;
+        if (resultado > 0 && s.porta)
+            s.porta->_rx.write(_bufferRx(slot),
+                               static_cast<std::size_t>(resultado));
+        else if (resultado == 0 ||
+                 (resultado < 0 && resultado != -EAGAIN &&
+                  resultado != -ECANCELED && resultado != -EINTR))
+            // porta desconectada ou com erro: deixa de ser lida
+            s.fd = -1;
+        break;
+    case OP_ESCRITA:
+        // o que sobrou é submetido no próximo processa(): as completadas são
+        // tratadas durante a colheita, que não pode submeter
+        s.escritaPendente = false;
+        s.escritaAguardaPoll = false;
+        if (resultado == -EAGAIN) {
+            // buffer de saída do tty cheio: aguarda POLLOUT
+            s.escritaAguardaPoll = true;
+        } else if (resultado > 0 &&
+                   static_cast<std::size_t>(resultado) < s.escritaSz) {
+            // escrita parcial
+            s.escritaSz -= resultado;
+            memmove(_bufferTx(slot), _bufferTx(slot) + resultado,
+                    s.escritaSz);
+        } else {
+            s.escritaSz = 0;
+        }
+        break;
+    default:
+        // polls e cancelamentos: o resultado chega pela operação encadeada
+        break;
+    }
+}
+
+void AnelIoUring::processa(const int timeout_ms) {
+    if (!disponivel())
+        return;
+
+    // rearma as leituras e submete as escritas enfileiradas por tx()
+    for (size_t i = 0; i < _slots.size(); i++) {
+        slot_t& s = _slots[i];
+        if (!s.porta || s.fd < 0)
+            continue;
+
+        if (!s.leituraPendente &&
+            s.porta->_rx.towrite() >= IO_URING_BUFFER_PORTA_SZ)
+            _armaLeitura(static_cast<int>(i));
+
+        if (!s.escritaPendente) {
+            if (!s.escritaSz)
+                s.escritaSz =
+                    s.porta->_tx.read(_bufferTx(static_cast<int>(i)),
+                                      IO_URING_BUFFER_PORTA_SZ);
+            if (s.escritaSz)
+                _armaEscrita(static_cast<int>(i), s.escritaAguardaPoll);
+        }
+    }
+
+    // uma única syscall submete tudo e aguarda a primeira completada, se
+    // ainda não houver nenhuma
+    bool haCompletadas =
+        *_cqHead != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    _submete(haCompletadas || !timeout_ms ? 0 : 1, timeout_ms);
+}
+
+bool SerialPolicyIoUring::openSerial(const char* name, baudrate_t baudrate,
+                                     databits_t databits, parity_t parity,
+                                     stopbits_t stopbits,
+                                     latencia_t latencia) {
+    closeSerial();
+    if (!_porta.openSerial(name, baudrate, databits, parity, stopbits,
+                           latencia))
+        return false;
+
+    descartaRx();
+    std::uint8_t descarte[64];
+    while (_tx.read(descarte, sizeof(descarte)))
+        ;
+
+    // sem io_uring, ou sem slots livres no anel, usa as syscalls da porta
+    if (_anel->disponivel())
+        _slot = _anel->_registra(this, _porta.fd());
+    return true;
+}
+
+bool SerialPolicyIoUring::closeSerial() {
+    bool removida = true;
+    if (_slot >= 0) {
+        removida = _anel->_remove(_slot);
+        _slot = -1;
+    }
+    _porta.closeSerial();
+    return removida;
+}
+
+void SerialPolicyIoUring::descartaRx() {
+    // bytes de uma leitura já submetida ao anel ainda podem chegar depois
+    std::uint8_t descarte[64];
+    while (_rx.read(descarte, sizeof(descarte)))
+        ;
+    _porta.descartaRx();
+}
+
+size_t SerialPolicyIoUring::tx(const std::uint8_t* data,
+                               const std::size_t data_sz) {
+    if (_slot < 0)
+        return _porta.tx(data, data_sz);
+    return _tx.write(data, data_sz);
+}
+
+size_t SerialPolicyIoUring::rx(std::uint8_t* data,
+                               const std::size_t max_data_sz) {
+    if (_slot < 0)
+        return _porta.rx(data, max_data_sz);
+    return _rx.read(data, max_data_sz);
+}
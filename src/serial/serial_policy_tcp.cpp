@@ -0,0 +1,285 @@
+#include <serial/serial_policy_tcp.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <initializer_list>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Telnet (RFC 854) e COM-PORT-OPTION (RFC 2217)
+enum {
+    TELNET_BINARY = 0,
+    TELNET_COM_PORT = 44,
+    TELNET_SE = 240,
+    TELNET_SB = 250,
+    TELNET_WILL = 251,
+    TELNET_WONT = 252,
+    TELNET_DO = 253,
+    TELNET_DONT = 254,
+    TELNET_IAC = 255,
+
+    RFC2217_SET_BAUDRATE = 1,
+    RFC2217_SET_DATASIZE = 2,
+    RFC2217_SET_PARITY = 3,
+    RFC2217_SET_STOPSIZE = 4,
+};
+
+// buffer de recepção: uma resposta completa e os sinalizadores próximos
+static const std::size_t BUFFER_RX_SZ = 512;
+
+static std::uint32_t _baudrate(baudrate_t baudrate) {
+    static const std::uint32_t valores[] = {
+        110, 300, 600, 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200};
+    return valores[baudrate];
+}
+
+SocketTcp::SocketTcp() : _bufferRx(BUFFER_RX_SZ) {}
+
+SocketTcp::~SocketTcp() { desconecta(); }
+
+bool SocketTcp::conecta(const char* host, const std::uint16_t porta,
+                        const int timeout_ms) {
+    desconecta();
+
+    struct addrinfo dicas;
+    memset(&dicas, 0, sizeof(dicas));
+    dicas.ai_family = AF_UNSPEC;
+    dicas.ai_socktype = SOCK_STREAM;
+
+    char servico[8];
+    snprintf(servico, sizeof(servico), "%u", porta);
+
+    struct addrinfo* enderecos;
+    if (getaddrinfo(host, servico, &dicas, &enderecos))
+        return false;
+
+    for (struct addrinfo* e = enderecos; e && _fd == -1; e = e->ai_next) {
+        _fd = socket(e->ai_family, e->ai_socktype, e->ai_protocol);
+        if (_fd == -1)
+            continue;
+        fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+        // cada sinalizador (ENQ, ACK, NAK) segue imediatamente, sem aguardar
+        // o ACK TCP do segmento anterior (algoritmo de Nagle)
+        int um = 1;
+        setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+
+        bool ok = connect(_fd, e->ai_addr, e->ai_addrlen) == 0;
+        if (!ok && errno == EINPROGRESS) {
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            int erro = 0;
+            socklen_t erroSz = sizeof(erro);
+            ok = poll(&pfd, 1, timeout_ms) > 0 &&
+                 getsockopt(_fd, SOL_SOCKET, SO_ERROR, &erro, &erroSz) == 0 &&
+                 erro == 0;
+        }
+        if (!ok) {
+            close(_fd);
+            _fd = -1;
+        }
+    }
+
+    freeaddrinfo(enderecos);
+    return _fd != -1;
+}
+
+void SocketTcp::desconecta() {
+    if (_fd != -1) {
+        close(_fd);
+        _fd = -1;
+    }
+    _fechado = false;
+    _rfc2217 = false;
+    _telnet = RX_DADOS;
+    _rxInicio = _rxFim = 0;
+}
+
+bool SocketTcp::configuraPorta(baudrate_t baudrate, databits_t databits,
+                               parity_t parity, stopbits_t stopbits) {
+    static const std::uint8_t paridades[] = {1, 2, 3}; // NONE, ODD, EVEN
+    const std::uint32_t baud = _baudrate(baudrate);
+    const std::uint8_t bits = static_cast<std::uint8_t>(5 + databits);
+
+    // modo binário nos dois sentidos e COM-PORT-OPTION
+    const std::uint8_t negociacao[] = {
+        TELNET_IAC, TELNET_WILL, TELNET_BINARY, TELNET_IAC, TELNET_DO,
+        TELNET_BINARY, TELNET_IAC, TELNET_WILL, TELNET_COM_PORT};
+
+    const std::uint8_t cabecalho[] = {TELNET_IAC, TELNET_SB, TELNET_COM_PORT};
+    const std::uint8_t fim[] = {TELNET_IAC, TELNET_SE};
+    std::vector<std::uint8_t> msg(negociacao, negociacao + sizeof(negociacao));
+
+    auto subnegociacao = [&](std::uint8_t comando,
+                             std::initializer_list<std::uint8_t> valor) {
+        msg.insert(msg.end(), cabecalho, cabecalho + sizeof(cabecalho));
+        msg.push_back(comando);
+        for (auto b : valor) {
+            msg.push_back(b);
+            if (b == TELNET_IAC)
+                msg.push_back(TELNET_IAC);
+        }
+        msg.insert(msg.end(), fim, fim + sizeof(fim));
+    };
+
+    subnegociacao(RFC2217_SET_BAUDRATE,
+                  {static_cast<std::uint8_t>(baud >> 24),
+                   static_cast<std::uint8_t>(baud >> 16),
+                   static_cast<std::uint8_t>(baud >> 8),
+                   static_cast<std::uint8_t>(baud)});
+    subnegociacao(RFC2217_SET_DATASIZE, {bits});
+    subnegociacao(RFC2217_SET_PARITY, {paridades[parity]});
+    subnegociacao(RFC2217_SET_STOPSIZE,
+                  {static_cast<std::uint8_t>(stopbits == STOPBITS_2 ? 2 : 1)});
+
+    _rfc2217 = true;
+    return _enviaTudo(msg.data(), msg.size());
+}
+
+size_t SocketTcp::tx(const std::uint8_t* data, const std::size_t data_sz) {
+    if (!conectado())
+        return 0;
+
+    if (!_rfc2217) {
+        ssize_t n = send(_fd, data, data_sz, MSG_NOSIGNAL);
+        return n >= 0 ? n : 0;
+    }
+
+    // IAC nos dados é duplicado
+    std::uint8_t escapados[2 * BUFFER_RX_SZ];
+    std::size_t enviados = 0;
+    while (enviados < data_sz) {
+        std::size_t sz = 0, consumidos = 0;
+        while (enviados + consumidos < data_sz &&
+               sz + 2 <= sizeof(escapados)) {
+            std::uint8_t b = data[enviados + consumidos++];
+            escapados[sz++] = b;
+            if (b == TELNET_IAC)
+                escapados[sz++] = TELNET_IAC;
+        }
+        if (!_enviaTudo(escapados, sz))
+            break;
+        enviados += consumidos;
+    }
+    return enviados;
+}
+
+size_t SocketTcp::rx(std::uint8_t* data, const std::size_t max_data_sz) {
+    if (_rxInicio == _rxFim && conectado()) {
+        ssize_t n = recv(_fd, _bufferRx.data(), _bufferRx.size(), 0);
+        // fim da conexão ou erro (e.g. ECONNRESET): aguardaRx() passa a
+        // retornar false de imediato
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                       errno != EINTR))
+            _fechado = true;
+        _rxInicio = 0;
+        _rxFim = n > 0 ? n : 0;
+        if (_rfc2217)
+            _rxFim = _filtraTelnet(_bufferRx.data(), _rxFim);
+    }
+
+    std::size_t sz = _rxFim - _rxInicio;
+    if (sz > max_data_sz)
+        sz = max_data_sz;
+    memcpy(data, &_bufferRx[_rxInicio], sz);
+    _rxInicio += sz;
+    return sz;
+}
+
+void SocketTcp::descartaRx() {
+    // não há tcflush para sockets: lê e descarta o que já chegou, até EAGAIN.
+    // Não basta parar no primeiro rx() sem dados: em RFC 2217, um bloco só
+    // de comandos Telnet é filtrado para 0 bytes com dados ainda na fila. Os
+    // blocos descartados passam pelo filtro para manter o estado do Telnet.
+    _rxInicio = _rxFim = 0;
+    while (conectado()) {
+        ssize_t n = recv(_fd, _bufferRx.data(), _bufferRx.size(), 0);
+        if (n > 0) {
+            if (_rfc2217)
+                _filtraTelnet(_bufferRx.data(), n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                _fechado = true;
+            break;
+        }
+    }
+}
+
+bool SocketTcp::_aguardaRx(int timeout_ms) {
+    if (!conectado())
+        return false;
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int n;
+    do {
+        n = poll(&pfd, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    // POLLHUP: rx() lê o fim da conexão e desconecta o socket, e as próximas
+    // chamadas retornam false de imediato; erro sem dados também
+    return n > 0 && (pfd.revents & (POLLIN | POLLHUP));
+}
+
+bool SocketTcp::_enviaTudo(const std::uint8_t* data, std::size_t data_sz) {
+    while (data_sz && conectado()) {
+        ssize_t n = send(_fd, data, data_sz, MSG_NOSIGNAL);
+        if (n > 0) {
+            data += n;
+            data_sz -= n;
+        } else if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            if (poll(&pfd, 1, 1000) <= 0)
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return !data_sz;
+}
+
+// remove os comandos Telnet dos bytes recebidos (no próprio buffer) e
+// retorna quantos bytes de dados restaram. As respostas do servidor à
+// negociação não são necessárias ao protocolo e são descartadas.
+std::size_t SocketTcp::_filtraTelnet(std::uint8_t* data,
+                                     const std::size_t data_sz) {
+    std::size_t sz = 0;
+    for (std::size_t i = 0; i < data_sz; i++) {
+        const std::uint8_t b = data[i];
+        switch (_telnet) {
+        case RX_DADOS:
+            if (b == TELNET_IAC)
+                _telnet = RX_IAC;
+            else
+                data[sz++] = b;
+            break;
+        case RX_IAC:
+            if (b == TELNET_IAC) {
+                data[sz++] = b; // IAC escapado
+                _telnet = RX_DADOS;
+            } else if (b == TELNET_SB) {
+                _telnet = RX_SB;
+            } else if (b >= TELNET_WILL && b <= TELNET_DONT) {
+                _telnet = RX_OPCAO;
+            } else {
+                _telnet = RX_DADOS;
+            }
+            break;
+        case RX_OPCAO:
+            _telnet = RX_DADOS;
+            break;
+        case RX_SB:
+            if (b == TELNET_IAC)
+                _telnet = RX_SB_IAC;
+            break;
+        case RX_SB_IAC:
+            _telnet = b == TELNET_SE ? RX_DADOS : RX_SB;
+            break;
+        }
+    }
+    return sz;
+}
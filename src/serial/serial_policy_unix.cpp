@@ -1,11 +1,16 @@
 #include <serial/serial_policy_unix.h>
 
 #include <assert.h>
-#include <cstdio>
+#include <cerrno>
 #include <fcntl.h>
+#include <poll.h>
 #include <string.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
 #include <sys/ioctl.h>
-#include <termio.h>
+#include <sys/uio.h>
+#include <termios.h>
 #include <unistd.h>
 
 static speed_t _termiosBaudrate(baudrate_t baudrate) {
@@ -79,11 +84,16 @@ static int _termiosStopbits(stopbits_t stopbits) {
 static void _setTermiosOptions(struct termios& options, baudrate_t baudrate,
                                databits_t databits, parity_t parity,
                                stopbits_t stopbits) {
+    // raw: sem eco, sem modo canônico, sem sinais e sem tradução de bytes
+    // (e.g. CR/LF e XON/XOFF), que corromperiam os blocos binários
+    cfmakeraw(&options);
+
     // baudrate
     cfsetispeed(&options, _termiosBaudrate(baudrate));
     cfsetospeed(&options, _termiosBaudrate(baudrate));
 
     options.c_cflag |= CLOCAL | CREAD;
+    options.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
 
     // databits
     options.c_cflag |= _termiosDatabits(databits);
@@ -92,65 +102,157 @@ static void _setTermiosOptions(struct termios& options, baudrate_t baudrate,
     // stopbits
     options.c_cflag |= _termiosStopbits(stopbits);
 
-    // options.c_iflag |= (IGNPAR | IGNBRK);
+    // leituras não bloqueiam: a espera por bytes é feita com poll(2), que
+    // acorda no primeiro byte disponível
+    options.c_cc[VMIN] = 0;
+    options.c_cc[VTIME] = 0;
 }
 
-bool SerialPolicyUnix::openSerial(const char* name, baudrate_t baudrate,
-                                  databits_t databits, parity_t parity,
-                                  stopbits_t stopbits) {
+bool SerialUnix::openSerial(const char* name, baudrate_t baudrate,
+                            databits_t databits, parity_t parity,
+                            stopbits_t stopbits, latencia_t latencia) {
+    closeSerial();
     _fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
     if (_fd == -1)
         return false;
+    _rxInicio = _rxFim = 0;
 
     struct termios options;
-    tcgetattr(_fd, &options);
     bzero(&options, sizeof(options));
     _setTermiosOptions(options, baudrate, databits, parity, stopbits);
     // Activate the settings
     tcsetattr(_fd, TCSANOW, &options);
+
+#ifdef ASYNC_LOW_LATENCY
+    // sem baixa latência, conversores USB-serial (e.g. FTDI) acumulam os
+    // bytes recebidos por até 16 ms antes de entregá-los, o que consome a
+    // maior parte de TMAXSINC
+    struct serial_struct serial;
+    if (latencia == LATENCIA_BAIXA && ioctl(_fd, TIOCGSERIAL, &serial) == 0) {
+        _flagsSerialOriginais = serial.flags;
+        serial.flags |= ASYNC_LOW_LATENCY;
+        _baixaLatencia = ioctl(_fd, TIOCSSERIAL, &serial) == 0;
+    }
+#else
+    (void)latencia;
+#endif
+
+    // descarta o que foi recebido antes da configuração
+    tcflush(_fd, TCIOFLUSH);
     return true;
 }
 
-void SerialPolicyUnix::closeSerial() {
+void SerialUnix::closeSerial() {
     if (_fd != -1) {
+#ifdef ASYNC_LOW_LATENCY
+        struct serial_struct serial;
+        if (_baixaLatencia && ioctl(_fd, TIOCGSERIAL, &serial) == 0) {
+            serial.flags = _flagsSerialOriginais;
+            ioctl(_fd, TIOCSSERIAL, &serial);
+        }
+#endif
         close(_fd);
         _fd = -1;
     }
+    _baixaLatencia = false;
+    _flagsSerialOriginais = -1;
 }
 
-SerialPolicyUnix::~SerialPolicyUnix() { closeSerial(); }
+SerialUnix::~SerialUnix() { closeSerial(); }
 
-size_t SerialPolicyUnix::tx(const uint8_t* data, const size_t data_sz) {
-    // #ifdef PRINT_BYTES
-    printf("--> ");
-    for (size_t i = 0; i < data_sz; i++)
-        printf("%02X", data[i]);
-    printf("\n");
-    // #endif
+void SerialUnix::descartaRx() {
+    _rxInicio = _rxFim = 0;
+    if (_fd != -1)
+        tcflush(_fd, TCIFLUSH);
+}
+
+size_t SerialUnix::tx(const uint8_t* data, const size_t data_sz) {
+    _estatisticas.escritas++;
     ssize_t numBytesWritten = write(_fd, data, data_sz);
 
     return numBytesWritten >= 0 ? numBytesWritten : 0;
 }
 
-size_t SerialPolicyUnix::rx(uint8_t* data, const size_t max_data_sz) {
-    int toread = 0;
-    ioctl(_fd, FIONREAD, &toread);
-    if (toread <= 0)
-        return 0;
+size_t SerialUnix::rx(uint8_t* data, const size_t max_data_sz) {
+    _estatisticas.chamadasRx++;
 
-    if (toread > static_cast<int>(max_data_sz))
-        toread = max_data_sz;
+    if (_rxInicio == _rxFim) {
+        // leituras maiores que o buffer vão direto para o destino
+        if (max_data_sz >= _bufferRx.size())
+            return _le(data, max_data_sz);
 
-    ssize_t numBytesRead = read(_fd, data, toread);
+        _rxInicio = 0;
+        _rxFim = _le(_bufferRx.data(), _bufferRx.size());
+    }
+
+    return _entregaBufferRx(data, max_data_sz);
+}
 
-    // #ifdef PRINT_BYTES
-    if (numBytesRead >= 0) {
-        printf("<-- ");
-        for (size_t i = 0; i < toread; i++)
-            printf("%02X", data[i]);
-        printf("\n");
+size_t SerialUnix::rx(RingBufferSpans<uint8_t> destino) {
+    _estatisticas.chamadasRx++;
+    if (!destino.primeiro.size)
+        return 0;
+
+    // bytes já lidos do kernel são entregues antes
+    if (_rxInicio != _rxFim) {
+        size_t n = _entregaBufferRx(destino.primeiro.data,
+                                    destino.primeiro.size);
+        if (n == destino.primeiro.size)
+            n += _entregaBufferRx(destino.segundo.data, destino.segundo.size);
+        return n;
     }
-    // #endif
 
-    return numBytesRead >= 0 ? numBytesRead : 0;
-}
\ No newline at end of file
+    struct iovec iov[2] = {{destino.primeiro.data, destino.primeiro.size},
+                           {destino.segundo.data, destino.segundo.size}};
+    int iovcnt = destino.segundo.size ? 2 : 1;
+
+    // porta aberta com O_NONBLOCK: sem dados, readv retorna -1 (EAGAIN)
+    _estatisticas.leituras++;
+    ssize_t numBytesRead = readv(_fd, iov, iovcnt);
+    if (numBytesRead <= 0)
+        return 0;
+
+    _estatisticas.bytesRecebidos += numBytesRead;
+    return numBytesRead;
+}
+
+void SerialUnix::setTamanhoBufferRx(const size_t sz) {
+    _bufferRx.assign(sz ? sz : 1, 0);
+    _rxInicio = _rxFim = 0;
+}
+
+size_t SerialUnix::_le(uint8_t* data, const size_t data_sz) {
+    // porta aberta com O_NONBLOCK: sem dados, read retorna -1 (EAGAIN)
+    _estatisticas.leituras++;
+    ssize_t numBytesRead = read(_fd, data, data_sz);
+    if (numBytesRead <= 0)
+        return 0;
+
+    _estatisticas.bytesRecebidos += numBytesRead;
+    return numBytesRead;
+}
+
+size_t SerialUnix::_entregaBufferRx(uint8_t* data, const size_t max_data_sz) {
+    size_t sz = _rxFim - _rxInicio;
+    if (sz > max_data_sz)
+        sz = max_data_sz;
+
+    memcpy(data, &_bufferRx[_rxInicio], sz);
+    _rxInicio += sz;
+    return sz;
+}
+
+bool SerialUnix::_aguardaRx(int timeout_ms) {
+    _estatisticas.esperas++;
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int n;
+    // interrompido por um sinal: aguarda de novo (o timeout recomeça)
+    do {
+        n = poll(&pfd, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    // desconexão ou erro: o pty ou tty também sinaliza POLLIN, mas read(2)
+    // não tem o que ler (EIO)
+    if (n > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        return false;
+    return n > 0 && (pfd.revents & POLLIN);
+}
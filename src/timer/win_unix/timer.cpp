@@ -1,7 +1,7 @@
 #include <chrono>
 #include <timer/timer.h>
 
-using clock_type = std::chrono::system_clock;
+using clock_type = std::chrono::steady_clock;
 using moment = std::chrono::time_point<clock_type>;
 
 struct TimerImplementacao {
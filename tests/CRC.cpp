@@ -1,6 +1,7 @@
 #include "doctest/doctest.h"
 #include <CRC.h>
 #include <NBR14522.h>
+#include <algorithm>
 #include <array>
 
 // https://crccalc.com/ (CRC-16/ARC)
@@ -37,3 +38,183 @@ TEST_CASE("CRC16") {
     crc = CRC16(data0, sizeof(data0));
     CHECK(crc == 0xF5B1);
 }
+
+// implementação bit a bit (original) usada como referência
+static uint16_t CRC16BitABit(const byte_t* data, const size_t data_sz) {
+    uint16_t crc = 0x0000;
+
+    for (size_t i = 0; i < data_sz; i++) {
+        crc ^= data[i];
+
+        size_t j = 8;
+        while (j--) {
+            if (crc & 0x0001)
+                crc = (crc >> 1) ^ 0xa001;
+            else
+                crc >>= 1;
+        }
+    }
+
+    return crc;
+}
+
+TEST_CASE("CRC16 por tabela (slice-by-8) igual ao bit a bit") {
+    byte_t data[300];
+    uint32_t semente = 12345;
+    for (auto& b : data) {
+        semente = semente * 1103515245 + 12345;
+        b = static_cast<byte_t>(semente >> 16);
+    }
+
+    for (size_t sz = 0; sz <= sizeof(data); sz++)
+        CHECK(CRC16(data, sz) == CRC16BitABit(data, sz));
+}
+
+TEST_CASE("CRC16State") {
+    NBR14522::resposta_t rsp;
+    for (size_t i = 0; i < rsp.size(); i++)
+        rsp.at(i) = static_cast<byte_t>(i * 7);
+    NBR14522::setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+
+    SUBCASE("incremental igual ao cálculo de uma vez") {
+        CRC16State crc;
+        crc.init();
+        size_t i = 0;
+        size_t pedaco = 1;
+        while (i < rsp.size() - 2) {
+            size_t sz = std::min(pedaco, rsp.size() - 2 - i);
+            crc.update(&rsp[i], sz);
+            i += sz;
+            pedaco = (pedaco * 3) % 17 + 1;
+        }
+        CHECK(crc.finalize() == NBR14522::getCRC(rsp));
+    }
+
+    SUBCASE("byte a byte") {
+        CRC16State crc;
+        for (size_t i = 0; i < rsp.size() - 2; i++)
+            crc.update(rsp.at(i));
+        CHECK(crc.finalize() == NBR14522::getCRC(rsp));
+    }
+
+    SUBCASE("CRC sobre a resposta inteira (com CRC) resulta em zero") {
+        CRC16State crc;
+        crc.update(rsp.data(), rsp.size());
+        CHECK(crc.finalize() == 0x0000);
+
+        rsp.at(100) ^= 0x01;
+        crc.init();
+        crc.update(rsp.data(), rsp.size());
+        CHECK(crc.finalize() != 0x0000);
+    }
+}
+
+TEST_CASE("CRC16 CLMUL igual ao bit a bit") {
+    if (!CRC16ClmulDisponivel()) {
+        MESSAGE("CPU sem suporte a PCLMULQDQ, teste ignorado");
+        return;
+    }
+
+    byte_t data[1024];
+    uint32_t semente = 54321;
+    for (auto& b : data) {
+        semente = semente * 1103515245 + 12345;
+        b = static_cast<byte_t>(semente >> 16);
+    }
+
+    for (size_t sz = 0; sz <= sizeof(data); sz++) {
+        CHECK(CRC16UpdateClmul(0x0000, data, sz) == CRC16BitABit(data, sz));
+        CHECK(CRC16UpdateClmul(0x0000, data, sz) ==
+              CRC16UpdateTabela(0x0000, data, sz));
+    }
+
+    // continuação de um CRC já iniciado
+    for (size_t sz = 64; sz <= 300; sz++)
+        CHECK(CRC16UpdateClmul(CRC16BitABit(data, 7), data + 7, sz) ==
+              CRC16BitABit(data, sz + 7));
+}
+
+TEST_CASE("verifyCRC") {
+    NBR14522::resposta_t respostas[5];
+    bool ok[5];
+
+    for (size_t i = 0; i < 5; i++) {
+        respostas[i].fill(static_cast<byte_t>(i));
+        respostas[i].at(0) = 0x14;
+        NBR14522::setCRC(respostas[i], CRC16(respostas[i].data(),
+                                             respostas[i].size() - 2));
+    }
+
+    CHECK(verifyCRC(respostas, 5, ok) == 5);
+    for (size_t i = 0; i < 5; i++)
+        CHECK(ok[i]);
+
+    respostas[1].at(10) ^= 0x80;
+    respostas[4].at(257) ^= 0x01;
+
+    CHECK(verifyCRC(respostas, 5, ok) == 3);
+    CHECK(ok[0]);
+    CHECK(!ok[1]);
+    CHECK(ok[2]);
+    CHECK(ok[3]);
+    CHECK(!ok[4]);
+}
+
+TEST_CASE("CRC16Combine e CRC16Shift") {
+    byte_t data[200];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = static_cast<byte_t>(i * 13 + 5);
+
+    for (size_t corte = 0; corte <= sizeof(data); corte += 7) {
+        uint16_t crcA = CRC16(data, corte);
+        uint16_t crcB = CRC16(data + corte, sizeof(data) - corte);
+        CHECK(CRC16Combine(crcA, crcB, sizeof(data) - corte) ==
+              CRC16(data, sizeof(data)));
+    }
+
+    byte_t zeros[100] = {};
+    CHECK(CRC16Shift(CRC16(data, 10), 100) ==
+          CRC16Update(CRC16(data, 10), zeros, 100));
+    CHECK(CRC16Shift(0x0000, 100) == 0x0000);
+}
+
+TEST_CASE("Substituição de bytes com atualização incremental do CRC") {
+    using namespace NBR14522;
+
+    comando_t modelo;
+    modelo.fill(0x00);
+    modelo.at(0) = 0x51;
+    modelo.at(5) = 0x01;
+    setCRC(modelo, CRC16(modelo.data(), modelo.size() - 2));
+
+    SUBCASE("número de série do leitor") {
+        comando_t cmd = modelo;
+        leitor_num_serie_t num = {0x12, 0x34, 0x56};
+        setNumSerieLeitor(cmd, num);
+
+        CHECK(cmd.at(1) == 0x12);
+        CHECK(cmd.at(2) == 0x34);
+        CHECK(cmd.at(3) == 0x56);
+        CHECK(getCRC(cmd) == CRC16(cmd.data(), cmd.size() - 2));
+    }
+
+    SUBCASE("substituições sucessivas") {
+        comando_t cmd = modelo;
+        for (size_t i = 0; i < 50; i++) {
+            byte_t novos[4] = {static_cast<byte_t>(i), 0xAB,
+                               static_cast<byte_t>(i * 3), 0xCD};
+            size_t offset = 1 + (i * 5) % (COMANDO_SZ - 2 - 4);
+            patchBytes(cmd, offset, novos, sizeof(novos));
+            CHECK(getCRC(cmd) == CRC16(cmd.data(), cmd.size() - 2));
+        }
+    }
+
+    SUBCASE("resposta") {
+        resposta_t rsp;
+        rsp.fill(0x11);
+        setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+        byte_t novos[] = {0x99};
+        patchBytes(rsp, RESPOSTA_SZ - 3, novos, 1);
+        CHECK(getCRC(rsp) == CRC16(rsp.data(), rsp.size() - 2));
+    }
+}
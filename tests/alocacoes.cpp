@@ -0,0 +1,168 @@
+#include "doctest/doctest.h"
+#include <NBR14522.h>
+#include <arena_respostas.h>
+#include <chrono>
+#include <cstdlib>
+#include <leitor.h>
+#include <log_policy.h>
+#include <medidor_simulado.h>
+#include <new>
+#include <protocolo_leitor.h>
+#include <timer/timer_policy_virtual.h>
+#include <vector>
+
+using namespace NBR14522;
+
+// conta as alocações da thread: substitui o operator new global do binário
+// de testes
+static thread_local size_t alocacoes = 0;
+
+void* operator new(std::size_t sz) {
+    alocacoes++;
+    if (void* p = std::malloc(sz ? sz : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// medidor simulado no relógio virtual; cada consulta à porta avança 1 ms,
+// como a 9600 bps
+class SerialPolicyMedidorVirtual {
+  public:
+    MedidorSimulado medidor;
+
+    SerialPolicyMedidorVirtual(const MedidorSimulado::configuracao_t& cfg)
+        : medidor(cfg) {}
+
+    size_t tx(const byte_t* data, const size_t data_sz) {
+        medidor.recebe(data, data_sz, _agora());
+        return data_sz;
+    }
+    size_t rx(byte_t* data, const size_t max_data_sz) {
+        VirtualClock::avanca(std::chrono::milliseconds(1));
+        return medidor.transmite(data, max_data_sz, _agora());
+    }
+
+  private:
+    static MedidorSimulado::instante_t _agora() {
+        return MedidorSimulado::instante_t(
+            std::chrono::duration_cast<MedidorSimulado::clock::duration>(
+                VirtualClock::now().time_since_epoch()));
+    }
+};
+
+TEST_CASE("Leitor: leituras sem alocação") {
+    MedidorSimulado::configuracao_t cfg = MedidorSimulado::configuracaoPadrao();
+    cfg.periodoEnq_ms = TMINENQ_MSEC + 10;
+    cfg.respostasCompostas = 3;
+    SerialPolicyMedidorVirtual porta(cfg);
+
+    // porta sem posse e callback chamado por referência
+    Leitor<TimerPolicyVirtual, SerialPolicyMedidorVirtual, LogPolicyNull>
+        leitor(porta);
+    leitor.setSessao(true);
+    comando_t cmd;
+    cmd.fill(0x00);
+    size_t respostas = 0;
+    byte_t ultima = 0;
+    auto callback = [&](const resposta_t& rsp) {
+        respostas++;
+        ultima = rsp.at(0);
+    };
+
+    // a primeira leitura dimensiona os buffers do medidor simulado
+    cmd.at(0) = 0x26;
+    REQUIRE(leitor.leitura(cmd, callback, 10000));
+
+    const byte_t plano[] = {0x14, 0x26, 0x14, 0x26};
+    bool sucessos[sizeof(plano)];
+    respostas = 0;
+    const size_t antes = alocacoes;
+    for (size_t i = 0; i < sizeof(plano); i++) {
+        cmd.at(0) = plano[i];
+        sucessos[i] = leitor.leitura(cmd, callback, 10000);
+    }
+    const size_t durante = alocacoes - antes;
+
+    for (const bool sucesso : sucessos)
+        CHECK(sucesso);
+    CHECK(respostas == 2 * (1 + cfg.respostasCompostas));
+    CHECK(ultima == 0x26);
+    CHECK(leitor.metricas().sincronizados >= sizeof(plano));
+    CHECK(durante == 0);
+}
+
+// leitura de um comando composto com o ProtocoloLeitor, retendo cada resposta
+// na arena
+static bool leituraComposta(ProtocoloLeitor& protocolo, ArenaRespostas& arena,
+                            MedidorSimulado& medidor,
+                            ProtocoloLeitor::instante_t& agora,
+                            std::vector<ArenaRespostas::Resposta>& respostas) {
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x52;
+    protocolo.recebeEm(arena.recepcao());
+    protocolo.setComando(cmd, agora);
+    const ProtocoloLeitor::instante_t limite = agora + std::chrono::minutes(1);
+    byte_t buf[RESPOSTA_SZ];
+    while (protocolo.estado() != ProtocoloLeitor::AguardaNovoComando &&
+           agora < limite) {
+        const size_t n = medidor.transmite(buf, sizeof(buf), agora);
+        size_t consumidos = 0;
+        do {
+            const ProtocoloLeitor::resultado_t r =
+                n ? protocolo.recebe(buf + consumidos, n - consumidos, agora)
+                  : protocolo.processa(agora);
+            consumidos += r.consumidos;
+            if (r.eventos & ProtocoloLeitor::EventoTransmissao) {
+                size_t sz;
+                const byte_t* tx = protocolo.transmissao(sz);
+                medidor.recebe(tx, sz, agora);
+            }
+            if (r.eventos & ProtocoloLeitor::EventoResposta) {
+                respostas.push_back(arena.retem());
+                protocolo.recebeEm(arena.recepcao());
+            }
+        } while (consumidos < n &&
+                 protocolo.estado() != ProtocoloLeitor::AguardaNovoComando);
+        agora += std::chrono::milliseconds(1);
+    }
+    return protocolo.status() == ProtocoloLeitor::Sucesso;
+}
+
+TEST_CASE("ArenaRespostas: memória de massa sem alocação após a primeira") {
+    MedidorSimulado::configuracao_t cfg = MedidorSimulado::configuracaoPadrao();
+    cfg.periodoEnq_ms = TMINENQ_MSEC + 10;
+    cfg.respostasCompostas = 40;
+    MedidorSimulado medidor(cfg);
+    ProtocoloLeitor protocolo;
+    protocolo.setSessao(true);
+    ArenaRespostas arena;
+    ProtocoloLeitor::instante_t agora = ProtocoloLeitor::instante_t();
+    std::vector<ArenaRespostas::Resposta> respostas;
+    respostas.reserve(cfg.respostasCompostas);
+
+    // a primeira leitura aloca os lotes da arena
+    REQUIRE(leituraComposta(protocolo, arena, medidor, agora, respostas));
+    REQUIRE(respostas.size() == cfg.respostasCompostas);
+    const size_t blocos = arena.blocos();
+    CHECK(arena.maximoEmUso() == cfg.respostasCompostas + 1);
+    respostas.clear();
+
+    const size_t antes = alocacoes;
+    const bool sucesso =
+        leituraComposta(protocolo, arena, medidor, agora, respostas);
+    const size_t durante = alocacoes - antes;
+
+    CHECK(sucesso);
+    CHECK(durante == 0);
+    CHECK(arena.blocos() == blocos);
+    REQUIRE(respostas.size() == cfg.respostasCompostas);
+    for (size_t i = 0; i < respostas.size(); i++) {
+        CHECK(respostas[i]->at(0) == 0x52);
+        CHECK(respostas[i]->at(6) == static_cast<byte_t>(6 + i));
+    }
+    CHECK(isLastRespostaOfComposed(*respostas.back()));
+}
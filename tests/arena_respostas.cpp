@@ -0,0 +1,149 @@
+#include "doctest/doctest.h"
+#include <NBR14522.h>
+#include <arena_respostas.h>
+#include <cstring>
+#include <protocolo_leitor.h>
+#include <utility>
+#include <vector>
+
+using namespace NBR14522;
+
+TEST_CASE("ArenaRespostas: recepção, retenção e reaproveitamento") {
+    ArenaRespostas arena;
+    CHECK(arena.blocos() == 0);
+    CHECK(arena.emUso() == 0);
+
+    // o bloco de recepção é o mesmo até ser retido
+    resposta_t* bloco = arena.recepcao();
+    CHECK(arena.recepcao() == bloco);
+    CHECK(arena.emUso() == 1);
+    CHECK(arena.blocos() == ArenaRespostas::BLOCOS_POR_LOTE);
+    bloco->at(0) = 0x52;
+
+    ArenaRespostas::Resposta retida = arena.retem();
+    REQUIRE(retida);
+    CHECK(&*retida == bloco);
+    CHECK(retida->at(0) == 0x52);
+    CHECK(arena.recepcao() != bloco);
+    CHECK(arena.emUso() == 2);
+
+    // a view pode ser movida; o bloco volta à arena uma só vez
+    ArenaRespostas::Resposta movida = std::move(retida);
+    CHECK_FALSE(retida);
+    CHECK(&*movida == bloco);
+    movida.libera();
+    CHECK_FALSE(movida);
+    CHECK(arena.emUso() == 1);
+
+    // além de um lote, mais blocos são alocados; liberados, são
+    // reaproveitados sem novos lotes
+    std::vector<ArenaRespostas::Resposta> respostas;
+    const size_t N = 2 * ArenaRespostas::BLOCOS_POR_LOTE + 1;
+    for (size_t i = 0; i < N; i++) {
+        arena.recepcao()->at(0) = static_cast<byte_t>(i);
+        respostas.push_back(arena.retem());
+    }
+    CHECK(arena.emUso() == N);
+    CHECK(arena.maximoEmUso() == N);
+    CHECK(arena.blocos() == 3 * ArenaRespostas::BLOCOS_POR_LOTE);
+    for (size_t i = 0; i < N; i++)
+        CHECK(respostas[i]->at(0) == static_cast<byte_t>(i));
+
+    respostas.clear();
+    CHECK(arena.emUso() == 0);
+    arena.zeraMaximo();
+    CHECK(arena.maximoEmUso() == 0);
+    for (size_t i = 0; i < N; i++) {
+        arena.recepcao();
+        respostas.push_back(arena.retem());
+    }
+    CHECK(arena.blocos() == 3 * ArenaRespostas::BLOCOS_POR_LOTE);
+    CHECK(arena.maximoEmUso() == N);
+    CHECK(arena.bytes() >= arena.blocos() * RESPOSTA_SZ);
+}
+
+TEST_CASE("ArenaRespostas: respostas recebidas no bloco pelo protocolo") {
+    ArenaRespostas arena;
+    ProtocoloLeitor protocolo;
+    const ProtocoloLeitor::instante_t t = ProtocoloLeitor::instante_t();
+    protocolo.recebeEm(arena.recepcao());
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x26;
+    protocolo.setComando(cmd, t);
+    const byte_t enqs[] = {ENQ, ENQ};
+    protocolo.recebe(enqs, 2, t);
+    REQUIRE(protocolo.estado() == ProtocoloLeitor::ComandoTransmitido);
+
+    // duas respostas, a segunda em duas partes: a troca do bloco no meio do
+    // bloco de dados preserva os bytes já recebidos
+    resposta_t rsp;
+    rsp.fill(0x00);
+    rsp.at(0) = 0x26;
+    rsp.at(6) = 1;
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+    ProtocoloLeitor::resultado_t r = protocolo.recebe(rsp.data(), rsp.size(), t);
+    REQUIRE((r.eventos & ProtocoloLeitor::EventoResposta));
+    CHECK(&protocolo.resposta() == arena.recepcao());
+    ArenaRespostas::Resposta primeira = arena.retem();
+    protocolo.recebeEm(arena.recepcao());
+
+    rsp.at(5) = 0x10; // última
+    rsp.at(6) = 2;
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+    protocolo.recebe(rsp.data(), 100, t);
+    CHECK(protocolo.estado() == ProtocoloLeitor::CodigoRecebido);
+    resposta_t outro;
+    outro.fill(0xFF);
+    protocolo.recebeEm(&outro);
+    r = protocolo.recebe(rsp.data() + 100, rsp.size() - 100, t);
+    REQUIRE((r.eventos & ProtocoloLeitor::EventoResposta));
+    CHECK(protocolo.status() == ProtocoloLeitor::Sucesso);
+    CHECK(&protocolo.resposta() == &outro);
+    CHECK(outro == rsp);
+
+    CHECK(primeira->at(6) == 1);
+    CHECK(arena.maximoEmUso() == 2);
+}
+
+TEST_CASE("ArenaRespostas: porta lê diretamente no bloco") {
+    ArenaRespostas arena;
+    ProtocoloLeitor protocolo;
+    const ProtocoloLeitor::instante_t t = ProtocoloLeitor::instante_t();
+    protocolo.recebeEm(arena.recepcao());
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+    protocolo.setComando(cmd, t);
+    const byte_t enqs[] = {ENQ, ENQ};
+    protocolo.recebe(enqs, 2, t);
+    size_t sz;
+    CHECK(protocolo.posicaoResposta(sz) == nullptr);
+    CHECK(sz == 0);
+
+    resposta_t rsp;
+    rsp.fill(0x33);
+    rsp.at(0) = 0x14;
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+
+    // o código do comando inicia o bloco de dados; o restante é escrito em
+    // partes na posição informada, como por rx()
+    protocolo.recebe(rsp.data(), 1, t);
+    size_t lidos = 1;
+    ProtocoloLeitor::resultado_t r = {0, 0};
+    while (lidos < rsp.size()) {
+        byte_t* destino = protocolo.posicaoResposta(sz);
+        REQUIRE(destino == arena.recepcao()->data() + lidos);
+        REQUIRE(sz == rsp.size() - lidos);
+        const size_t n = sz < 100 ? sz : 100;
+        memcpy(destino, rsp.data() + lidos, n);
+        r = protocolo.recebidos(n, t);
+        CHECK(r.consumidos == n);
+        lidos += n;
+    }
+    CHECK((r.eventos & ProtocoloLeitor::EventoResposta));
+    CHECK(protocolo.status() == ProtocoloLeitor::Sucesso);
+    CHECK(*arena.recepcao() == rsp);
+}
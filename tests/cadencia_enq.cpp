@@ -0,0 +1,78 @@
+#include "doctest/doctest.h"
+#include <NBR14522.h>
+#include <cadencia_enq.h>
+#include <chrono>
+
+using namespace NBR14522;
+
+using ms = std::chrono::milliseconds;
+
+TEST_CASE("CadenciaEnq: período e jitter dos ENQs") {
+    CadenciaEnq cadencia;
+    CadenciaEnq::instante_t t = CadenciaEnq::instante_t() + ms(1000);
+    CadenciaEnq::instante_t previsto;
+
+    // sem amostras, não há previsão
+    cadencia.registra(t);
+    CHECK(cadencia.amostras() == 0);
+    CHECK_FALSE(cadencia.proximoEnq(previsto));
+
+    // primeira amostra: jitter de metade do período
+    t += ms(100);
+    cadencia.registra(t);
+    CHECK(cadencia.amostras() == 1);
+    CHECK(cadencia.periodo() == ms(100));
+    CHECK(cadencia.jitter() == ms(50));
+    REQUIRE(cadencia.proximoEnq(previsto));
+    CHECK(previsto == t + ms(100) - 2 * ms(50));
+
+    // ENQs a cada 100 ms +/- 4 ms: o jitter converge para o desvio
+    for (int i = 0; i < 64; i++) {
+        t += ms(i % 2 ? 96 : 104);
+        cadencia.registra(t);
+    }
+    CHECK(cadencia.amostras() == 65);
+    CHECK(cadencia.periodo() > ms(98));
+    CHECK(cadencia.periodo() < ms(102));
+    CHECK(cadencia.jitter() > ms(2));
+    CHECK(cadencia.jitter() < ms(8));
+    REQUIRE(cadencia.proximoEnq(previsto));
+    CHECK(previsto > t + ms(80));
+    CHECK(previsto < t + ms(100));
+}
+
+TEST_CASE("CadenciaEnq: intervalos que não são amostras") {
+    CadenciaEnq cadencia;
+    CadenciaEnq::instante_t t = CadenciaEnq::instante_t();
+    cadencia.registra(t);
+    t += ms(200);
+    cadencia.registra(t);
+    REQUIRE(cadencia.amostras() == 1);
+
+    // ENQs lidos no mesmo bloco, ou perdidos (intervalo acima de TMAXENQ)
+    cadencia.registra(t);
+    cadencia.registra(t + ms(TMINENQ_MSEC - 1));
+    t += ms(TMINENQ_MSEC - 1 + TMAXENQ_MSEC + 1);
+    cadencia.registra(t);
+    CHECK(cadencia.amostras() == 1);
+    CHECK(cadencia.periodo() == ms(200));
+
+    // o intervalo entre o fim de uma troca e o ENQ seguinte não é amostra
+    cadencia.reinicia(t + ms(50));
+    CadenciaEnq::instante_t previsto;
+    REQUIRE(cadencia.proximoEnq(previsto));
+    CHECK(previsto == t + ms(50) + ms(200) - 2 * ms(100));
+    t += ms(50 + 200);
+    cadencia.registra(t);
+    CHECK(cadencia.amostras() == 1);
+    t += ms(200);
+    cadencia.registra(t);
+    CHECK(cadencia.amostras() == 2);
+
+    // sem referência, não há previsão
+    cadencia.invalida();
+    CHECK_FALSE(cadencia.proximoEnq(previsto));
+    cadencia.registra(t + ms(200));
+    CHECK(cadencia.amostras() == 2);
+    CHECK(cadencia.proximoEnq(previsto));
+}
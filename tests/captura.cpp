@@ -0,0 +1,203 @@
+#include "doctest/doctest.h"
+#include "serial_policy_dummy.h"
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <leitor_fsm.h>
+#include <memory>
+#include <serial/captura.h>
+#include <serial/serial_policy_replay.h>
+#include <thread>
+#include <timer/timer_policy_generic_os.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace NBR14522;
+
+using Gravador = SerialPolicyGravador<SerialPolicyDummy>;
+
+// grava uma sessão de comando composto (0x26) com duas respostas
+static void gravaSessao(const char* caminho,
+                        std::vector<resposta_t>& respostas) {
+    sptr<SerialPolicyDummy> medidor = std::make_shared<SerialPolicyDummy>();
+    sptr<Gravador> porta = std::make_shared<Gravador>(medidor);
+    REQUIRE(porta->trace().abre(caminho));
+
+    LeitorFSM<TimerPolicyWinUnix, Gravador> leitor(porta);
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x26;
+
+    // o medidor já transmitia ENQs antes do comando: setComando() descarta
+    medidor->toLeitor.write(ENQ);
+    leitor.setComando(cmd);
+
+    medidor->toLeitor.write(ENQ);
+    leitor.processaEstado();
+    medidor->toLeitor.write(ENQ);
+    leitor.processaEstado();
+    REQUIRE(medidor->toMedidor.toread() == COMANDO_SZ);
+    while (medidor->toMedidor.toread())
+        medidor->toMedidor.read();
+
+    for (size_t i = 0; i < 2; i++) {
+        resposta_t rsp;
+        rsp.fill(static_cast<byte_t>(i));
+        rsp.at(0) = 0x26;
+        rsp.at(5) = i == 1 ? 0x10 : 0x00; // última resposta
+        setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+        respostas.push_back(rsp);
+
+        for (auto b : rsp)
+            medidor->toLeitor.write(b);
+        leitor.processaEstado(); // código
+        leitor.processaEstado(); // restante da resposta
+        REQUIRE(medidor->toMedidor.read() == ACK);
+    }
+
+    REQUIRE(leitor.status() ==
+            LeitorFSM<TimerPolicyWinUnix, Gravador>::status_t::Sucesso);
+    porta->trace().fecha();
+}
+
+// arquivo temporário único, removido na destruição (também se um REQUIRE
+// interromper o teste)
+class ArquivoTemporario {
+  public:
+    ArquivoTemporario() {
+        const int fd = mkstemp(_caminho);
+        if (fd >= 0)
+            close(fd);
+        else
+            _caminho[0] = '\0';
+    }
+    ~ArquivoTemporario() {
+        if (ok())
+            remove(_caminho);
+    }
+
+    bool ok() const { return _caminho[0] != '\0'; }
+    const char* caminho() const { return _caminho; }
+
+  private:
+    char _caminho[32] = "/tmp/captura_teste_XXXXXX";
+};
+
+TEST_CASE("Gravação e reprodução de sessão") {
+    ArquivoTemporario arquivo;
+    REQUIRE(arquivo.ok());
+
+    std::vector<resposta_t> respostasGravadas;
+    gravaSessao(arquivo.caminho(), respostasGravadas);
+
+    auto captura = std::make_shared<Captura>();
+    REQUIRE(captura->carrega(arquivo.caminho()));
+
+    // ENQ descartado, ENQ, ENQ, comando, (código, resposta, ACK) x 2
+    REQUIRE(captura->registros().size() == 10);
+    CHECK(captura->registros()[0].direcao == TRACE_RX);
+    CHECK(captura->registros()[3].direcao == TRACE_TX);
+    CHECK(captura->registros()[3].tamanho == COMANDO_SZ);
+
+    using Leitor = LeitorFSM<TimerPolicyWinUnix, SerialPolicyReplay>;
+
+    sptr<SerialPolicyReplay> replay = std::make_shared<SerialPolicyReplay>(
+        captura, SerialPolicyReplay::TEMPO_ACELERADO);
+
+    // a sessão reproduzida pode ser executada várias vezes
+    for (int execucao = 0; execucao < 3; execucao++) {
+        replay->reinicia();
+        Leitor leitor(replay);
+
+        std::vector<resposta_t> respostas;
+        leitor.setCallback(
+            [&](const resposta_t& rsp) { respostas.push_back(rsp); });
+
+        comando_t cmd;
+        cmd.fill(0x00);
+        cmd.at(0) = 0x26;
+        leitor.setComando(cmd);
+
+        for (int i = 0; i < 100 && leitor.processaEstado() !=
+                                       Leitor::estado_t::AguardaNovoComando;
+             i++)
+            ;
+
+        CHECK(leitor.status() == Leitor::status_t::Sucesso);
+        CHECK(respostas == respostasGravadas);
+        CHECK(replay->terminou());
+        CHECK(replay->divergencias() == 0);
+    }
+
+    SUBCASE("comando diferente do gravado") {
+        replay->reinicia();
+        Leitor leitor(replay);
+
+        comando_t cmd;
+        cmd.fill(0x00);
+        cmd.at(0) = 0x27;
+        leitor.setComando(cmd);
+        for (int i = 0; i < 10; i++)
+            leitor.processaEstado();
+
+        CHECK(replay->divergencias() > 0);
+    }
+}
+
+TEST_CASE("Reprodução em tempo real") {
+    using namespace std::chrono;
+
+    auto captura = std::make_shared<Captura>();
+    const uint8_t enq = ENQ;
+    captura->adiciona(TRACE_RX, 1000000000, &enq, 1);
+    captura->adiciona(TRACE_RX, 1040000000, &enq, 1); // 40 ms depois
+
+    SerialPolicyReplay replay(captura, SerialPolicyReplay::TEMPO_REAL);
+    uint8_t byte;
+
+    // o primeiro registro é a âncora de tempo: liberado imediatamente
+    CHECK(replay.rx(&byte, 1) == 1);
+    CHECK(replay.rx(&byte, 1) == 0); // fim do registro
+
+    auto inicio = steady_clock::now();
+    while (!replay.rx(&byte, 1) && steady_clock::now() - inicio < seconds(1))
+        std::this_thread::sleep_for(milliseconds(1));
+
+    CHECK(steady_clock::now() - inicio >= milliseconds(35));
+    CHECK(byte == ENQ);
+    CHECK(replay.terminou());
+}
+
+TEST_CASE("Captura: registros maiores que o cabeçalho admite") {
+    std::vector<uint8_t> bloco(CAPTURA_REGISTRO_MAX_SZ + 100);
+    for (size_t i = 0; i < bloco.size(); i++)
+        bloco[i] = static_cast<uint8_t>(i);
+
+    Captura captura;
+    captura.adiciona(TRACE_RX, 1000, bloco.data(), bloco.size());
+    REQUIRE(captura.registros().size() == 2);
+    CHECK(captura.registros()[0].tamanho == CAPTURA_REGISTRO_MAX_SZ);
+    CHECK(captura.registros()[1].tamanho == 100);
+
+    // o arquivo gravado é lido de volta com os mesmos bytes
+    FILE* arquivo = tmpfile();
+    REQUIRE(arquivo);
+    REQUIRE(captura.salva(arquivo));
+    rewind(arquivo);
+    Captura lida;
+    REQUIRE(lida.carrega(arquivo));
+    fclose(arquivo);
+
+    REQUIRE(lida.registros().size() == 2);
+    std::vector<uint8_t> dados;
+    for (const auto& registro : lida.registros()) {
+        CHECK(registro.direcao == TRACE_RX);
+        CHECK(registro.timestamp_ns == 1000);
+        dados.insert(dados.end(), lida.dados(registro),
+                     lida.dados(registro) + registro.tamanho);
+    }
+    CHECK(dados == bloco);
+}
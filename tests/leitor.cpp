@@ -1,53 +1,57 @@
 #include "doctest/doctest.h"
+#include "serial_policy_dummy.h"
+#include <algorithm>
 #include <CRC.h>
 #include <NBR14522.h>
 #include <leitor_fsm.h>
 #include <memory>
 #include <ring_buffer.h>
-#include <timer/timer_policy_generic_os.h>
+#include <timer/timer_policy_virtual.h>
+#include <vector>
 
 using namespace NBR14522;
 
-static void waitFor(unsigned int milliseconds) {
-    TimerPolicyWinUnix timer;
-    timer.setTimeout(milliseconds);
-    while (!timer.timedOut())
-        ;
+// os timeouts do protocolo correm no relógio virtual: avançá-lo é instantâneo
+static void avanca(unsigned int milliseconds) {
+    VirtualClock::avanca(std::chrono::milliseconds(milliseconds));
 }
 
-// porta serial simulada para testes que permite ler dados do leitor e add
-// dados como se fossemos o medidor
-
-class SerialPolicyDummy {
-  public:
-    RingBuffer<byte_t, 300> toLeitor;
-    RingBuffer<byte_t, 300> toMedidor;
-    SerialPolicyDummy() {
-        // esvazia ring buffers
-        while (this->toMedidor.toread())
-            this->toMedidor.read();
-        while (this->toLeitor.toread())
-            this->toLeitor.read();
+TEST_CASE("Classificação dos bytes") {
+    const byte_t comandos[] = {0x14, 0x20, 0x21, 0x22, 0x51, 0x23, 0x24,
+                               0x41, 0x44, 0x42, 0x43, 0x45, 0x46, 0x25,
+                               0x26, 0x27, 0x52, 0x28, 0x80};
+    size_t validos = 0, compostos = 0;
+    for (unsigned b = 0; b < 256; b++) {
+        const byte_t byte = static_cast<byte_t>(b);
+        validos += isValidCodeCommand(byte);
+        compostos += isComposedCodeCommand(byte);
+        CHECK_FALSE((isComposedCodeCommand(byte) && !isValidCodeCommand(byte)));
     }
-    size_t tx(const byte_t* data, const size_t data_sz) {
-        for (size_t i = 0; i < data_sz; i++)
-            toMedidor.write(data[i]);
-        return data_sz;
-    }
-    size_t rx(byte_t* data, const size_t max_data_sz) {
-        size_t toread = toLeitor.toread();
-        size_t sz = max_data_sz >= toread ? toread : max_data_sz;
-        for (size_t i = 0; i < sz; i++)
-            data[i] = toLeitor.read();
-        return sz;
-    }
-};
+    CHECK(validos == sizeof(comandos));
+    CHECK(compostos == 3);
+    for (byte_t c : comandos)
+        CHECK(isValidCodeCommand(c));
+    CHECK(isComposedCodeCommand(0x26));
+    CHECK(isComposedCodeCommand(0x27));
+    CHECK(isComposedCodeCommand(0x52));
+
+    CHECK(classeByte(ENQ) == ClasseENQ);
+    CHECK(classeByte(ACK) == ClasseACK);
+    CHECK(classeByte(NAK) == ClasseNAK);
+    CHECK(classeByte(WAIT) == ClasseWAIT);
+    CHECK(classeByte(CodigoInformacaoDeComandoNaoImplementado) ==
+          ClasseCodigoDeInformacao);
+    CHECK(classeByte(CodigoInformacaoDeOcorrenciaNoMedidor) ==
+          ClasseCodigoDeInformacao);
+    CHECK(classeByte(0x00) == ClasseOutro);
+    CHECK(classeByte(0xFF) == ClasseOutro);
+}
 
 TEST_CASE("Leitor") {
 
     sptr<SerialPolicyDummy> porta = std::make_shared<SerialPolicyDummy>();
 
-    using Leitor = LeitorFSM<TimerPolicyWinUnix, SerialPolicyDummy>;
+    using Leitor = LeitorFSM<TimerPolicyVirtual, SerialPolicyDummy>;
 
     Leitor leitor(porta);
 
@@ -61,7 +65,7 @@ TEST_CASE("Leitor") {
 
     CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
     CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
-    waitFor(1000);
+    avanca(1000);
     CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
     CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
 
@@ -69,7 +73,9 @@ TEST_CASE("Leitor") {
         porta->toLeitor.write(ENQ);
         CHECK(leitor.processaEstado() == Leitor::estado_t::Sincronizado);
         CHECK(leitor.processaEstado() == Leitor::estado_t::Sincronizado);
-        waitFor(TMAXENQ_MSEC);
+        avanca(TMAXENQ_MSEC - 1);
+        CHECK(leitor.processaEstado() == Leitor::estado_t::Sincronizado);
+        avanca(1);
         CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
         CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
     }
@@ -91,7 +97,11 @@ TEST_CASE("Leitor") {
             CHECK(cmd_transmitido == cmd_recebido_pelo_medidor);
 
             // aguarda timeout TMAXRSP
-            waitFor(TMAXRSP_MSEC);
+            avanca(TMAXRSP_MSEC - 1);
+            CHECK(leitor.processaEstado() ==
+                  Leitor::estado_t::ComandoTransmitido);
+            CHECK(porta->toMedidor.toread() == 0);
+            avanca(1);
 
             // processa e retransmite o comando
             CHECK(leitor.processaEstado() ==
@@ -113,7 +123,7 @@ TEST_CASE("Leitor") {
             cmd_recebido_pelo_medidor.at(j) = porta->toMedidor.read();
         CHECK(cmd_transmitido == cmd_recebido_pelo_medidor);
         // aguarda timeout TMAXRSP
-        waitFor(TMAXRSP_MSEC);
+        avanca(TMAXRSP_MSEC);
 
         // processa e nao retransmite comando, pois excedeu o limite de
         // retransmissões
@@ -145,7 +155,9 @@ TEST_CASE("Leitor") {
             CHECK(leitor.processaEstado() == Leitor::estado_t::CodigoRecebido);
 
             // aguarda timeout TMAXCAR
-            waitFor(TMAXCAR_MSEC);
+            avanca(TMAXCAR_MSEC - 1);
+            CHECK(leitor.processaEstado() == Leitor::estado_t::CodigoRecebido);
+            avanca(1);
 
             // processa e retransmite o comando
             CHECK(leitor.processaEstado() ==
@@ -172,7 +184,7 @@ TEST_CASE("Leitor") {
         CHECK(leitor.processaEstado() == Leitor::estado_t::CodigoRecebido);
 
         // aguarda timeout TMAXCAR
-        waitFor(TMAXCAR_MSEC);
+        avanca(TMAXCAR_MSEC);
 
         // processa e nao retransmite comando, pois excedeu o limite de
         // retransmissões
@@ -499,29 +511,42 @@ TEST_CASE("Leitor") {
     }
 }
 
-class TimerPolicyReduzTempoDeWAIT {
-  public:
-    static const unsigned int TSEMWAIT_REDUZIDO_MSEC;
-    void setTimeout(unsigned int milliseconds) {
-        if (milliseconds == (NBR14522::TSEMWAIT_SEC * 1000))
-            _deadline = clock_type::now() +
-                        std::chrono::milliseconds(TSEMWAIT_REDUZIDO_MSEC);
-        else
-            _deadline =
-                clock_type::now() + std::chrono::milliseconds(milliseconds);
-    }
-    bool timedOut() { return clock_type::now() >= _deadline; }
+TEST_CASE("Próximo deadline do protocolo") {
+    sptr<SerialPolicyDummy> porta = std::make_shared<SerialPolicyDummy>();
 
-  private:
-    moment _deadline;
-};
-const unsigned int TimerPolicyReduzTempoDeWAIT::TSEMWAIT_REDUZIDO_MSEC = 1000;
+    using Leitor = LeitorFSM<TimerPolicyVirtual, SerialPolicyDummy>;
 
-TEST_CASE("Atraso de sequência (WAIT) com timer simulado") {
+    Leitor leitor(porta);
+    VirtualClock::time_point deadline;
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+    leitor.setComando(cmd);
+
+    // aguardando ENQ: não há timeout no estado Dessincronizado
+    CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
+    CHECK(!leitor.proximoDeadline(deadline));
+
+    porta->toLeitor.write(ENQ);
+    CHECK(leitor.processaEstado() == Leitor::estado_t::Sincronizado);
+    REQUIRE(leitor.proximoDeadline(deadline));
+    CHECK(deadline ==
+          VirtualClock::now() + std::chrono::milliseconds(TMAXENQ_MSEC));
+
+    avanca(TMINENQ_MSEC);
+    porta->toLeitor.write(ENQ);
+    CHECK(leitor.processaEstado() == Leitor::estado_t::ComandoTransmitido);
+    REQUIRE(leitor.proximoDeadline(deadline));
+    CHECK(deadline ==
+          VirtualClock::now() + std::chrono::milliseconds(TMAXRSP_MSEC));
+}
+
+TEST_CASE("Atraso de sequência (WAIT)") {
 
     sptr<SerialPolicyDummy> porta = std::make_shared<SerialPolicyDummy>();
 
-    using Leitor = LeitorFSM<TimerPolicyReduzTempoDeWAIT, SerialPolicyDummy>;
+    using Leitor = LeitorFSM<TimerPolicyVirtual, SerialPolicyDummy>;
 
     Leitor leitor(porta);
 
@@ -562,7 +587,10 @@ TEST_CASE("Atraso de sequência (WAIT) com timer simulado") {
     }
 
     SUBCASE("com alarme TSEMWAIT excedido") {
-        waitFor(TimerPolicyReduzTempoDeWAIT::TSEMWAIT_REDUZIDO_MSEC);
+        avanca(TSEMWAIT_SEC * 1000 - 1);
+        CHECK(leitor.processaEstado() ==
+              Leitor::estado_t::AtrasoDeSequenciaRecebido);
+        avanca(1);
         CHECK(leitor.processaEstado() == Leitor::estado_t::AguardaNovoComando);
         CHECK(leitor.status() == leitor.ErroTempoSemWaitEsgotado);
     }
@@ -582,3 +610,92 @@ TEST_CASE("Atraso de sequência (WAIT) com timer simulado") {
         CHECK(leitor.status() == Leitor::status_t::ErroLimiteDeWaitsRecebidos);
     }
 }
+
+// bytes do medidor em uma leitura de comando composto, precedidos de ruído
+static std::vector<byte_t> fluxoComposto(const size_t respostas) {
+    std::vector<byte_t> fluxo = {0x00, 0xFF, 0x37, ACK, ENQ, ENQ};
+    for (size_t i = 0; i < respostas; i++) {
+        resposta_t rsp;
+        rsp.fill(static_cast<byte_t>(i));
+        rsp.at(0) = 0x26;
+        rsp.at(5) = i == respostas - 1 ? 0x10 : 0x00;
+        setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+        fluxo.insert(fluxo.end(), rsp.begin(), rsp.end());
+    }
+    return fluxo;
+}
+
+TEST_CASE("feed()") {
+    using Leitor = LeitorFSM<TimerPolicyVirtual, SerialPolicyDummy>;
+
+    sptr<SerialPolicyDummy> porta = std::make_shared<SerialPolicyDummy>();
+    Leitor leitor(porta);
+    std::vector<resposta_t> respostas;
+    leitor.setCallback(
+        [&](const resposta_t& rsp) { respostas.push_back(rsp); });
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x26;
+    leitor.setComando(cmd);
+
+    SUBCASE("leitura inteira em um bloco") {
+        std::vector<byte_t> fluxo = fluxoComposto(4);
+        // bytes após o fim da leitura não são consumidos
+        fluxo.push_back(ENQ);
+
+        Leitor::feed_t r = leitor.feed(fluxo.data(), fluxo.size());
+        CHECK(r.consumidos == fluxo.size() - 1);
+        CHECK(r.eventos == (Leitor::FeedSincronizou |
+                            Leitor::FeedComandoTransmitido |
+                            Leitor::FeedResposta | Leitor::FeedConcluido));
+        CHECK(leitor.status() == Leitor::status_t::Sucesso);
+        REQUIRE(respostas.size() == 4);
+        CHECK(isLastRespostaOfComposed(respostas[3]));
+
+        // comando e um ACK por resposta
+        CHECK(porta->toMedidor.toread() == COMANDO_SZ + 4);
+    }
+
+    SUBCASE("blocos de qualquer tamanho equivalem a processaEstado()") {
+        const std::vector<byte_t> fluxo = fluxoComposto(3);
+        for (size_t bloco : {1, 2, 3, 7, 64, 257, 258, 1000}) {
+            respostas.clear();
+            leitor.setComando(cmd);
+            while (porta->toMedidor.toread())
+                porta->toMedidor.read();
+
+            size_t i = 0;
+            while (i < fluxo.size()) {
+                size_t n = std::min(bloco, fluxo.size() - i);
+                Leitor::feed_t r = leitor.feed(&fluxo[i], n);
+                CHECK(r.consumidos == n);
+                i += r.consumidos;
+            }
+            CHECK(leitor.status() == Leitor::status_t::Sucesso);
+            CHECK(respostas.size() == 3);
+            CHECK(porta->toMedidor.toread() == COMANDO_SZ + 3);
+        }
+    }
+
+    SUBCASE("timeouts com feed(nullptr, 0)") {
+        const byte_t enq = ENQ;
+        CHECK(leitor.feed(&enq, 1).eventos == Leitor::FeedSincronizou);
+        avanca(TMAXENQ_MSEC - 1);
+        CHECK(leitor.feed(nullptr, 0).eventos == 0);
+        avanca(1);
+        Leitor::feed_t r = leitor.feed(nullptr, 0);
+        CHECK(r.consumidos == 0);
+        CHECK(r.eventos == Leitor::FeedTimeout);
+        CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
+    }
+
+    SUBCASE("quebra de sequência descarta o restante do bloco") {
+        const byte_t fluxo[] = {ENQ, ENQ, 0x77, ENQ, ENQ};
+        Leitor::feed_t r = leitor.feed(fluxo, sizeof(fluxo));
+        CHECK(r.consumidos == sizeof(fluxo));
+        CHECK((r.eventos & Leitor::FeedQuebraDeSequencia));
+        CHECK(leitor.status() == Leitor::status_t::ErroQuebraDeSequencia);
+        CHECK(leitor.processaEstado() == Leitor::estado_t::Dessincronizado);
+    }
+}
@@ -0,0 +1,104 @@
+#include "doctest/doctest.h"
+#include "medidores_pty.h"
+#include "pty.h"
+#include <NBR14522.h>
+#include <leitor_coro.h>
+#include <memory>
+#include <serial/serial_policy_unix.h>
+#include <timer/timer_policy_generic_os.h>
+#include <vector>
+
+using namespace NBR14522;
+
+using Porta = SerialPolicyUnix<>;
+using Leitor = LeitorCoro<TimerPolicyWinUnix, Porta>;
+using FSM = Leitor::FSM;
+
+static comando_t comando(const byte_t codigo) {
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = codigo;
+    return cmd;
+}
+
+typedef struct {
+    size_t respostasCompostas;
+    FSM::status_t statusComposto;
+    Leitor::resultado_t simples;
+    bool terminou;
+} registro_t;
+
+// script de leitura de um medidor: comando composto, resposta a resposta, e
+// em seguida um comando simples
+static Tarefa script(Leitor& leitor, Leitor::sessao_t sessao,
+                     registro_t& registro) {
+    auto leitura = leitor.leitura(sessao, comando(0x26), 2000);
+    while (auto rsp = co_await leitura.proxima()) {
+        CHECK(rsp->at(0) == 0x26);
+        registro.respostasCompostas++;
+    }
+    registro.statusComposto = leitura.status();
+
+    registro.simples = co_await leitor.leitura(sessao, comando(0x14), 2000);
+    registro.terminou = true;
+}
+
+TEST_CASE("LeitorCoro: scripts concorrentes") {
+    const size_t N = 16;
+    MedidoresPty medidores(N);
+
+    Leitor leitor;
+    REQUIRE(leitor.ok());
+
+    std::vector<registro_t> registros(N, registro_t{});
+    for (size_t i = 0; i < N; i++) {
+        REQUIRE(medidores.ptys[i]->ok());
+        auto porta = std::make_shared<Porta>();
+        REQUIRE(porta->openSerial(medidores.ptys[i]->escravo()));
+        Leitor::sessao_t sessao = leitor.adiciona(porta);
+        REQUIRE(sessao != Leitor::Reactor::SESSAO_INVALIDA);
+        leitor.inicia(script(leitor, sessao, registros[i]));
+    }
+    medidores.inicia();
+
+    CHECK(leitor.tarefas() == N);
+    auto limite = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (leitor.processa(100) && std::chrono::steady_clock::now() < limite)
+        ;
+    CHECK(leitor.tarefas() == 0);
+
+    for (size_t i = 0; i < N; i++) {
+        CHECK(registros[i].terminou);
+        CHECK(registros[i].respostasCompostas ==
+              medidores.medidores[i].configuracao().respostasCompostas);
+        CHECK(registros[i].statusComposto == FSM::status_t::Sucesso);
+        CHECK(registros[i].simples.status == FSM::status_t::Sucesso);
+        REQUIRE(registros[i].simples.respostas.size() == 1);
+        CHECK(registros[i].simples.respostas[0].at(0) == 0x14);
+        CHECK(registros[i].simples.respostas[0].at(4) ==
+              static_cast<byte_t>(i));
+    }
+    medidores.para();
+}
+
+static Tarefa leituraSemMedidor(Leitor& leitor, Leitor::sessao_t sessao,
+                                Leitor::resultado_t& resultado) {
+    resultado = co_await leitor.leitura(sessao, comando(0x14), 200);
+}
+
+TEST_CASE("LeitorCoro: timeout da leitura") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+    auto porta = std::make_shared<Porta>();
+    REQUIRE(porta->openSerial(pty.escravo()));
+
+    Leitor leitor;
+    Leitor::sessao_t sessao = leitor.adiciona(porta);
+    Leitor::resultado_t resultado{FSM::status_t::Sucesso, false, {}};
+    leitor.inicia(leituraSemMedidor(leitor, sessao, resultado));
+    leitor.executa();
+
+    CHECK(resultado.excedeuTimeout);
+    CHECK(resultado.status == FSM::status_t::Processando);
+    CHECK(resultado.respostas.empty());
+}
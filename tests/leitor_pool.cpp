@@ -0,0 +1,179 @@
+#include "doctest/doctest.h"
+#include "medidores_pty.h"
+#include "pty.h"
+#include <NBR14522.h>
+#include <atomic>
+#include <leitor_pool.h>
+#include <memory>
+#include <mutex>
+#include <serial/serial_policy_unix.h>
+#include <timer/timer_policy_generic_os.h>
+#include <vector>
+
+using namespace NBR14522;
+
+using Porta = SerialPolicyUnix<>;
+using Pool = LeitorPool<TimerPolicyWinUnix, Porta>;
+
+TEST_CASE("LeitorPool: jobs roubados entre workers") {
+    const size_t N = 6;
+    MedidoresPty medidores(N);
+
+    // uma leitura por worker: os jobs excedentes ficam na fila
+    Pool pool(2, 1, false);
+    for (auto& pty : medidores.ptys) {
+        REQUIRE(pty->ok());
+        auto porta = std::make_shared<Porta>();
+        REQUIRE(porta->openSerial(pty->escravo()));
+        pool.adiciona(porta);
+    }
+    medidores.inicia();
+    pool.inicia();
+
+    comando_t simples, composto;
+    simples.fill(0x00);
+    simples.at(0) = 0x14;
+    composto.fill(0x00);
+    composto.at(0) = 0x26;
+
+    // somente as portas pares, todas no shard do worker 0, com dois jobs
+    // por porta
+    std::mutex mutex;
+    std::vector<Pool::resultado_t> resultados;
+    std::vector<std::atomic<int>> respostas(N);
+    std::vector<std::atomic<int>> emExecucao(N);
+    std::atomic<bool> concorrentes{false};
+    size_t jobs = 0;
+    for (int repeticao = 0; repeticao < 2; repeticao++) {
+        for (size_t porta = 0; porta < N; porta += 2) {
+            Pool::job_t job;
+            job.porta = porta;
+            job.comandos = {simples, composto};
+            job.timeout_resposta_ms = 2000;
+            job.resposta = [&, porta](size_t, const resposta_t& rsp) {
+                if (emExecucao[porta]++)
+                    concorrentes = true;
+                CHECK(rsp.at(4) == static_cast<byte_t>(porta));
+                respostas[porta]++;
+                emExecucao[porta]--;
+            };
+            job.conclusao = [&](const Pool::resultado_t& resultado) {
+                std::lock_guard<std::mutex> trava(mutex);
+                resultados.push_back(resultado);
+            };
+            pool.submete(job);
+            jobs++;
+        }
+    }
+    pool.aguarda();
+
+    REQUIRE(resultados.size() == jobs);
+    for (auto& resultado : resultados) {
+        CHECK(resultado.status == Pool::FSM::status_t::Sucesso);
+        CHECK(resultado.comandosConcluidos == 2);
+    }
+    CHECK_FALSE(concorrentes);
+    const int porJob =
+        1 + static_cast<int>(medidores.medidores[0]
+                                 .configuracao()
+                                 .respostasCompostas);
+    for (size_t porta = 0; porta < N; porta++)
+        CHECK(respostas[porta] == (porta % 2 ? 0 : 2 * porJob));
+
+    auto estatisticas = pool.estatisticas();
+    REQUIRE(estatisticas.size() == 2);
+    CHECK(estatisticas[0].jobs + estatisticas[1].jobs == jobs);
+    CHECK(estatisticas[0].falhas + estatisticas[1].falhas == 0);
+    CHECK(estatisticas[0].comandos + estatisticas[1].comandos == 2 * jobs);
+    // o segundo comando de cada job é transmitido com o sincronismo mantido
+    CHECK(estatisticas[0].transmitidos + estatisticas[1].transmitidos >=
+          2 * jobs);
+    CHECK(estatisticas[0].sincronizados + estatisticas[1].sincronizados >=
+          jobs);
+    // o worker 1 só recebe trabalho roubando
+    CHECK(estatisticas[1].jobs > 0);
+    CHECK(estatisticas[1].roubados == estatisticas[1].jobs);
+
+    pool.encerra();
+    medidores.para();
+}
+
+TEST_CASE("LeitorPool: jobs na fila concluídos ao encerrar") {
+    // sem inicia(): todos os jobs permanecem na fila
+    Pool pool(2, 1, false);
+    const size_t N = 5;
+    for (size_t i = 0; i < N; i++)
+        pool.adiciona(std::make_shared<Porta>());
+
+    comando_t simples;
+    simples.fill(0x00);
+    simples.at(0) = 0x14;
+    std::vector<Pool::resultado_t> resultados;
+    for (size_t porta = 0; porta < N; porta++) {
+        Pool::job_t job;
+        job.porta = porta;
+        job.comandos = {simples};
+        job.timeout_resposta_ms = 2000;
+        job.conclusao = [&](const Pool::resultado_t& resultado) {
+            resultados.push_back(resultado);
+        };
+        pool.submete(std::move(job));
+    }
+
+    pool.encerra();
+    // não bloqueia: os jobs descartados não estão mais pendentes
+    pool.aguarda();
+
+    REQUIRE(resultados.size() == N);
+    std::vector<bool> concluidas(N, false);
+    for (const Pool::resultado_t& resultado : resultados) {
+        CHECK(resultado.status == Pool::FSM::status_t::Processando);
+        CHECK(resultado.comandosConcluidos == 0);
+        CHECK(resultado.worker == resultado.porta % 2);
+        concluidas[resultado.porta] = true;
+    }
+    for (const bool concluida : concluidas)
+        CHECK(concluida);
+}
+
+TEST_CASE("LeitorPool: job concluído se a porta não pode ser aguardada") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+    auto porta = std::make_shared<Porta>();
+    REQUIRE(porta->openSerial(pty.escravo()));
+
+    Pool pool(1, 1, false);
+    pool.adiciona(porta);
+    pool.inicia();
+
+    comando_t simples;
+    simples.fill(0x00);
+    simples.at(0) = 0x14;
+    std::vector<Pool::resultado_t> resultados;
+    auto submete = [&]() {
+        Pool::job_t job;
+        job.porta = 0;
+        job.comandos = {simples};
+        job.timeout_resposta_ms = 50;
+        job.conclusao = [&](const Pool::resultado_t& resultado) {
+            resultados.push_back(resultado);
+        };
+        pool.submete(std::move(job));
+        pool.aguarda();
+    };
+
+    // primeiro job, sem medidor: cria a sessão e excede o timeout
+    submete();
+    REQUIRE(resultados.size() == 1);
+    CHECK(resultados[0].excedeuTimeout);
+
+    // porta fechada: a leitura não pode ser iniciada, e aguarda() não
+    // bloqueia
+    porta->closeSerial();
+    submete();
+    REQUIRE(resultados.size() == 2);
+    CHECK(resultados[1].status == Pool::FSM::status_t::Processando);
+    CHECK(resultados[1].comandosConcluidos == 0);
+    CHECK_FALSE(resultados[1].excedeuTimeout);
+    pool.encerra();
+}
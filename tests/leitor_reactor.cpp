@@ -0,0 +1,208 @@
+#include "doctest/doctest.h"
+#include "medidores_pty.h"
+#include "pty.h"
+#include <NBR14522.h>
+#include <chrono>
+#include <leitor_reactor.h>
+#include <memory>
+#include <serial/serial_policy_unix.h>
+#include <timer/roda_timers.h>
+#include <timer/timer_policy_generic_os.h>
+#include <vector>
+
+using namespace NBR14522;
+
+using Porta = SerialPolicyUnix<>;
+using Reactor = LeitorReactor<TimerPolicyWinUnix, Porta>;
+
+TEST_CASE("LeitorReactor: leituras simultâneas") {
+    const size_t N = 16;
+    MedidoresPty medidores(N);
+
+    Reactor reactor;
+    REQUIRE(reactor.ok());
+
+    std::vector<Reactor::sessao_t> sessoes;
+    for (auto& pty : medidores.ptys) {
+        REQUIRE(pty->ok());
+        auto porta = std::make_shared<Porta>();
+        REQUIRE(porta->openSerial(pty->escravo()));
+        sessoes.push_back(reactor.adiciona(porta));
+        REQUIRE(sessoes.back() != Reactor::SESSAO_INVALIDA);
+    }
+    medidores.inicia();
+
+    // duas leituras seguidas em cada sessão: composta e simples
+    for (byte_t codigo : {byte_t(0x26), byte_t(0x14)}) {
+        comando_t cmd;
+        cmd.fill(0x00);
+        cmd.at(0) = codigo;
+
+        std::vector<size_t> respostas(N, 0);
+        for (size_t i = 0; i < N; i++) {
+            CHECK(reactor.leitura(
+                sessoes[i], cmd,
+                [&respostas, i](const resposta_t& rsp) {
+                    CHECK(rsp.at(4) == static_cast<byte_t>(i));
+                    respostas[i]++;
+                },
+                2000));
+        }
+        // somente uma leitura por vez em cada sessão
+        CHECK_FALSE(reactor.leitura(sessoes[0], cmd, nullptr));
+        CHECK(reactor.ativas() == N);
+
+        std::vector<Reactor::conclusao_t> conclusoes;
+        auto limite =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (reactor.ativas() && std::chrono::steady_clock::now() < limite) {
+            reactor.processa(100);
+            Reactor::conclusao_t conclusao;
+            while (reactor.proximaConclusao(conclusao))
+                conclusoes.push_back(conclusao);
+        }
+
+        REQUIRE(conclusoes.size() == N);
+        for (auto& conclusao : conclusoes) {
+            CHECK(conclusao.status == Reactor::FSM::status_t::Sucesso);
+            CHECK_FALSE(conclusao.excedeuTimeout);
+            CHECK(respostas[conclusao.sessao] ==
+                  (codigo == 0x26 ? medidores.medidores[0]
+                                        .configuracao()
+                                        .respostasCompostas
+                                  : 1));
+        }
+    }
+
+    // o reactor dorme entre os eventos: bem menos esperas do que bytes
+    CHECK(reactor.estatisticas().esperas <
+          reactor.estatisticas().processamentos);
+    medidores.para();
+}
+
+TEST_CASE("LeitorReactor: timeout da leitura") {
+    // porta sem medidor: o LeitorFSM não sai de Dessincronizado
+    ParPty pty;
+    REQUIRE(pty.ok());
+    auto porta = std::make_shared<Porta>();
+    REQUIRE(porta->openSerial(pty.escravo()));
+
+    Reactor reactor;
+    Reactor::sessao_t sessao = reactor.adiciona(porta);
+    REQUIRE(sessao != Reactor::SESSAO_INVALIDA);
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+    auto inicio = std::chrono::steady_clock::now();
+    REQUIRE(reactor.leitura(sessao, cmd, nullptr, 200));
+
+    while (reactor.ativas())
+        reactor.processa(-1);
+    auto duracao = std::chrono::steady_clock::now() - inicio;
+
+    Reactor::conclusao_t conclusao;
+    REQUIRE(reactor.proximaConclusao(conclusao));
+    CHECK(conclusao.sessao == sessao);
+    CHECK(conclusao.excedeuTimeout);
+    CHECK(duracao >= std::chrono::milliseconds(200));
+    // acorda somente no timer, sem espera ativa
+    CHECK(reactor.estatisticas().esperas <= 3);
+    CHECK_FALSE(reactor.proximaConclusao(conclusao));
+
+    // sessão removida: não é mais processada
+    reactor.remove(sessao);
+    CHECK_FALSE(reactor.leitura(sessao, cmd, nullptr));
+}
+
+TEST_CASE("LeitorReactor: porta desconectada") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+    auto porta = std::make_shared<Porta>();
+    REQUIRE(porta->openSerial(pty.escravo()));
+
+    Reactor reactor;
+    Reactor::sessao_t sessao = reactor.adiciona(porta);
+    REQUIRE(sessao != Reactor::SESSAO_INVALIDA);
+    pty.fechaMestre();
+
+    // sem leitura, a porta fechada não acorda o reactor
+    reactor.processa(100);
+    CHECK(reactor.estatisticas().esperas == 1);
+    CHECK(reactor.estatisticas().eventos == 0);
+
+    // e uma leitura sem timeout é concluída de imediato, sem espera ativa
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+    REQUIRE(reactor.leitura(sessao, cmd, nullptr));
+    reactor.zeraEstatisticas();
+    auto limite = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (reactor.ativas() && std::chrono::steady_clock::now() < limite)
+        reactor.processa(100);
+    CHECK(reactor.ativas() == 0);
+    CHECK(reactor.estatisticas().esperas <= 2);
+
+    Reactor::conclusao_t conclusao;
+    REQUIRE(reactor.proximaConclusao(conclusao));
+    CHECK(conclusao.sessao == sessao);
+    CHECK(conclusao.portaFechada);
+    CHECK_FALSE(conclusao.excedeuTimeout);
+    CHECK(conclusao.status != Reactor::FSM::status_t::Sucesso);
+}
+
+TEST_CASE("LeitorReactor: roda de timers") {
+    using ReactorRoda = LeitorReactor<TimerPolicyRoda, Porta>;
+    const size_t N = 8;
+    MedidoresPty medidores(N);
+
+    ReactorRoda reactor;
+    REQUIRE(reactor.ok());
+    std::vector<ReactorRoda::sessao_t> sessoes;
+    for (auto& pty : medidores.ptys) {
+        REQUIRE(pty->ok());
+        auto porta = std::make_shared<Porta>();
+        REQUIRE(porta->openSerial(pty->escravo()));
+        sessoes.push_back(reactor.adiciona(porta));
+    }
+    // e uma porta sem medidor
+    ParPty pty;
+    REQUIRE(pty.ok());
+    auto semMedidor = std::make_shared<Porta>();
+    REQUIRE(semMedidor->openSerial(pty.escravo()));
+    const ReactorRoda::sessao_t sessaoSemMedidor = reactor.adiciona(semMedidor);
+    medidores.inicia();
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x26;
+    for (auto sessao : sessoes)
+        CHECK(reactor.leitura(sessao, cmd, nullptr, 2000));
+    auto inicio = std::chrono::steady_clock::now();
+    CHECK(reactor.leitura(sessaoSemMedidor, cmd, nullptr, 200));
+
+    std::vector<ReactorRoda::conclusao_t> conclusoes;
+    auto limite = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (reactor.ativas() && std::chrono::steady_clock::now() < limite) {
+        reactor.processa(-1);
+        ReactorRoda::conclusao_t conclusao;
+        while (reactor.proximaConclusao(conclusao)) {
+            if (conclusao.sessao == sessaoSemMedidor)
+                CHECK(std::chrono::steady_clock::now() - inicio >=
+                      std::chrono::milliseconds(200));
+            conclusoes.push_back(conclusao);
+        }
+    }
+
+    REQUIRE(conclusoes.size() == N + 1);
+    for (auto& conclusao : conclusoes) {
+        if (conclusao.sessao == sessaoSemMedidor) {
+            CHECK(conclusao.excedeuTimeout);
+        } else {
+            CHECK(conclusao.status == ReactorRoda::FSM::status_t::Sucesso);
+            CHECK_FALSE(conclusao.excedeuTimeout);
+        }
+    }
+    CHECK(reactor.estatisticas().timeouts > 0);
+    medidores.para();
+}
@@ -0,0 +1,189 @@
+#include "doctest/doctest.h"
+#include <NBR14522.h>
+#include <leitor_fsm.h>
+#include <medidor_simulado.h>
+#include <timer/timer_policy_virtual.h>
+#include <vector>
+
+using namespace NBR14522;
+
+// instante do relógio virtual no relógio do medidor simulado
+static MedidorSimulado::instante_t agora() {
+    return MedidorSimulado::instante_t(
+        std::chrono::duration_cast<MedidorSimulado::clock::duration>(
+            VirtualClock::now().time_since_epoch()));
+}
+
+// liga o leitor diretamente ao medidor simulado, sem cadência de baudrate
+class SerialPolicyMedidorSimulado {
+  public:
+    MedidorSimulado medidor;
+
+    SerialPolicyMedidorSimulado(const MedidorSimulado::configuracao_t& cfg)
+        : medidor(cfg) {}
+
+    size_t tx(const byte_t* data, const size_t data_sz) {
+        medidor.recebe(data, data_sz, agora());
+        return data_sz;
+    }
+    size_t rx(byte_t* data, const size_t max_data_sz) {
+        return medidor.transmite(data, max_data_sz, agora());
+    }
+};
+
+using Leitor = LeitorFSM<TimerPolicyVirtual, SerialPolicyMedidorSimulado>;
+
+static Leitor::status_t leitura(Leitor& leitor, const byte_t codigo,
+                                std::vector<resposta_t>& respostas) {
+    leitor.setCallback(
+        [&](const resposta_t& rsp) { respostas.push_back(rsp); });
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = codigo;
+    leitor.setComando(cmd);
+
+    // um byte por processaEstado() e 1 ms virtual entre chamadas, como a
+    // 9600 bps; o limite só é atingido se o leitor travar
+    const auto limite = VirtualClock::now() + std::chrono::minutes(10);
+    while (leitor.processaEstado() != Leitor::estado_t::AguardaNovoComando) {
+        VirtualClock::avanca(std::chrono::milliseconds(1));
+        if (VirtualClock::now() > limite)
+            FAIL("leitura não terminou");
+    }
+    return leitor.status();
+}
+
+static Leitor::status_t leitura(sptr<SerialPolicyMedidorSimulado> porta,
+                                const byte_t codigo,
+                                std::vector<resposta_t>& respostas) {
+    Leitor leitor(porta);
+    return leitura(leitor, codigo, respostas);
+}
+
+static MedidorSimulado::configuracao_t configuracaoTeste() {
+    MedidorSimulado::configuracao_t cfg = MedidorSimulado::configuracaoPadrao();
+    cfg.periodoEnq_ms = TMINENQ_MSEC + 10;
+    return cfg;
+}
+
+TEST_CASE("MedidorSimulado") {
+    MedidorSimulado::configuracao_t cfg = configuracaoTeste();
+
+    SUBCASE("comando simples") {
+        auto porta = std::make_shared<SerialPolicyMedidorSimulado>(cfg);
+        std::vector<resposta_t> respostas;
+
+        CHECK(leitura(porta, 0x14, respostas) == Leitor::status_t::Sucesso);
+        REQUIRE(respostas.size() == 1);
+        CHECK(respostas[0].at(0) == 0x14);
+        CHECK(getNumSerieMedidor(respostas[0]) == cfg.numSerie);
+        CHECK(porta->medidor.estatisticas().acksRecebidos == 1);
+    }
+
+    SUBCASE("comando composto") {
+        cfg.respostasCompostas = 4;
+        auto porta = std::make_shared<SerialPolicyMedidorSimulado>(cfg);
+        std::vector<resposta_t> respostas;
+
+        CHECK(leitura(porta, 0x26, respostas) == Leitor::status_t::Sucesso);
+        REQUIRE(respostas.size() == 4);
+        for (size_t i = 0; i < respostas.size(); i++)
+            CHECK(isLastRespostaOfComposed(respostas[i]) == (i == 3));
+    }
+
+    SUBCASE("comando não implementado") {
+        auto porta = std::make_shared<SerialPolicyMedidorSimulado>(cfg);
+        std::vector<resposta_t> respostas;
+
+        CHECK(leitura(porta, 0x99, respostas) ==
+              Leitor::status_t::ExcecaoComandoNaoImplementado);
+        REQUIRE(respostas.size() == 1);
+        CHECK(respostas[0].at(0) == CodigoInformacaoDeComandoNaoImplementado);
+    }
+
+    SUBCASE("WAIT, NAK e ruído") {
+        cfg.permilWait = 300;
+        cfg.permilNak = 200;
+        cfg.permilRuido = 200;
+        cfg.respostasCompostas = 5;
+        auto porta = std::make_shared<SerialPolicyMedidorSimulado>(cfg);
+
+        size_t sucessos = 0;
+        for (int i = 0; i < 10; i++) {
+            std::vector<resposta_t> respostas;
+            if (leitura(porta, 0x26, respostas) == Leitor::status_t::Sucesso)
+                sucessos++;
+        }
+
+        // os limites de retransmissão da norma absorvem os erros
+        CHECK(sucessos == 10);
+        const auto& estatisticas = porta->medidor.estatisticas();
+        CHECK(estatisticas.waits > 0);
+        CHECK(estatisticas.naksTransmitidos > 0);
+        CHECK(estatisticas.respostasCorrompidas > 0);
+        CHECK(estatisticas.naksRecebidos == estatisticas.respostasCorrompidas);
+    }
+}
+
+TEST_CASE("MedidorSimulado: erros aleatórios no relógio virtual") {
+    // muitas sementes: WAIT, NAK e ruído em todas as posições da sequência,
+    // incluindo os esgotamentos de timeout e limites de retransmissão
+    size_t leituras = 0, sucessos = 0;
+    for (uint32_t semente = 1; semente <= 200; semente++) {
+        MedidorSimulado::configuracao_t cfg = configuracaoTeste();
+        cfg.permilWait = 150;
+        cfg.permilNak = 150;
+        cfg.permilRuido = 300;
+        cfg.respostasCompostas = 3;
+        cfg.semente = semente;
+        auto porta = std::make_shared<SerialPolicyMedidorSimulado>(cfg);
+
+        for (int i = 0; i < 5; i++) {
+            std::vector<resposta_t> respostas;
+            Leitor::status_t status = leitura(porta, 0x26, respostas);
+            leituras++;
+            CHECK(status != Leitor::status_t::Processando);
+            if (status == Leitor::status_t::Sucesso) {
+                sucessos++;
+                REQUIRE(respostas.size() == cfg.respostasCompostas);
+                CHECK(isLastRespostaOfComposed(respostas.back()));
+            }
+        }
+    }
+    CHECK(sucessos > leituras / 2);
+    MESSAGE("leituras: " << leituras << ", sucessos: " << sucessos);
+}
+
+TEST_CASE("MedidorSimulado: sincronismo mantido entre comandos") {
+    MedidorSimulado::configuracao_t cfg = configuracaoTeste();
+    cfg.respostasCompostas = 2;
+    auto porta = std::make_shared<SerialPolicyMedidorSimulado>(cfg);
+    Leitor leitor(porta);
+    const byte_t plano[] = {0x14, 0x26, 0x14, 0x26, 0x14};
+
+    for (const bool sessao : {false, true}) {
+        leitor.setSessao(sessao);
+        leitor.zeraMetricas();
+        for (const byte_t codigo : plano) {
+            std::vector<resposta_t> respostas;
+            REQUIRE(leitura(leitor, codigo, respostas) ==
+                    Leitor::status_t::Sucesso);
+        }
+
+        // a ociosidade é medida no relógio da TimerPolicy (virtual)
+        const ProtocoloLeitor::metricas_t& metricas = leitor.metricas();
+        CHECK(metricas.comandos == 5);
+        if (sessao) {
+            // o primeiro comando após o modo sessão ser ligado aguarda dois
+            // ENQs; os demais, somente o próximo
+            CHECK(metricas.sincronizados == 4);
+            CHECK(leitor.ociosidade() <=
+                  std::chrono::milliseconds(cfg.periodoEnq_ms + 2));
+        } else {
+            CHECK(metricas.sincronizados == 0);
+            CHECK(leitor.ociosidade() >=
+                  std::chrono::milliseconds(2 * cfg.periodoEnq_ms));
+        }
+    }
+}
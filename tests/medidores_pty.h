@@ -0,0 +1,68 @@
+#pragma once
+
+// medidores simulados (ver include/medidor_simulado.h) atrás do lado mestre
+// de ptys, atendidos por uma thread, sem cadência de baudrate. O lado escravo
+// de cada pty é aberto pelo leitor.
+
+#include "pty.h"
+#include <NBR14522.h>
+#include <atomic>
+#include <medidor_simulado.h>
+#include <memory>
+#include <poll.h>
+#include <thread>
+#include <vector>
+
+class MedidoresPty {
+  public:
+    MedidoresPty(const size_t n) {
+        MedidorSimulado::configuracao_t cfg =
+            MedidorSimulado::configuracaoPadrao();
+        cfg.periodoEnq_ms = NBR14522::TMINENQ_MSEC + 10;
+        for (size_t i = 0; i < n; i++) {
+            cfg.numSerie.at(3) = static_cast<byte_t>(i);
+            ptys.emplace_back(new ParPty());
+            medidores.emplace_back(cfg);
+        }
+    }
+
+    ~MedidoresPty() { para(); }
+
+    // inicia após as portas serem abertas pelo leitor
+    void inicia() {
+        _thread = std::thread([this]() { _executa(); });
+    }
+
+    void para() {
+        _encerrar = true;
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    std::vector<std::unique_ptr<ParPty>> ptys;
+    std::vector<MedidorSimulado> medidores;
+
+  private:
+    std::atomic<bool> _encerrar{false};
+    std::thread _thread;
+
+    void _executa() {
+        std::vector<struct pollfd> pfds;
+        for (auto& pty : ptys)
+            pfds.push_back({pty->mestre(), POLLIN, 0});
+
+        while (!_encerrar) {
+            poll(pfds.data(), pfds.size(), 1);
+            auto agora = MedidorSimulado::clock::now();
+            for (size_t i = 0; i < ptys.size(); i++) {
+                byte_t buf[NBR14522::RESPOSTA_SZ];
+                ssize_t n;
+                while ((n = read(pfds[i].fd, buf, sizeof(buf))) > 0)
+                    medidores[i].recebe(buf, static_cast<size_t>(n), agora);
+                size_t sz = medidores[i].transmite(buf, sizeof(buf), agora);
+                if (sz)
+                    ptys[i]->escreve(buf, sz);
+            }
+        }
+    }
+};
@@ -0,0 +1,401 @@
+#include "doctest/doctest.h"
+#include <NBR14522.h>
+#include <chrono>
+#include <medidor_simulado.h>
+#include <protocolo_leitor.h>
+#include <vector>
+
+using namespace NBR14522;
+
+using Protocolo = ProtocoloLeitor;
+using ms = std::chrono::milliseconds;
+
+static comando_t comando(const byte_t codigo) {
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = codigo;
+    return cmd;
+}
+
+static resposta_t resposta(const byte_t codigo) {
+    resposta_t rsp;
+    rsp.fill(0x5A);
+    rsp.at(0) = codigo;
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+    return rsp;
+}
+
+TEST_CASE("ProtocoloLeitor: timeouts pelo instante informado") {
+    Protocolo protocolo;
+    const Protocolo::instante_t t0 = Protocolo::instante_t() + ms(1000);
+    protocolo.setComando(comando(0x14), t0);
+    const byte_t enq = ENQ;
+    Protocolo::instante_t deadline;
+
+    CHECK(protocolo.estado() == Protocolo::Dessincronizado);
+    CHECK_FALSE(protocolo.proximoDeadline(deadline));
+
+    Protocolo::resultado_t r = protocolo.recebe(&enq, 1, t0);
+    CHECK(r.consumidos == 1);
+    CHECK(r.eventos == (Protocolo::EventoSincronizou | Protocolo::EventoTimer));
+    CHECK(protocolo.timeout_ms() == TMAXENQ_MSEC);
+    REQUIRE(protocolo.proximoDeadline(deadline));
+    CHECK(deadline == t0 + ms(TMAXENQ_MSEC));
+
+    // o deadline vence exatamente no instante informado
+    r = protocolo.processa(deadline - ms(1));
+    CHECK(r.eventos == 0);
+    CHECK(protocolo.estado() == Protocolo::Sincronizado);
+    r = protocolo.processa(deadline);
+    CHECK(r.eventos == (Protocolo::EventoTimeout | Protocolo::EventoDescarte));
+    CHECK(protocolo.estado() == Protocolo::Dessincronizado);
+
+    // o timeout tem precedência sobre o ENQ recebido após o deadline
+    const byte_t enqs[] = {ENQ, ENQ};
+    protocolo.recebe(enqs, 1, t0);
+    r = protocolo.recebe(enqs, 2, t0 + ms(TMAXENQ_MSEC));
+    CHECK(r.consumidos == 2);
+    CHECK(r.eventos == (Protocolo::EventoTimeout | Protocolo::EventoDescarte));
+    CHECK(protocolo.estado() == Protocolo::Dessincronizado);
+
+    // sincroniza e transmite o comando no mesmo bloco; o comando é
+    // transmitido sem cópia, com o CRC
+    const Protocolo::instante_t t1 = t0 + ms(5000);
+    r = protocolo.recebe(enqs, 2, t1);
+    CHECK(r.consumidos == 2);
+    CHECK(r.eventos ==
+          (Protocolo::EventoSincronizou | Protocolo::EventoComandoTransmitido |
+           Protocolo::EventoTransmissao | Protocolo::EventoTimer));
+    size_t sz;
+    const byte_t* tx = protocolo.transmissao(sz);
+    REQUIRE(sz == COMANDO_SZ);
+    CHECK(tx[0] == 0x14);
+    CHECK(CRC16(tx, sz) == 0x0000);
+    REQUIRE(protocolo.proximoDeadline(deadline));
+    CHECK(deadline == t1 + ms(TMAXRSP_MSEC));
+
+    // sem resposta: retransmite o comando a cada TMAXRSP, até o limite
+    Protocolo::instante_t t = deadline;
+    for (uint32_t i = 1; i < MAX_COMANDO_SEM_RESPOSTA; i++) {
+        r = protocolo.processa(t);
+        CHECK(r.eventos ==
+              (Protocolo::EventoTimeout | Protocolo::EventoDescarte |
+               Protocolo::EventoComandoTransmitido |
+               Protocolo::EventoTransmissao | Protocolo::EventoTimer));
+        CHECK(protocolo.counterSemResposta() == i);
+        t += ms(TMAXRSP_MSEC);
+    }
+    r = protocolo.processa(t);
+    CHECK((r.eventos & Protocolo::EventoConcluido));
+    CHECK(protocolo.status() ==
+          Protocolo::ErroLimiteDeTransmissoesSemRespostas);
+    CHECK_FALSE(protocolo.proximoDeadline(deadline));
+}
+
+TEST_CASE("ProtocoloLeitor: recebe() e transmissões") {
+    Protocolo protocolo;
+    const Protocolo::instante_t t = Protocolo::instante_t();
+    protocolo.setComando(comando(0x14), t);
+
+    // ruído, sincronismo, comando e resposta no mesmo bloco: recebe()
+    // retorna após cada transmissão
+    std::vector<byte_t> bloco = {0x00, 0x14, ACK, ENQ, 0x37, ENQ};
+    const resposta_t rsp = resposta(0x14);
+    bloco.insert(bloco.end(), rsp.begin(), rsp.end());
+    bloco.push_back(ENQ);
+
+    Protocolo::resultado_t r = protocolo.recebe(bloco.data(), bloco.size(), t);
+    CHECK(r.consumidos == 6);
+    CHECK((r.eventos & Protocolo::EventoTransmissao));
+    CHECK(protocolo.estado() == Protocolo::ComandoTransmitido);
+    CHECK(protocolo.bytesEsperados() == 1);
+
+    // o código do comando inicia o bloco de dados
+    r = protocolo.recebe(&bloco[6], 1, t);
+    CHECK(r.consumidos == 1);
+    CHECK(r.eventos == Protocolo::EventoTimer);
+    CHECK(protocolo.estado() == Protocolo::CodigoRecebido);
+    CHECK(protocolo.bytesEsperados() == RESPOSTA_SZ - 1);
+
+    // bytes após o fim da leitura não são consumidos
+    r = protocolo.recebe(&bloco[7], bloco.size() - 7, t);
+    CHECK(r.consumidos == RESPOSTA_SZ - 1);
+    CHECK(r.eventos == (Protocolo::EventoResposta |
+                        Protocolo::EventoTransmissao | Protocolo::EventoTimer |
+                        Protocolo::EventoConcluido));
+    size_t sz;
+    const byte_t* tx = protocolo.transmissao(sz);
+    REQUIRE(sz == 1);
+    CHECK(tx[0] == ACK);
+    CHECK(protocolo.resposta() == rsp);
+    CHECK(protocolo.status() == Protocolo::Sucesso);
+    CHECK(protocolo.bytesEsperados() == 0);
+
+    SUBCASE("CRC incorreto") {
+        protocolo.setComando(comando(0x14), t);
+        resposta_t corrompida = rsp;
+        corrompida.at(100) ^= 0x01;
+        const byte_t enqs[] = {ENQ, ENQ};
+        protocolo.recebe(enqs, 2, t);
+        r = protocolo.recebe(corrompida.data(), corrompida.size(), t);
+        CHECK(r.consumidos == RESPOSTA_SZ);
+        CHECK(r.eventos ==
+              (Protocolo::EventoNakTransmitido | Protocolo::EventoTransmissao |
+               Protocolo::EventoTimer));
+        tx = protocolo.transmissao(sz);
+        REQUIRE(sz == 1);
+        CHECK(tx[0] == NAK);
+        CHECK(protocolo.estado() == Protocolo::ComandoTransmitido);
+        CHECK(protocolo.counterNakTransmitido() == 1);
+    }
+
+    SUBCASE("quebra de sequência descarta o restante do bloco") {
+        protocolo.setComando(comando(0x14), t);
+        const byte_t fluxo[] = {ENQ, ENQ, ACK, ENQ, ENQ};
+        r = protocolo.recebe(fluxo, 2, t);
+        r = protocolo.recebe(&fluxo[2], 3, t);
+        CHECK(r.consumidos == 3);
+        CHECK(r.eventos == (Protocolo::EventoQuebraDeSequencia |
+                            Protocolo::EventoDescarte));
+        CHECK(protocolo.estado() == Protocolo::Dessincronizado);
+        CHECK(protocolo.status() == Protocolo::ErroQuebraDeSequencia);
+    }
+}
+
+TEST_CASE("ProtocoloLeitor: timer externo com expira()") {
+    Protocolo protocolo;
+    const byte_t enqs[] = {ENQ, ENQ, 0x14};
+
+    // o instante informado é constante: somente expira() vence os timeouts
+    const Protocolo::instante_t t = Protocolo::instante_t();
+    protocolo.setComando(comando(0x14), t);
+    protocolo.recebe(enqs, 2, t);
+    protocolo.recebe(&enqs[2], 1, t);
+    CHECK(protocolo.estado() == Protocolo::CodigoRecebido);
+    CHECK(protocolo.timeout_ms() == TMAXCAR_MSEC);
+    CHECK(protocolo.processa(t).eventos == 0);
+
+    Protocolo::resultado_t r = protocolo.expira();
+    CHECK(r.eventos ==
+          (Protocolo::EventoTimeout | Protocolo::EventoDescarte |
+           Protocolo::EventoComandoTransmitido | Protocolo::EventoTransmissao |
+           Protocolo::EventoTimer));
+    CHECK(protocolo.timeout_ms() == TMAXRSP_MSEC);
+    CHECK(protocolo.estado() == Protocolo::ComandoTransmitido);
+    CHECK(protocolo.counterSemResposta() == 1);
+
+    // WAIT: o próximo timeout é o da norma para a ausência de WAIT
+    const byte_t wait = WAIT;
+    r = protocolo.recebe(&wait, 1, t);
+    CHECK(r.eventos == (Protocolo::EventoSinalizador | Protocolo::EventoTimer));
+    CHECK(protocolo.timeout_ms() == TSEMWAIT_SEC * 1000);
+    r = protocolo.expira();
+    CHECK((r.eventos & Protocolo::EventoConcluido));
+    CHECK(protocolo.status() == Protocolo::ErroTempoSemWaitEsgotado);
+
+    // sem timeout a vencer fora das leituras
+    CHECK(protocolo.expira().eventos == Protocolo::EventoConcluido);
+}
+
+// entrega ao protocolo os bytes transmitidos pelo medidor em agora, e ao
+// medidor as transmissões do protocolo. Retorna as respostas recebidas.
+static size_t troca(Protocolo& protocolo, MedidorSimulado& medidor,
+                    const Protocolo::instante_t agora) {
+    byte_t buf[RESPOSTA_SZ];
+    const size_t n = medidor.transmite(buf, sizeof(buf), agora);
+    size_t consumidos = 0;
+    size_t respostas = 0;
+    do {
+        Protocolo::resultado_t r =
+            n ? protocolo.recebe(buf + consumidos, n - consumidos, agora)
+              : protocolo.processa(agora);
+        consumidos += r.consumidos;
+        if (r.eventos & Protocolo::EventoTransmissao) {
+            size_t sz;
+            const byte_t* tx = protocolo.transmissao(sz);
+            medidor.recebe(tx, sz, agora);
+        }
+        if (r.eventos & Protocolo::EventoResposta)
+            respostas++;
+    } while (consumidos < n &&
+             protocolo.estado() != Protocolo::AguardaNovoComando);
+    return respostas;
+}
+
+// várias sessões em um único laço, sem I/O: cada leitor conversa com o seu
+// medidor simulado, e o tempo avança 1 ms por iteração
+TEST_CASE("ProtocoloLeitor: sessões com medidores simulados") {
+    const size_t N = 32;
+    MedidorSimulado::configuracao_t cfg = MedidorSimulado::configuracaoPadrao();
+    cfg.respostasCompostas = 3;
+
+    Protocolo::instante_t agora = Protocolo::instante_t();
+    std::vector<MedidorSimulado> medidores;
+    std::vector<Protocolo> protocolos(N);
+    std::vector<size_t> respostas(N, 0);
+    for (size_t i = 0; i < N; i++) {
+        cfg.numSerie.at(3) = static_cast<byte_t>(i);
+        // os medidores iniciam fora de fase
+        cfg.periodoEnq_ms = TMINENQ_MSEC + 10 + static_cast<uint32_t>(i);
+        medidores.emplace_back(cfg);
+        protocolos[i].setComando(comando(0x26), agora);
+    }
+
+    const Protocolo::instante_t limite = agora + std::chrono::minutes(1);
+    size_t pendentes = N;
+    while (pendentes && agora < limite) {
+        pendentes = 0;
+        for (size_t i = 0; i < N; i++) {
+            Protocolo& protocolo = protocolos[i];
+            if (protocolo.estado() == Protocolo::AguardaNovoComando)
+                continue;
+            pendentes++;
+            const size_t n = troca(protocolo, medidores[i], agora);
+            if (n)
+                CHECK(protocolo.resposta().at(4) == static_cast<byte_t>(i));
+            respostas[i] += n;
+        }
+        agora += ms(1);
+    }
+
+    CHECK(pendentes == 0);
+    for (size_t i = 0; i < N; i++) {
+        CHECK(protocolos[i].status() == Protocolo::Sucesso);
+        CHECK(respostas[i] == cfg.respostasCompostas);
+        CHECK(medidores[i].estatisticas().acksRecebidos ==
+              cfg.respostasCompostas);
+    }
+}
+
+// executa a leitura do comando, avançando agora 1 ms por troca
+static Protocolo::status_t leitura(Protocolo& protocolo,
+                                   MedidorSimulado& medidor,
+                                   Protocolo::instante_t& agora,
+                                   const byte_t codigo) {
+    protocolo.setComando(comando(codigo), agora);
+    const Protocolo::instante_t limite = agora + std::chrono::minutes(1);
+    while (protocolo.estado() != Protocolo::AguardaNovoComando &&
+           agora < limite) {
+        troca(protocolo, medidor, agora);
+        agora += ms(1);
+    }
+    return protocolo.status();
+}
+
+TEST_CASE("ProtocoloLeitor: sincronismo mantido entre comandos") {
+    MedidorSimulado::configuracao_t cfg = MedidorSimulado::configuracaoPadrao();
+    cfg.periodoEnq_ms = TMINENQ_MSEC + 100;
+    cfg.respostasCompostas = 2;
+    MedidorSimulado medidor(cfg);
+    Protocolo protocolo;
+    Protocolo::instante_t agora = Protocolo::instante_t();
+    const byte_t plano[] = {0x14, 0x26, 0x14, 0x26};
+
+    // sem o modo sessão, cada comando aguarda dois ENQs
+    for (const byte_t codigo : plano)
+        REQUIRE(leitura(protocolo, medidor, agora, codigo) ==
+                Protocolo::Sucesso);
+    const Protocolo::metricas_t semSessao = protocolo.metricas();
+    CHECK(semSessao.comandos == 4);
+    CHECK(semSessao.sincronizados == 0);
+    CHECK(protocolo.ociosidade() >= ms(cfg.periodoEnq_ms));
+
+    // com o modo sessão, somente o primeiro
+    protocolo.zeraMetricas();
+    protocolo.setSessao(true);
+    CHECK_FALSE(protocolo.sincronizado(agora));
+    for (const byte_t codigo : plano) {
+        REQUIRE(leitura(protocolo, medidor, agora, codigo) ==
+                Protocolo::Sucesso);
+        CHECK(protocolo.sincronizado(agora));
+    }
+    const Protocolo::metricas_t comSessao = protocolo.metricas();
+    CHECK(comSessao.comandos == 4);
+    CHECK(comSessao.sincronizados == 3);
+    CHECK(protocolo.ociosidade() < ms(cfg.periodoEnq_ms + 2));
+    CHECK(comSessao.ociosidade + 2 * ms(cfg.periodoEnq_ms) <=
+          semSessao.ociosidade);
+    CHECK(medidor.estatisticas().acksRecebidos == 2 * (2 + 2 * 2));
+
+    // o sincronismo vale até TMAXENQ após o ACK
+    Protocolo::instante_t deadline;
+    CHECK_FALSE(protocolo.proximoDeadline(deadline));
+    agora += ms(TMAXENQ_MSEC);
+    CHECK_FALSE(protocolo.sincronizado(agora));
+    protocolo.setComando(comando(0x14), agora);
+    CHECK(protocolo.estado() == Protocolo::Dessincronizado);
+
+    // leituras que falham não mantêm o sincronismo
+    Protocolo semMedidor;
+    semMedidor.setSessao(true);
+    semMedidor.setComando(comando(0x14), agora);
+    const byte_t enqs[] = {ENQ, ENQ};
+    semMedidor.recebe(enqs, 2, agora);
+    agora += ms(TMAXRSP_MSEC);
+    while (semMedidor.estado() != Protocolo::AguardaNovoComando) {
+        semMedidor.processa(agora);
+        agora += ms(TMAXRSP_MSEC);
+    }
+    CHECK_FALSE(semMedidor.sincronizado(agora));
+}
+
+TEST_CASE("ProtocoloLeitor: cadência de ENQ e margem até TMAXSINC") {
+    Protocolo protocolo;
+    Protocolo::instante_t t = Protocolo::instante_t() + ms(1000);
+    Protocolo::instante_t previsto;
+    const byte_t enq = ENQ;
+    const ms periodo(100);
+
+    // o intervalo entre os dois ENQs é a primeira amostra da cadência
+    protocolo.setComando(comando(0x14), t);
+    CHECK_FALSE(protocolo.proximoEnq(previsto));
+    protocolo.recebe(&enq, 1, t);
+    t += periodo;
+    Protocolo::resultado_t r = protocolo.recebe(&enq, 1, t);
+    REQUIRE((r.eventos & Protocolo::EventoTransmissao));
+    CHECK(protocolo.cadencia().amostras() == 1);
+    CHECK(protocolo.cadencia().periodo() == periodo);
+    CHECK_FALSE(protocolo.proximoEnq(previsto));
+
+    // margem até TMAXSINC a partir da entrega do ENQ
+    protocolo.transmitido(t + ms(5));
+    CHECK(protocolo.metricas().respostasEnq == 1);
+    CHECK(protocolo.metricas().foraDeTmaxsinc == 0);
+    CHECK(protocolo.metricas().margemMinima == ms(TMAXSINC_MSEC - 5));
+
+    // o ACK não responde a um ENQ
+    t += ms(150);
+    const resposta_t rsp = resposta(0x14);
+    r = protocolo.recebe(rsp.data(), rsp.size(), t);
+    REQUIRE((r.eventos & Protocolo::EventoTransmissao));
+    protocolo.transmitido(t);
+    CHECK(protocolo.metricas().respostasEnq == 1);
+    CHECK(protocolo.status() == Protocolo::Sucesso);
+    CHECK_FALSE(protocolo.proximoEnq(previsto));
+
+    // o próximo ENQ é previsto a partir do fim da troca, com a guarda de
+    // duas vezes o jitter
+    const Protocolo::instante_t fim = t;
+    protocolo.setComando(comando(0x14), t + ms(1));
+    REQUIRE(protocolo.proximoEnq(previsto));
+    CHECK(previsto == fim + periodo - 2 * protocolo.cadencia().jitter());
+    t += periodo;
+    protocolo.recebe(&enq, 1, t);
+    CHECK(protocolo.estado() == Protocolo::Sincronizado);
+    REQUIRE(protocolo.proximoEnq(previsto));
+    CHECK(previsto == t + periodo - 2 * protocolo.cadencia().jitter());
+
+    // resposta após TMAXSINC
+    t += periodo;
+    r = protocolo.recebe(&enq, 1, t);
+    REQUIRE((r.eventos & Protocolo::EventoTransmissao));
+    CHECK(protocolo.cadencia().amostras() == 2);
+    protocolo.transmitido(t + ms(TMAXSINC_MSEC + 1));
+    CHECK(protocolo.metricas().respostasEnq == 2);
+    CHECK(protocolo.metricas().foraDeTmaxsinc == 1);
+    CHECK(protocolo.metricas().margemMinima == -ms(1));
+    CHECK(protocolo.metricas().margemTotal == ms(TMAXSINC_MSEC - 5 - 1));
+
+    protocolo.zeraMetricas();
+    CHECK(protocolo.metricas().respostasEnq == 0);
+}
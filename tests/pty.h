@@ -0,0 +1,71 @@
+#pragma once
+
+// par de pseudo-terminais (pty) para testar as policies seriais unix sem
+// hardware: o lado escravo é aberto pela policy como se fosse uma porta serial
+// e o lado mestre faz o papel do medidor.
+
+#include <chrono>
+#include <cstdint>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+class ParPty {
+  public:
+    ParPty() {
+        _mestre = posix_openpt(O_RDWR | O_NOCTTY);
+        if (_mestre < 0 || grantpt(_mestre) || unlockpt(_mestre))
+            return;
+        fcntl(_mestre, F_SETFL, fcntl(_mestre, F_GETFL) | O_NONBLOCK);
+        _escravo = ptsname(_mestre);
+    }
+
+    ~ParPty() {
+        if (_mestre >= 0)
+            close(_mestre);
+    }
+
+    bool ok() const { return _mestre >= 0 && !_escravo.empty(); }
+
+    // fecha o lado mestre: o escravo passa a sinalizar POLLHUP
+    void fechaMestre() {
+        if (_mestre >= 0)
+            close(_mestre);
+        _mestre = -1;
+    }
+    int mestre() const { return _mestre; }
+    const char* escravo() const { return _escravo.c_str(); }
+
+    // escreve todos os bytes no lado mestre
+    bool escreve(const uint8_t* data, size_t data_sz) {
+        while (data_sz) {
+            ssize_t n = write(_mestre, data, data_sz);
+            if (n < 0)
+                return false;
+            data += n;
+            data_sz -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // lê do lado mestre até data_sz bytes ou até timeout_ms sem dados
+    size_t le(uint8_t* data, size_t data_sz, int timeout_ms = 200) {
+        size_t lidos = 0;
+        while (lidos < data_sz) {
+            struct pollfd pfd = {_mestre, POLLIN, 0};
+            if (poll(&pfd, 1, timeout_ms) <= 0)
+                break;
+            ssize_t n = read(_mestre, data + lidos, data_sz - lidos);
+            if (n <= 0)
+                break;
+            lidos += static_cast<size_t>(n);
+        }
+        return lidos;
+    }
+
+  private:
+    int _mestre = -1;
+    std::string _escravo;
+};
@@ -1,7 +1,11 @@
 #include "doctest/doctest.h"
 
 #include <NBR14522.h>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <ring_buffer.h>
+#include <thread>
 
 TEST_CASE("Ring Buffer") {
     RingBuffer<byte_t, 3> rb;
@@ -53,3 +57,154 @@ TEST_CASE("Ring Buffer") {
     CHECK(0x99 == rb.read());
     CHECK(0xAA == rb.read());
 }
+
+TEST_CASE("Ring Buffer SPSC") {
+    RingBufferSPSC<byte_t, 4> rb;
+    byte_t byte;
+
+    CHECK(rb.toread() == 0);
+    CHECK(rb.towrite() == 4);
+    CHECK(!rb.read(byte));
+
+    CHECK(rb.write(0x11));
+    CHECK(rb.write(0x22));
+    CHECK(rb.write(0x33));
+    CHECK(rb.write(0x44));
+    CHECK(rb.toread() == 4);
+
+    // buffer cheio: não sobrescreve dados
+    CHECK(!rb.write(0x55));
+    CHECK(rb.toread() == 4);
+
+    CHECK(rb.read(byte));
+    CHECK(byte == 0x11);
+    CHECK(rb.read(byte));
+    CHECK(byte == 0x22);
+    CHECK(rb.toread() == 2);
+
+    SUBCASE("escrita e leitura em bloco com volta ao início") {
+        const byte_t dados[] = {0xA0, 0xA1, 0xA2, 0xA3};
+        CHECK(rb.write(dados, sizeof(dados)) == 2);
+        CHECK(rb.toread() == 4);
+
+        // região legível dividida em dois segmentos
+        auto spans = rb.peekRead();
+        CHECK(spans.size() == 4);
+        REQUIRE(spans.primeiro.size == 2);
+        CHECK(spans.primeiro.data[0] == 0x33);
+        CHECK(spans.primeiro.data[1] == 0x44);
+        REQUIRE(spans.segundo.size == 2);
+        CHECK(spans.segundo.data[0] == 0xA0);
+        CHECK(spans.segundo.data[1] == 0xA1);
+        CHECK(rb.toread() == 4);
+
+        byte_t lidos[8];
+        CHECK(rb.read(lidos, sizeof(lidos)) == 4);
+        CHECK(lidos[0] == 0x33);
+        CHECK(lidos[1] == 0x44);
+        CHECK(lidos[2] == 0xA0);
+        CHECK(lidos[3] == 0xA1);
+        CHECK(rb.toread() == 0);
+        CHECK(rb.peekRead().size() == 0);
+    }
+
+    SUBCASE("leitura parcial em bloco") {
+        byte_t lidos[1];
+        CHECK(rb.read(lidos, 1) == 1);
+        CHECK(lidos[0] == 0x33);
+        CHECK(rb.toread() == 1);
+    }
+}
+
+TEST_CASE("Ring Buffer SPSC: alinhado à linha de cache") {
+    using RB = RingBufferSPSC<byte_t, 8>;
+    static_assert(alignof(RB) == 64, "RingBufferSPSC alinhado a 64 bytes");
+    // contadores e array em linhas distintas
+    static_assert(sizeof(RB) >= 3 * 64, "uma linha por contador e o array");
+
+    // também quando alocado no heap
+    std::unique_ptr<RB> rb(new RB);
+    CHECK(reinterpret_cast<std::uintptr_t>(rb.get()) % 64 == 0);
+}
+
+TEST_CASE("Ring Buffer SPSC entre duas threads") {
+    RingBufferSPSC<uint32_t, 64> rb;
+    const uint32_t N = 200000;
+
+    std::thread produtor([&]() {
+        uint32_t proximo = 0;
+        uint32_t bloco[7];
+        while (proximo < N) {
+            size_t n = 0;
+            while (n < 7 && proximo + n < N) {
+                bloco[n] = proximo + static_cast<uint32_t>(n);
+                n++;
+            }
+            size_t escritos = rb.write(bloco, n);
+            if (!escritos)
+                std::this_thread::yield();
+            proximo += static_cast<uint32_t>(escritos);
+        }
+    });
+
+    bool ordemCorreta = true;
+    uint32_t esperado = 0;
+    uint32_t bloco[5];
+    while (esperado < N) {
+        size_t n = rb.read(bloco, 5);
+        if (!n)
+            std::this_thread::yield();
+        for (size_t i = 0; i < n; i++)
+            ordemCorreta = ordemCorreta && (bloco[i] == esperado++);
+    }
+
+    produtor.join();
+    CHECK(ordemCorreta);
+    CHECK(rb.toread() == 0);
+}
+
+TEST_CASE("Ring Buffer SPSC: reserva/publicação e leitura sem cópia") {
+    RingBufferSPSC<byte_t, 8> rb;
+    byte_t lidos[8];
+
+    // avança os índices para que a próxima reserva passe pelo fim do array
+    const byte_t inicio[] = {1, 2, 3, 4, 5, 6};
+    CHECK(rb.write(inicio, sizeof(inicio)) == 6);
+    CHECK(rb.read(lidos, 6) == 6);
+
+    auto livre = rb.reserveWrite(5);
+    REQUIRE(livre.size() == 5);
+    CHECK(livre.primeiro.size == 2);
+    CHECK(livre.segundo.size == 3);
+    const byte_t novos[] = {0x10, 0x11, 0x12, 0x13, 0x14};
+    std::memcpy(livre.primeiro.data, novos, livre.primeiro.size);
+    std::memcpy(livre.segundo.data, novos + livre.primeiro.size,
+                livre.segundo.size);
+
+    // nada visível antes de publicar
+    CHECK(rb.toread() == 0);
+    rb.commitWrite(4);
+    CHECK(rb.toread() == 4);
+
+    // reserva limitada ao espaço livre
+    CHECK(rb.reserveWrite(100).size() == 4);
+
+    auto dados = rb.peekRead();
+    REQUIRE(dados.size() == 4);
+    CHECK(dados.primeiro.size == 2);
+    CHECK(dados.primeiro.data[0] == 0x10);
+    CHECK(dados.primeiro.data[1] == 0x11);
+    CHECK(dados.segundo.size == 2);
+    CHECK(dados.segundo.data[0] == 0x12);
+    CHECK(dados.segundo.data[1] == 0x13);
+
+    rb.consume(3);
+    CHECK(rb.toread() == 1);
+    CHECK(rb.read(lidos, 8) == 1);
+    CHECK(lidos[0] == 0x13);
+
+    // consumir além do disponível não avança o índice de leitura
+    rb.consume(5);
+    CHECK(rb.toread() == 0);
+    CHECK(rb.towrite() == 8);
+}
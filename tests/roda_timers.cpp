@@ -0,0 +1,125 @@
+#include "doctest/doctest.h"
+#include <NBR14522.h>
+#include <chrono>
+#include <memory>
+#include <timer/roda_timers.h>
+#include <vector>
+
+using namespace std::chrono;
+
+using Timer = RodaDeTimers::Timer;
+
+TEST_CASE("RodaDeTimers: expira em ordem, nunca antes do deadline") {
+    const auto inicio = RodaDeTimers::clock::now();
+    RodaDeTimers roda(inicio);
+
+    std::vector<int> ordem;
+    const int atrasos_ms[] = {30, 5, 70, 1, 64, 4096, 200};
+    const size_t N = sizeof(atrasos_ms) / sizeof(atrasos_ms[0]);
+    std::vector<std::unique_ptr<Timer>> timers;
+    for (size_t i = 0; i < N; i++) {
+        timers.emplace_back(new Timer());
+        const int atraso = atrasos_ms[i];
+        timers[i]->aoExpirar([&ordem, atraso]() { ordem.push_back(atraso); });
+        roda.arma(*timers[i], inicio + milliseconds(atraso));
+    }
+    CHECK(roda.armados() == N);
+
+    RodaDeTimers::clock::time_point proximo;
+    REQUIRE(roda.proximoDeadline(proximo));
+    CHECK(proximo == inicio + milliseconds(1));
+
+    // avança de 1 em 1 ms: cada timer expira exatamente no seu tick
+    for (int ms = 1; ms <= 5000; ms++) {
+        size_t antes = ordem.size();
+        roda.avanca(inicio + milliseconds(ms));
+        for (size_t i = antes; i < ordem.size(); i++)
+            CHECK(ordem[i] == ms);
+    }
+    CHECK(ordem == std::vector<int>({1, 5, 30, 64, 70, 200, 4096}));
+    CHECK(roda.armados() == 0);
+    CHECK_FALSE(roda.proximoDeadline(proximo));
+}
+
+TEST_CASE("RodaDeTimers: saltos, cancelamento e rearme") {
+    const auto inicio = RodaDeTimers::clock::now();
+    RodaDeTimers roda(inicio);
+
+    int expirados[3] = {};
+    Timer timers[3];
+    for (int i = 0; i < 3; i++)
+        timers[i].aoExpirar([&expirados, i]() { expirados[i]++; });
+
+    // TSEMWAIT: desce da cascata de níveis superiores
+    roda.arma(timers[0], inicio + seconds(NBR14522::TSEMWAIT_SEC));
+    roda.arma(timers[1], inicio + milliseconds(NBR14522::TMAXRSP_MSEC));
+    roda.arma(timers[2], inicio + milliseconds(NBR14522::TMAXRSP_MSEC));
+
+    timers[2].cancela();
+    CHECK_FALSE(timers[2].armado());
+    CHECK(roda.armados() == 2);
+
+    // um único avanço longo expira tudo o que venceu no intervalo
+    CHECK(roda.avanca(inicio + milliseconds(NBR14522::TMAXRSP_MSEC - 1)) ==
+          0);
+    CHECK(roda.avanca(inicio + seconds(10)) == 1);
+    CHECK(expirados[1] == 1);
+    CHECK(expirados[2] == 0);
+
+    // rearme antecipa o timer longo
+    roda.arma(timers[0], inicio + seconds(20));
+    CHECK(roda.armados() == 1);
+    CHECK(roda.avanca(inicio + seconds(20) - milliseconds(1)) == 0);
+    CHECK(roda.avanca(inicio + seconds(20)) == 1);
+    CHECK(expirados[0] == 1);
+
+    // deadline no passado: expira no próximo tick
+    roda.arma(timers[2], inicio);
+    CHECK(roda.avanca(inicio + seconds(20)) == 0);
+    CHECK(roda.avanca(inicio + seconds(20) + milliseconds(1)) == 1);
+
+    // além da faixa da roda (~4,6 h)
+    roda.arma(timers[0], inicio + hours(10));
+    CHECK(roda.avanca(inicio + hours(10) - milliseconds(1)) == 0);
+    CHECK(roda.armados() == 1);
+    CHECK(roda.avanca(inicio + hours(10)) == 1);
+    CHECK(expirados[0] == 2);
+}
+
+TEST_CASE("RodaDeTimers: callback rearma o timer") {
+    const auto inicio = RodaDeTimers::clock::now();
+    RodaDeTimers roda(inicio);
+
+    Timer timer;
+    int expirados = 0;
+    timer.aoExpirar([&]() {
+        if (++expirados < 3)
+            roda.arma(timer, inicio + milliseconds(100 * (expirados + 1)));
+    });
+    roda.arma(timer, inicio + milliseconds(100));
+
+    CHECK(roda.avanca(inicio + seconds(1)) == 3);
+    CHECK(expirados == 3);
+    CHECK_FALSE(timer.armado());
+}
+
+TEST_CASE("TimerPolicyRoda") {
+    TimerPolicyRoda timer;
+    bool avisado = false;
+    timer.aoExpirar([&]() { avisado = true; });
+
+    timer.setTimeout(20);
+    RodaDeTimers::clock::time_point proximo;
+    REQUIRE(TimerPolicyRoda::roda().proximoDeadline(proximo));
+    CHECK(proximo >= timer.deadline());
+
+    // timedOut() não lê o relógio: depende do avanço da roda
+    TimerPolicyRoda::roda().avanca(timer.deadline() - milliseconds(1));
+    CHECK_FALSE(timer.timedOut());
+    TimerPolicyRoda::roda().avanca(timer.deadline() + milliseconds(1));
+    CHECK(timer.timedOut());
+    CHECK(avisado);
+
+    timer.setTimeout(20);
+    CHECK_FALSE(timer.timedOut());
+}
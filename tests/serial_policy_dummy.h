@@ -0,0 +1,32 @@
+#pragma once
+
+#include <NBR14522.h>
+#include <ring_buffer.h>
+
+// porta serial simulada para testes que permite ler dados do leitor e add
+// dados como se fossemos o medidor
+
+class SerialPolicyDummy {
+  public:
+    RingBuffer<byte_t, 300> toLeitor;
+    RingBuffer<byte_t, 300> toMedidor;
+    SerialPolicyDummy() {
+        // esvazia ring buffers
+        while (this->toMedidor.toread())
+            this->toMedidor.read();
+        while (this->toLeitor.toread())
+            this->toLeitor.read();
+    }
+    size_t tx(const byte_t* data, const size_t data_sz) {
+        for (size_t i = 0; i < data_sz; i++)
+            toMedidor.write(data[i]);
+        return data_sz;
+    }
+    size_t rx(byte_t* data, const size_t max_data_sz) {
+        size_t toread = toLeitor.toread();
+        size_t sz = max_data_sz >= toread ? toread : max_data_sz;
+        for (size_t i = 0; i < sz; i++)
+            data[i] = toLeitor.read();
+        return sz;
+    }
+};
@@ -0,0 +1,122 @@
+#include "doctest/doctest.h"
+#include "pty.h"
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <leitor_fsm.h>
+#include <serial/serial_policy_io_uring.h>
+#include <timer/timer_policy_generic_os.h>
+#include <vector>
+
+using namespace NBR14522;
+
+// executa a mesma troca de bytes com o anel habilitado e com o fallback
+static void trocaBytes(const bool habilitado) {
+    auto anel = std::make_shared<AnelIoUring>(4, habilitado);
+
+    ParPty pty1, pty2;
+    REQUIRE(pty1.ok());
+    REQUIRE(pty2.ok());
+
+    SerialPolicyIoUring porta1(anel), porta2(anel);
+    REQUIRE(porta1.openSerial(pty1.escravo()));
+    REQUIRE(porta2.openSerial(pty2.escravo()));
+
+    const byte_t cmd1[] = {0x14, 0x01, 0x02};
+    const byte_t cmd2[] = {0x20, 0x03};
+    CHECK(porta1.tx(cmd1, sizeof(cmd1)) == sizeof(cmd1));
+    CHECK(porta2.tx(cmd2, sizeof(cmd2)) == sizeof(cmd2));
+    anel->processa();
+
+    byte_t recebido[8];
+    REQUIRE(pty1.le(recebido, sizeof(cmd1)) == sizeof(cmd1));
+    CHECK(recebido[0] == 0x14);
+    CHECK(recebido[2] == 0x02);
+    REQUIRE(pty2.le(recebido, sizeof(cmd2)) == sizeof(cmd2));
+    CHECK(recebido[1] == 0x03);
+
+    resposta_t rsp;
+    for (size_t i = 0; i < rsp.size(); i++)
+        rsp.at(i) = static_cast<byte_t>(i);
+    REQUIRE(pty2.escreve(rsp.data(), rsp.size()));
+
+    resposta_t lida;
+    size_t lidos = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (lidos < lida.size() && porta2.aguardaRx(deadline))
+        lidos += porta2.rx(&lida[lidos], lida.size() - lidos);
+    CHECK(lidos == lida.size());
+    CHECK(lida == rsp);
+
+    byte_t byte;
+    CHECK(porta1.rx(&byte, 1) == 0);
+
+    // leituras ainda pendentes no anel: canceladas antes de fechar o fd
+    CHECK(porta1.closeSerial());
+    CHECK(porta2.closeSerial());
+    CHECK(anel->falhasRemocao() == 0);
+}
+
+TEST_CASE("SerialPolicyIoUring") {
+    SUBCASE("io_uring") {
+        AnelIoUring anel(1);
+        if (!anel.disponivel())
+            MESSAGE("io_uring indisponível, testando somente o fallback");
+        trocaBytes(true);
+    }
+
+    SUBCASE("fallback para syscalls por porta") { trocaBytes(false); }
+}
+
+TEST_CASE("LeitorFSM sobre SerialPolicyIoUring") {
+    auto anel = std::make_shared<AnelIoUring>(2);
+
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    auto porta = std::make_shared<SerialPolicyIoUring>(anel);
+    REQUIRE(porta->openSerial(pty.escravo()));
+
+    using Leitor = LeitorFSM<TimerPolicyWinUnix, SerialPolicyIoUring>;
+    Leitor leitor(porta);
+    std::vector<resposta_t> respostas;
+    leitor.setCallback(
+        [&](const resposta_t& rsp) { respostas.push_back(rsp); });
+
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+    leitor.setComando(cmd);
+
+    const byte_t enq = ENQ;
+    REQUIRE(pty.escreve(&enq, 1));
+    REQUIRE(pty.escreve(&enq, 1));
+
+    resposta_t rsp;
+    rsp.fill(0x00);
+    rsp.at(0) = 0x14;
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+
+    byte_t recebido[COMANDO_SZ];
+    size_t recebidos = 0;
+    auto limite = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (leitor.processaEstado() != Leitor::estado_t::AguardaNovoComando &&
+           std::chrono::steady_clock::now() < limite) {
+        anel->processa(1);
+
+        if (recebidos < COMANDO_SZ) {
+            recebidos += pty.le(&recebido[recebidos], COMANDO_SZ - recebidos,
+                                0);
+            if (recebidos == COMANDO_SZ) {
+                CHECK(recebido[0] == 0x14);
+                REQUIRE(pty.escreve(rsp.data(), rsp.size()));
+            }
+        }
+    }
+
+    CHECK(leitor.status() == Leitor::status_t::Sucesso);
+    REQUIRE(respostas.size() == 1);
+    CHECK(respostas[0] == rsp);
+    if (anel->disponivel())
+        CHECK(anel->chamadas() > 0);
+}
@@ -0,0 +1,279 @@
+#include "doctest/doctest.h"
+#include "pty.h"
+#include <NBR14522.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <leitor.h>
+#include <medidor_simulado.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <serial/serial_policy_tcp.h>
+#include <serial/serial_policy_unix.h>
+#include <sys/socket.h>
+#include <thread>
+#include <timer/timer_policy_generic_os.h>
+#include <vector>
+
+using namespace NBR14522;
+
+// servidor TCP local que faz o papel do servidor serial: aceita uma conexão e
+// repassa os bytes recebidos a trata(), que pode responder pelo socket
+class ServidorLocal {
+  public:
+    using trata_t = std::function<void(int fd, const byte_t*, size_t)>;
+
+    ServidorLocal(trata_t trata, std::function<void(int fd)> ocioso = nullptr)
+        : _trata(trata), _ocioso(ocioso) {
+        _escuta = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in endereco = {};
+        endereco.sin_family = AF_INET;
+        endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t sz = sizeof(endereco);
+        if (bind(_escuta, reinterpret_cast<sockaddr*>(&endereco), sz) ||
+            listen(_escuta, 1) ||
+            getsockname(_escuta, reinterpret_cast<sockaddr*>(&endereco), &sz))
+            return;
+        _porta = ntohs(endereco.sin_port);
+        _thread = std::thread([this]() { _executa(); });
+    }
+
+    ~ServidorLocal() {
+        _encerrar = true;
+        shutdown(_escuta, SHUT_RDWR);
+        if (_thread.joinable())
+            _thread.join();
+        close(_escuta);
+    }
+
+    uint16_t porta() const { return _porta; }
+    std::vector<byte_t> recebidos() {
+        std::lock_guard<std::mutex> trava(_mutex);
+        return _recebidos;
+    }
+
+  private:
+    trata_t _trata;
+    std::function<void(int fd)> _ocioso;
+    int _escuta = -1;
+    uint16_t _porta = 0;
+    std::atomic<bool> _encerrar{false};
+    std::thread _thread;
+    std::mutex _mutex;
+    std::vector<byte_t> _recebidos;
+
+    void _executa() {
+        int fd = accept(_escuta, nullptr, nullptr);
+        if (fd < 0)
+            return;
+
+        while (!_encerrar) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, 1) > 0) {
+                byte_t buf[512];
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0)
+                    break;
+                {
+                    std::lock_guard<std::mutex> trava(_mutex);
+                    _recebidos.insert(_recebidos.end(), buf, buf + n);
+                }
+                _trata(fd, buf, static_cast<size_t>(n));
+            }
+            if (_ocioso)
+                _ocioso(fd);
+        }
+        close(fd);
+    }
+};
+
+TEST_CASE("SerialPolicyTcp: leitura de medidor remoto") {
+    MedidorSimulado::configuracao_t cfg = MedidorSimulado::configuracaoPadrao();
+    cfg.periodoEnq_ms = TMINENQ_MSEC + 10;
+    MedidorSimulado medidor(cfg);
+
+    auto envia = [&](int fd) {
+        byte_t buf[RESPOSTA_SZ];
+        size_t n = medidor.transmite(buf, sizeof(buf),
+                                     MedidorSimulado::clock::now());
+        if (n)
+            send(fd, buf, n, MSG_NOSIGNAL);
+    };
+    ServidorLocal servidor(
+        [&](int fd, const byte_t* data, size_t sz) {
+            medidor.recebe(data, sz, MedidorSimulado::clock::now());
+            envia(fd);
+        },
+        envia);
+    REQUIRE(servidor.porta());
+
+    using Porta = SerialPolicyTcp<>;
+    auto porta = std::make_shared<Porta>();
+    REQUIRE(porta->conecta("127.0.0.1", servidor.porta()));
+
+    Leitor<TimerPolicyWinUnix, Porta, LogPolicyNull> leitor(porta);
+    std::vector<resposta_t> respostas;
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x26;
+
+    CHECK(leitor.leitura(
+        cmd, [&](const resposta_t& rsp) { respostas.push_back(rsp); }, 2000));
+    REQUIRE(respostas.size() == cfg.respostasCompostas);
+    CHECK(isLastRespostaOfComposed(respostas.back()));
+}
+
+TEST_CASE("SerialPolicyTcp: RFC 2217") {
+    // servidor que ecoa os dados e envia um comando Telnet a cada bloco
+    ServidorLocal servidor([](int fd, const byte_t* data, size_t sz) {
+        std::vector<byte_t> resposta = {0xFF, 0xFD, 0x2C}; // IAC DO COM-PORT
+        resposta.insert(resposta.end(), data, data + sz);
+        send(fd, resposta.data(), resposta.size(), MSG_NOSIGNAL);
+    });
+    REQUIRE(servidor.porta());
+
+    SerialPolicyTcp<> porta;
+    REQUIRE(porta.conecta("127.0.0.1", servidor.porta()));
+    REQUIRE(porta.configuraPorta(BAUDRATE_9600, DATABITS_8, PARITY_EVEN));
+
+    // negociação e SET-BAUDRATE 9600 (0x00002580) chegam ao servidor
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    byte_t buf[64];
+    size_t n = 0;
+    while (n < 3 && porta.aguardaRx(deadline))
+        n += porta.rx(buf + n, sizeof(buf) - n);
+
+    // somente os dados voltam (sem os comandos Telnet do eco)
+    CHECK(n == 0);
+
+    const std::vector<byte_t> negociacao = {0xFF, 0xFB, 0x2C};
+    const std::vector<byte_t> baud = {0xFF, 0xFA, 0x2C, 0x01, 0x00,
+                                      0x00, 0x25, 0x80, 0xFF, 0xF0};
+    const std::vector<byte_t> paridade = {0xFF, 0xFA, 0x2C, 0x03,
+                                          0x03, 0xFF, 0xF0};
+    auto contem = [&](const std::vector<byte_t>& seq) {
+        const std::vector<byte_t> recebidos = servidor.recebidos();
+        return std::search(recebidos.begin(), recebidos.end(), seq.begin(),
+                           seq.end()) != recebidos.end();
+    };
+    CHECK(contem(negociacao));
+    CHECK(contem(baud));
+    CHECK(contem(paridade));
+
+    // 0xFF nos dados é escapado e o eco é desescapado
+    const byte_t dados[] = {0x26, 0xFF, 0x10};
+    REQUIRE(porta.tx(dados, sizeof(dados)) == sizeof(dados));
+    n = 0;
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (n < sizeof(dados) && porta.aguardaRx(deadline))
+        n += porta.rx(buf + n, sizeof(buf) - n);
+    REQUIRE(n == sizeof(dados));
+    CHECK(std::equal(dados, dados + sizeof(dados), buf));
+
+    const std::vector<byte_t> escapado = {0x26, 0xFF, 0xFF, 0x10};
+    CHECK(contem(escapado));
+}
+
+TEST_CASE("SerialPolicyTcp: descartaRx() após bloco só de comandos Telnet") {
+    // ao receber 0x26, o servidor envia 512 bytes de IAC NOP (o tamanho do
+    // buffer de recepção) seguidos de dados: o primeiro recv() do descarte
+    // não tem dados depois do filtro, mas os dados seguintes também devem ser
+    // descartados
+    ServidorLocal servidor([](int fd, const byte_t* data, size_t sz) {
+        if (std::find(data, data + sz, 0x26) == data + sz)
+            return;
+        std::vector<byte_t> resposta;
+        for (int i = 0; i < 256; i++) {
+            resposta.push_back(0xFF); // IAC
+            resposta.push_back(0xF1); // NOP
+        }
+        resposta.insert(resposta.end(), {0x01, 0x02, 0x03});
+        send(fd, resposta.data(), resposta.size(), MSG_NOSIGNAL);
+    });
+    REQUIRE(servidor.porta());
+
+    SerialPolicyTcp<> porta;
+    REQUIRE(porta.conecta("127.0.0.1", servidor.porta()));
+    REQUIRE(porta.configuraPorta(BAUDRATE_9600, DATABITS_8, PARITY_EVEN));
+
+    const byte_t gatilho = 0x26;
+    REQUIRE(porta.tx(&gatilho, 1) == 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    REQUIRE(porta.aguardaRx(deadline));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    porta.descartaRx();
+    CHECK(porta.conectado());
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    CHECK_FALSE(porta.aguardaRx(deadline));
+}
+
+// mediana do tempo de ida e volta de 1 byte, em us
+template <class Porta> static double idaEVolta(Porta& porta) {
+    std::vector<double> amostras;
+    for (int i = 0; i < 200; i++) {
+        byte_t byte = static_cast<byte_t>(i), eco;
+        auto inicio = std::chrono::steady_clock::now();
+        porta.tx(&byte, 1);
+        if (!porta.rxUntil(&eco, 1, inicio + std::chrono::seconds(1)))
+            break;
+        amostras.push_back(std::chrono::duration<double, std::micro>(
+                               std::chrono::steady_clock::now() - inicio)
+                               .count());
+    }
+    if (amostras.size() < 200)
+        return -1;
+    std::sort(amostras.begin(), amostras.end());
+    return amostras[amostras.size() / 2];
+}
+
+// rx() com espera, como SerialPolicyUnix::rxUntil()
+class PortaTcpEco : public SerialPolicyTcp<> {
+  public:
+    template <class Deadline>
+    size_t rxUntil(byte_t* data, size_t max_data_sz, const Deadline& deadline) {
+        do {
+            size_t n = rx(data, max_data_sz);
+            if (n)
+                return n;
+        } while (aguardaRx(deadline));
+        return 0;
+    }
+};
+
+TEST_CASE("SerialPolicyTcp: latência adicionada em relação ao pty") {
+    ServidorLocal servidor([](int fd, const byte_t* data, size_t sz) {
+        send(fd, data, sz, MSG_NOSIGNAL);
+    });
+    REQUIRE(servidor.porta());
+    PortaTcpEco tcp;
+    REQUIRE(tcp.conecta("127.0.0.1", servidor.porta()));
+
+    ParPty pty;
+    REQUIRE(pty.ok());
+    SerialPolicyUnix<> serial;
+    REQUIRE(serial.openSerial(pty.escravo()));
+    std::atomic<bool> encerrar{false};
+    std::thread eco([&]() {
+        while (!encerrar) {
+            byte_t buf[64];
+            size_t n = pty.le(buf, 1, 1);
+            if (n)
+                pty.escreve(buf, n);
+        }
+    });
+
+    double usTcp = idaEVolta(tcp);
+    double usPty = idaEVolta(serial);
+    encerrar = true;
+    eco.join();
+
+    MESSAGE("ida e volta (mediana): TCP " << usTcp << " us, pty " << usPty
+                                          << " us");
+    CHECK(usTcp > 0);
+    CHECK(usPty > 0);
+    // no loopback, o TCP não pode custar uma ordem de grandeza acima do pty
+    CHECK(usTcp < 10 * usPty + 1000);
+}
@@ -0,0 +1,288 @@
+#include "doctest/doctest.h"
+#include "pty.h"
+#include <CRC.h>
+#include <NBR14522.h>
+#include <chrono>
+#include <ctime>
+#include <fcntl.h>
+#include <leitor.h>
+#include <ring_buffer.h>
+#include <serial/serial_policy_unix.h>
+#include <termios.h>
+#include <thread>
+#include <timer/timer_policy_generic_os.h>
+
+using namespace NBR14522;
+
+// lê da porta para o ring buffer até receber n bytes ou esgotar as tentativas
+template <size_t S>
+static size_t rxAte(SerialPolicyUnix<>& porta, RingBufferSPSC<byte_t, S>& rb,
+                    size_t n) {
+    for (int tentativas = 0; rb.toread() < n && tentativas < 200;
+         tentativas++) {
+        if (!porta.rx(rb))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return rb.toread();
+}
+
+TEST_CASE("SerialPolicyUnix: recepção direta no ring buffer") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    SerialPolicyUnix<> porta;
+    REQUIRE(porta.openSerial(pty.escravo()));
+
+    // resposta válida enviada pelo "medidor"
+    resposta_t rsp;
+    for (size_t i = 0; i < rsp.size(); i++)
+        rsp.at(i) = static_cast<byte_t>(i);
+    setCRC(rsp, CRC16(rsp.data(), rsp.size() - 2));
+
+    RingBufferSPSC<byte_t, 512> rb;
+
+    // desloca o início do buffer para que a resposta passe pelo fim do array
+    byte_t lixo[400] = {};
+    CHECK(rb.write(lixo, sizeof(lixo)) == sizeof(lixo));
+    rb.consume(sizeof(lixo));
+
+    REQUIRE(pty.escreve(rsp.data(), rsp.size()));
+    REQUIRE(rxAte(porta, rb, RESPOSTA_SZ) == RESPOSTA_SZ);
+
+    // CRC verificado no próprio buffer, sem copiar a resposta
+    auto spans = rb.peekRead();
+    CHECK(spans.segundo.size > 0);
+    CRC16State crc;
+    crc.update(spans.primeiro.data, spans.primeiro.size);
+    crc.update(spans.segundo.data, spans.segundo.size);
+    CHECK(crc.finalize() == 0x0000);
+
+    rb.consume(RESPOSTA_SZ);
+    CHECK(rb.toread() == 0);
+
+    porta.closeSerial();
+}
+
+TEST_CASE("SerialPolicyUnix: recepção com deadline") {
+    using namespace std::chrono;
+
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    SerialPolicyUnix<> porta;
+    REQUIRE(porta.openSerial(pty.escravo()));
+
+    byte_t buf[16];
+
+    SUBCASE("sem dados, retorna após o deadline") {
+        auto inicio = steady_clock::now();
+        CHECK(porta.rxUntil(buf, sizeof(buf), inicio + milliseconds(50)) ==
+              0);
+        CHECK(steady_clock::now() - inicio >= milliseconds(50));
+        CHECK(!porta.aguardaRx(steady_clock::now()));
+    }
+
+    SUBCASE("dados chegam antes do deadline") {
+        std::thread medidor([&]() {
+            std::this_thread::sleep_for(milliseconds(20));
+            byte_t enq = ENQ;
+            pty.escreve(&enq, 1);
+        });
+
+        auto inicio = steady_clock::now();
+        CHECK(porta.rxUntil(buf, sizeof(buf), inicio + seconds(5)) == 1);
+        CHECK(buf[0] == ENQ);
+        CHECK(steady_clock::now() - inicio < seconds(5));
+        medidor.join();
+    }
+}
+
+TEST_CASE("SerialPolicyUnix: buffer de recepção") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    SerialPolicyUnix<> porta;
+    REQUIRE(porta.openSerial(pty.escravo()));
+
+    resposta_t rsp;
+    for (size_t i = 0; i < rsp.size(); i++)
+        rsp.at(i) = static_cast<byte_t>(i);
+
+    // lê a resposta byte a byte, como o LeitorFSM
+    auto leByteAByte = [&]() {
+        resposta_t recebida;
+        size_t lidos = 0;
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::seconds(1);
+        while (lidos < recebida.size() &&
+               porta.rxUntil(&recebida[lidos], 1, deadline))
+            lidos++;
+        CHECK(lidos == recebida.size());
+        CHECK(recebida == rsp);
+    };
+
+    SUBCASE("um read(2) serve vários rx()") {
+        REQUIRE(pty.escreve(rsp.data(), rsp.size()));
+        leByteAByte();
+
+        auto estatisticas = porta.estatisticas();
+        CHECK(estatisticas.chamadasRx >= RESPOSTA_SZ);
+        CHECK(estatisticas.bytesRecebidos == RESPOSTA_SZ);
+        // o pty pode entregar a resposta em mais de um pedaço
+        CHECK(estatisticas.leituras < RESPOSTA_SZ / 10);
+    }
+
+    SUBCASE("sem buffer, um read(2) por byte") {
+        porta.setTamanhoBufferRx(1);
+        REQUIRE(pty.escreve(rsp.data(), rsp.size()));
+        leByteAByte();
+
+        CHECK(porta.estatisticas().leituras >= RESPOSTA_SZ);
+    }
+
+    SUBCASE("ring buffer recebe primeiro os bytes do buffer") {
+        REQUIRE(pty.escreve(rsp.data(), rsp.size()));
+        byte_t primeiro;
+        REQUIRE(porta.rxUntil(&primeiro, 1,
+                              std::chrono::steady_clock::now() +
+                                  std::chrono::seconds(1)) == 1);
+        CHECK(primeiro == rsp.at(0));
+
+        RingBufferSPSC<byte_t, 512> rb;
+        REQUIRE(rxAte(porta, rb, RESPOSTA_SZ - 1) == RESPOSTA_SZ - 1);
+        resposta_t recebida;
+        recebida.at(0) = primeiro;
+        CHECK(rb.read(&recebida[1], RESPOSTA_SZ - 1) == RESPOSTA_SZ - 1);
+        CHECK(recebida == rsp);
+    }
+}
+
+TEST_CASE("SerialPolicyUnix: perfil raw e descarte da recepção") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    SerialPolicyUnix<> porta;
+    REQUIRE(porta.openSerial(pty.escravo(), BAUDRATE_2400));
+
+    // a configuração é do dispositivo: pode ser lida por outro descritor
+    int fd = open(pty.escravo(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    REQUIRE(fd >= 0);
+    struct termios options;
+    REQUIRE(tcgetattr(fd, &options) == 0);
+    close(fd);
+
+    CHECK(!(options.c_lflag & (ICANON | ECHO | ISIG)));
+    CHECK(!(options.c_iflag & (IXON | ICRNL | ISTRIP)));
+    CHECK(!(options.c_oflag & OPOST));
+    CHECK(options.c_cc[VMIN] == 0);
+    CHECK(options.c_cc[VTIME] == 0);
+    CHECK(cfgetispeed(&options) == B2400);
+
+    // bytes recebidos, com parte já no buffer de recepção da policy
+    const byte_t lixo[] = {ENQ, 0x01, 0x02, 0x03, ENQ};
+    REQUIRE(pty.escreve(lixo, sizeof(lixo)));
+    byte_t byte;
+    REQUIRE(porta.rxUntil(&byte, 1,
+                          std::chrono::steady_clock::now() +
+                              std::chrono::seconds(1)) == 1);
+
+    auto leituras = porta.estatisticas().leituras;
+    porta.descartaRx();
+    CHECK(porta.estatisticas().leituras == leituras);
+    CHECK(porta.rx(&byte, 1) == 0);
+
+    // bytes posteriores ao descarte são recebidos normalmente
+    const byte_t enq = ENQ;
+    REQUIRE(pty.escreve(&enq, 1));
+    CHECK(porta.rxUntil(&byte, 1,
+                        std::chrono::steady_clock::now() +
+                            std::chrono::seconds(1)) == 1);
+    CHECK(byte == ENQ);
+}
+
+TEST_CASE("Leitor não consome CPU enquanto aguarda o medidor") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    sptr<SerialPolicyUnix<>> porta = std::make_shared<SerialPolicyUnix<>>();
+    REQUIRE(porta->openSerial(pty.escravo()));
+
+    Leitor<TimerPolicyWinUnix, SerialPolicyUnix<>, LogPolicyNull> leitor(
+        porta);
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+
+    // medidor mudo: a leitura termina pelo timeout do usuário
+    std::clock_t cpuInicio = std::clock();
+    CHECK(!leitor.leitura(
+        cmd, [](const resposta_t&) {}, 300));
+    double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuInicio) /
+                   CLOCKS_PER_SEC;
+
+    // antes, o laço de leitura ocupava a CPU durante todo o timeout
+    CHECK(cpuMs < 100.0);
+}
+
+TEST_CASE("Leitor falha de imediato se a porta é desconectada") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    sptr<SerialPolicyUnix<>> porta = std::make_shared<SerialPolicyUnix<>>();
+    REQUIRE(porta->openSerial(pty.escravo()));
+    pty.fechaMestre();
+
+    Leitor<TimerPolicyWinUnix, SerialPolicyUnix<>, LogPolicyNull> leitor(
+        porta);
+    comando_t cmd;
+    cmd.fill(0x00);
+    cmd.at(0) = 0x14;
+
+    // sem o medidor, aguardaRx() retorna antes do deadline: a leitura falha
+    // sem esperar (nem ocupar a CPU até) o timeout do usuário
+    const auto inicio = std::chrono::steady_clock::now();
+    CHECK(!leitor.leitura(
+        cmd, [](const resposta_t&) {}, 5000));
+    CHECK(std::chrono::steady_clock::now() - inicio <
+          std::chrono::milliseconds(500));
+}
+
+TEST_CASE("SerialPolicyUnix com trace em memória") {
+    ParPty pty;
+    REQUIRE(pty.ok());
+
+    SerialPolicyUnix<TracePolicyMemoria<1024>> porta;
+    REQUIRE(porta.openSerial(pty.escravo()));
+
+    const byte_t cmd[] = {0x14, 0x01, 0x02};
+    CHECK(porta.tx(cmd, sizeof(cmd)) == sizeof(cmd));
+
+    byte_t recebido[3];
+    CHECK(pty.le(recebido, sizeof(recebido)) == sizeof(recebido));
+
+    const byte_t enq = ENQ;
+    REQUIRE(pty.escreve(&enq, 1));
+    byte_t byte;
+    CHECK(porta.rxUntil(&byte, 1,
+                        std::chrono::steady_clock::now() +
+                            std::chrono::seconds(1)) == 1);
+
+    cabecalho_trace_t cabecalho;
+    byte_t dados[16];
+
+    REQUIRE(porta.trace().proximoRegistro(cabecalho, dados, sizeof(dados)));
+    CHECK(cabecalho.direcao == TRACE_TX);
+    CHECK(cabecalho.tamanho == sizeof(cmd));
+    CHECK(dados[0] == 0x14);
+    CHECK(dados[2] == 0x02);
+    uint64_t timestampTx = cabecalho.timestamp_ns;
+
+    REQUIRE(porta.trace().proximoRegistro(cabecalho, dados, sizeof(dados)));
+    CHECK(cabecalho.direcao == TRACE_RX);
+    CHECK(cabecalho.tamanho == 1);
+    CHECK(dados[0] == ENQ);
+    CHECK(cabecalho.timestamp_ns >= timestampTx);
+
+    CHECK(!porta.trace().proximoRegistro(cabecalho, dados, sizeof(dados)));
+    CHECK(porta.trace().descartados() == 0);
+}
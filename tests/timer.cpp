@@ -1,7 +1,9 @@
 #include <chrono>
 #include <doctest/doctest.h>
 #include <thread>
+#include <serial/deadline.h>
 #include <timer/timer_policy_generic_os.h>
+#include <timer/timer_policy_virtual.h>
 
 using namespace std::literals;
 
@@ -19,3 +21,23 @@ TEST_CASE("TimerPolicyWinUnix") {
     std::this_thread::sleep_for(20ms);
     CHECK(t.timedOut());
 }
+
+TEST_CASE("TimerPolicyVirtual") {
+
+    TimerPolicyVirtual t;
+
+    t.setTimeout(10);
+    CHECK(!t.timedOut());
+    CHECK(msAteDeadline(t.deadline()) == 10);
+    VirtualClock::avanca(9ms);
+    CHECK(!t.timedOut());
+    CHECK(msAteDeadline(t.deadline()) == 1);
+    VirtualClock::avanca(1ms);
+    CHECK(t.timedOut());
+    CHECK(msAteDeadline(t.deadline()) == 0);
+
+    // o tempo não passa sozinho
+    t.setTimeout(1);
+    std::this_thread::sleep_for(2ms);
+    CHECK(!t.timedOut());
+}
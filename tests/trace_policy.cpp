@@ -0,0 +1,74 @@
+#include "doctest/doctest.h"
+#include <cstdio>
+#include <trace_policy.h>
+
+TEST_CASE("Cabeçalho de registro de trace") {
+    cabecalho_trace_t cabecalho = {TRACE_RX, 0x0102030405060708ULL, 0xABCD};
+    uint8_t buf[TRACE_CABECALHO_SZ];
+    serializaCabecalhoTrace(cabecalho, buf);
+
+    CHECK(buf[0] == TRACE_RX);
+    CHECK(buf[1] == 0x08);
+    CHECK(buf[8] == 0x01);
+    CHECK(buf[9] == 0xCD);
+    CHECK(buf[10] == 0xAB);
+
+    cabecalho_trace_t lido = deserializaCabecalhoTrace(buf);
+    CHECK(lido.direcao == TRACE_RX);
+    CHECK(lido.timestamp_ns == 0x0102030405060708ULL);
+    CHECK(lido.tamanho == 0xABCD);
+}
+
+TEST_CASE("TracePolicyMemoria") {
+    TracePolicyMemoria<64> trace;
+    cabecalho_trace_t cabecalho;
+    uint8_t dados[64];
+
+    const uint8_t tx[] = {1, 2, 3, 4, 5};
+    trace.trace(TRACE_TX, tx, sizeof(tx));
+    trace.trace(TRACE_RX, tx, 0); // nada a registrar
+
+    // não cabe no buffer: descartado
+    uint8_t grande[60] = {};
+    trace.trace(TRACE_RX, grande, sizeof(grande));
+    CHECK(trace.descartados() == 1);
+
+    REQUIRE(trace.proximoRegistro(cabecalho, dados, 2));
+    CHECK(cabecalho.direcao == TRACE_TX);
+    CHECK(cabecalho.tamanho == 5);
+    CHECK(dados[0] == 1);
+    CHECK(dados[1] == 2);
+    CHECK(!trace.proximoRegistro(cabecalho, dados, sizeof(dados)));
+}
+
+TEST_CASE("TracePolicyArquivoBinario") {
+    TracePolicyArquivoBinario trace;
+    FILE* arquivo = tmpfile();
+    REQUIRE(arquivo != nullptr);
+    trace.abre(arquivo);
+
+    const uint8_t rx[] = {0x05};
+    const uint8_t tx[] = {0x14, 0x00};
+    trace.trace(TRACE_RX, rx, sizeof(rx));
+    trace.trace(TRACE_TX, tx, sizeof(tx));
+
+    fflush(arquivo);
+    rewind(arquivo);
+
+    uint8_t buf[TRACE_CABECALHO_SZ + 8];
+    REQUIRE(fread(buf, 1, TRACE_CABECALHO_SZ + 1, arquivo) ==
+            TRACE_CABECALHO_SZ + 1);
+    cabecalho_trace_t cabecalho = deserializaCabecalhoTrace(buf);
+    CHECK(cabecalho.direcao == TRACE_RX);
+    CHECK(cabecalho.tamanho == 1);
+    CHECK(buf[TRACE_CABECALHO_SZ] == 0x05);
+
+    REQUIRE(fread(buf, 1, TRACE_CABECALHO_SZ + 2, arquivo) ==
+            TRACE_CABECALHO_SZ + 2);
+    cabecalho = deserializaCabecalhoTrace(buf);
+    CHECK(cabecalho.direcao == TRACE_TX);
+    CHECK(cabecalho.tamanho == 2);
+    CHECK(buf[TRACE_CABECALHO_SZ] == 0x14);
+
+    CHECK(fread(buf, 1, 1, arquivo) == 0);
+}